@@ -10,13 +10,10 @@
 #define BITS_PER_WORD_32 32
 #define BYTES_PER_WORD_24 3
 #define BITS_PER_WORD_24 24
-#define BITS_PER_WORD_25 25
 #define BITS_PER_BYTE 8
 #define NIBBLES_PER_BYTE 2
 #define BITS_PER_NIBBLE 4
 
-#define MASK_MSBIT_WORD24 (0b1 << (BITS_PER_WORD_24 - 1))
-#define MASK_MSBIT_WORD25 (0b1 << BITS_PER_WORD_24)
 #define MASK_WORD24 0xFFFFFF
 
 #define CHAR_TO_HEX(c) ((c >= 'A') ? (c >= 'a') ? (c - 'a' + 10) : (c - 'A' + 10) : (c - '0'))
@@ -26,49 +23,43 @@ const uint32_t kExtendedSquitterLastWordPopCount = 16;
 const uint32_t kSquitterLastWordIngestionMask = 0xFFFFFF00;
 const uint32_t kSquitterLastWordPopCount = 24;
 
-const uint32_t kCRC24Generator = 0x1FFF409;
-const uint16_t kCRC24GeneratorNumBits = 25;
-
 /** TransponderPacket **/
 
+uint16_t TransponderPacket::max_num_corrected_bits = 1;
+
 TransponderPacket::TransponderPacket(uint32_t rx_buffer[kMaxPacketLenWords32], uint16_t rx_buffer_len_words32,
                                      int rssi_dbm, uint64_t mlat_counter_12mhz_counts)
 {
-    // Set the last word indgestion behavior based on packet length.
-    uint32_t last_word_ingestion_mask, last_word_popcount;
-    if (rx_buffer_len_words32 > 2)
+    PackPacketBuffer(rx_buffer, rx_buffer_len_words32);
+    rssi_dbm_ = rssi_dbm;
+    mlat_12mhz_counts_ = mlat_counter_12mhz_counts;
+    ConstructTransponderPacket();
+}
+
+TransponderPacket::TransponderPacket(const RawTransponderPacket &raw_packet)
+{
+    for (uint16_t i = 0; i < kMaxPacketLenWords32; i++)
     {
-        // 112 bit packet (Extended Squitter)
-        last_word_ingestion_mask = kExtendedSquitterLastWordIngestionMask;
-        last_word_popcount = kExtendedSquitterLastWordPopCount;
+        packet_buffer_[i] = raw_packet.buffer[i];
+    }
+    packet_buffer_len_bits_ = raw_packet.buffer_len_bits;
+    rssi_dbm_ = raw_packet.rssi_dbm;
+    mlat_12mhz_counts_ = raw_packet.mlat_12mhz_counts;
+    if (raw_packet.flags & RawTransponderPacket::kFlagCRCCalculated)
+    {
+        ConstructTransponderPacket(raw_packet.crc);
     }
     else
     {
-        // 56 bit packet (Squitter)
-        last_word_ingestion_mask = kSquitterLastWordIngestionMask;
-        last_word_popcount = kSquitterLastWordPopCount;
+        ConstructTransponderPacket();
     }
-
-    // Pack the packet buffer.
-    for (uint16_t i = 0; i < rx_buffer_len_words32 && i < kMaxPacketLenWords32; i++)
+    uint16_t num_corrected_bits = (raw_packet.flags & RawTransponderPacket::kFlagNumCorrectedBitsMask) >>
+                                  RawTransponderPacket::kFlagNumCorrectedBitsShift;
+    if (num_corrected_bits > 0)
     {
-        if (i == rx_buffer_len_words32 - 1)
-        {
-            // Last word in packet.
-            // Last word may have accidentally ingested a subsequent preamble as a bit (takes a while to know message is
-            // over).
-            packet_buffer_[i] = rx_buffer[i] & last_word_ingestion_mask; // trim any crap off of last word
-            packet_buffer_len_bits_ += last_word_popcount;
-        }
-        else
-        {
-            packet_buffer_[i] = rx_buffer[i];
-            packet_buffer_len_bits_ += BITS_PER_WORD_32;
-        }
+        // Buffer was already corrected, so it passed CRC without correcting anything here.
+        num_corrected_bits_ = num_corrected_bits;
     }
-    rssi_dbm_ = rssi_dbm;
-    mlat_12mhz_counts_ = mlat_counter_12mhz_counts;
-    ConstructTransponderPacket();
 }
 
 TransponderPacket::TransponderPacket(char *rx_string, int rssi_dbm, uint64_t mlat_counter_12mhz_counts)
@@ -162,146 +153,189 @@ uint16_t TransponderPacket::DumpPacketBuffer(uint8_t to_buffer[kMaxPacketLenWord
     return bytes_written;
 }
 
-uint32_t TransponderPacket::CalculateCRC24(uint16_t packet_len_bits) const
+uint16_t TransponderPacket::GetDebugString(char str_buf[kDebugStrLen]) const
 {
-    // CRC calculation algorithm from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
-    // Must be called on buffer that does not have extra bit ingested at end and has all words left-aligned.
-    uint32_t crc_buffer[kMaxPacketLenWords32];
+    if (packet_buffer_len_bits_ != kExtendedSquitterPacketLenBits &&
+        packet_buffer_len_bits_ != kSquitterPacketNumBits)
+    {
+        return snprintf(str_buf, kDebugStrLen,
+                        "Bit number mismatch while decoding packet. Expected %d or %d but got %d!\r\n",
+                        kExtendedSquitterPacketLenBits, kSquitterPacketNumBits, packet_buffer_len_bits_);
+    }
+    if (packet_buffer_len_bits_ == kExtendedSquitterPacketLenBits && !is_valid_)
+    {
+        // Packet buffer is only modified by error correction if it succeeded, so the CRC can be recalculated here.
+        return snprintf(str_buf, kDebugStrLen, "Invalid checksum, expected %06x but calculated %06x.\r\n",
+                        get_24_bit_word_from_buffer(packet_buffer_len_bits_ - BITS_PER_WORD_24, packet_buffer_),
+                        CalculateCRC24(packet_buffer_len_bits_));
+    }
+    str_buf[0] = '\0';
+    return 0;
+}
+
+RawTransponderPacket TransponderPacket::GetRaw() const
+{
+    RawTransponderPacket raw_packet;
     for (uint16_t i = 0; i < kMaxPacketLenWords32; i++)
     {
-        crc_buffer[i] = packet_buffer_[i];
+        raw_packet.buffer[i] = packet_buffer_[i];
     }
+    raw_packet.buffer_len_bits = packet_buffer_len_bits_;
+    raw_packet.rssi_dbm = rssi_dbm_;
+    raw_packet.mlat_12mhz_counts = mlat_12mhz_counts_ & RawTransponderPacket::kMLAT12MHzCountsMask;
+    raw_packet.flags = (num_corrected_bits_ << RawTransponderPacket::kFlagNumCorrectedBitsShift) &
+                       RawTransponderPacket::kFlagNumCorrectedBitsMask;
+    return raw_packet;
+}
 
-    // Overwrite 24-bit parity word with zeros.
-    set_n_bit_word_in_buffer(BITS_PER_WORD_24, 0x0, packet_len_bits - BITS_PER_WORD_24, crc_buffer);
+void TransponderPacket::PackPacketBuffer(uint32_t rx_buffer[kMaxPacketLenWords32], uint16_t rx_buffer_len_words32)
+{
+    // Set the last word indgestion behavior based on packet length.
+    uint32_t last_word_ingestion_mask, last_word_popcount;
+    if (rx_buffer_len_words32 > 2)
+    {
+        // 112 bit packet (Extended Squitter)
+        last_word_ingestion_mask = kExtendedSquitterLastWordIngestionMask;
+        last_word_popcount = kExtendedSquitterLastWordPopCount;
+    }
+    else
+    {
+        // 56 bit packet (Squitter)
+        last_word_ingestion_mask = kSquitterLastWordIngestionMask;
+        last_word_popcount = kSquitterLastWordPopCount;
+    }
 
-    // CRC is a conditional convolve operation using the 25-bit generator word.
-    for (uint16_t i = 0; i < packet_len_bits - BITS_PER_WORD_24; i++)
+    // Pack the packet buffer.
+    for (uint16_t i = 0; i < rx_buffer_len_words32 && i < kMaxPacketLenWords32; i++)
     {
-        uint32_t word = get_n_bit_word_from_buffer(BITS_PER_WORD_25, i, crc_buffer);
-        if (word & MASK_MSBIT_WORD25)
+        if (i == rx_buffer_len_words32 - 1)
+        {
+            // Last word in packet.
+            // Last word may have accidentally ingested a subsequent preamble as a bit (takes a while to know message is
+            // over).
+            packet_buffer_[i] = rx_buffer[i] & last_word_ingestion_mask; // trim any crap off of last word
+            packet_buffer_len_bits_ += last_word_popcount;
+        }
+        else
         {
-            // Most significant bit is a 1. XOR with generator!
-            set_n_bit_word_in_buffer(BITS_PER_WORD_25, word ^ kCRC24Generator, i, crc_buffer);
+            packet_buffer_[i] = rx_buffer[i];
+            packet_buffer_len_bits_ += BITS_PER_WORD_32;
         }
     }
+}
 
-    return get_n_bit_word_from_buffer(BITS_PER_WORD_24, packet_len_bits - BITS_PER_WORD_24, crc_buffer);
+uint32_t TransponderPacket::CalculateCRC24(uint16_t packet_len_bits) const
+{
+    // Table-driven CRC over everything except the trailing 24-bit parity word, see crc.hh. Equivalent to the long
+    // division algorithm from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
+    if (packet_len_bits < BITS_PER_WORD_24 || packet_len_bits > kMaxPacketLenWords32 * BITS_PER_WORD_32)
+    {
+        return 0;
+    }
+    return crc24(packet_buffer_, packet_len_bits - BITS_PER_WORD_24);
 }
 
 void TransponderPacket::ConstructTransponderPacket()
+{
+    ConstructTransponderPacket(CalculateCRC24(packet_buffer_len_bits_));
+}
+
+void TransponderPacket::ConstructTransponderPacket(uint32_t calculated_checksum)
 {
     if (packet_buffer_len_bits_ != kExtendedSquitterPacketLenBits &&
         packet_buffer_len_bits_ != kSquitterPacketNumBits)
     {
-        snprintf(debug_string, kDebugStrLen,
-                 "Bit number mismatch while decoding packet. Expected %d or %d but got %d!\r\n",
-                 kExtendedSquitterPacketLenBits, kSquitterPacketNumBits, packet_buffer_len_bits_);
-
         return; // leave is_valid_ as false
     }
 
     downlink_format_ = packet_buffer_[0] >> 27;
-    uint32_t calculated_checksum = CalculateCRC24(packet_buffer_len_bits_);
-    uint32_t parity_value = get_24_bit_word_from_buffer(packet_buffer_len_bits_ - BITS_PER_WORD_24, packet_buffer_);
+    switch (CheckParity(packet_buffer_, packet_buffer_len_bits_, calculated_checksum, icao_address_))
+    {
+    case kParityCheckPassed:
+        is_valid_ = true;
+        break;
+    case kParityCheckCorrectable:
+        // Try to repair the packet with syndrome-based error correction. The ICAO address may have been one of the
+        // repaired bits, so decode the repaired packet from scratch.
+        if (TryCorrectBitErrors(calculated_checksum ^ get_24_bit_word_from_buffer(
+                                                          packet_buffer_len_bits_ - BITS_PER_WORD_24, packet_buffer_)))
+        {
+            ConstructTransponderPacket();
+        }
+        break;
+    default:
+        break; // leave is_valid_ as false
+    }
+}
 
-    switch (static_cast<DownlinkFormat>(downlink_format_))
+TransponderPacket::ParityCheck TransponderPacket::CheckParity(const uint32_t packet_buffer[kMaxPacketLenWords32],
+                                                              uint16_t packet_len_bits, uint32_t calculated_checksum,
+                                                              uint32_t &icao_address)
+{
+    uint16_t downlink_format = packet_buffer[0] >> 27;
+    // Parity field is the last 24 bits of the packet.
+    uint32_t parity_value = packet_len_bits == kExtendedSquitterPacketLenBits
+                                ? get_n_bit_word_from_buffer<88, 24>(packet_buffer)
+                                : get_n_bit_word_from_buffer<32, 24>(packet_buffer);
+
+    switch (static_cast<DownlinkFormat>(downlink_format))
     {
     case kDownlinkFormatShortRangeAirSurveillance:
     case kDownlinkFormatAltitudeReply:
     case kDownlinkFormatIdentityReply:
+    case kDownlinkFormatLongRangeAirSurveillance:
+    case kDownlinkFormatCommBAltitudeReply:
+    case kDownlinkFormatCommBIdentityReply:
+        // Address / Parity: calculated checksum is XORed with the ICAO address. See ADS-B Decoding Guide pg. 22.
+        // ICAO address is a best guess, needs to be confirmed from recently seen ICAO addresses (see
+        // ICAOConfidenceSet).
+        icao_address = parity_value ^ calculated_checksum;
+        return kParityCheckFailed;
     case kDownlinkFormatAllCallReply:
-    {
-        // Process a 56-bit message.
-        is_valid_ = false; // Calculated checksum is XORed with the ICAO address. See ADS-B Decoding Guide pg. 22.
-        // ICAO address is a best guess, needs to be confirmed from the aircraft dictionary.
-        icao_address_ = parity_value ^ calculated_checksum;
-        break;
-    }
+        // Parity / Interrogator ID: checksum is XORed with the interrogator's 7-bit II or SI code, which is 0 for
+        // acquisition squitters. ICAO address is sent in the clear in the AA field.
+        icao_address = packet_buffer[0] & 0xFFFFFF;
+        return ((parity_value ^ calculated_checksum) & ~kAllCallReplyInterrogatorIDMask) == 0 ? kParityCheckPassed
+                                                                                               : kParityCheckFailed;
     default:
-    {
-        // Process a 112-bit message.
-        icao_address_ = packet_buffer_[0] & 0xFFFFFF;
+        icao_address = packet_buffer[0] & 0xFFFFFF;
         if (calculated_checksum == parity_value)
         {
-            is_valid_ = true; // mark packet as valid if CRC matches the parity bits
+            return kParityCheckPassed;
         }
-        else
+        if (downlink_format == kDownlinkFormatExtendedSquitter ||
+            downlink_format == kDownlinkFormatExtendedSquitterNonTransponder)
         {
-            // is_valid_ is set to false by default
-            snprintf(debug_string, kDebugStrLen, "Invalid checksum, expected %06x but calculated %06x.\r\n",
-                     parity_value, calculated_checksum);
+            return kParityCheckCorrectable;
         }
-    }
+        return kParityCheckFailed;
     }
 }
 
-/** ADSBPacket **/
-
-/**
- * Helper function used by constructors.
- */
-void ADSBPacket::ConstructADSBPacket()
-{
-    capability_ = (packet_buffer_[0] >> 24) & 0b111;
-    typecode_ = packet_buffer_[1] >> 27;
-    parity_interrogator_id = packet_buffer_[1] & 0xFFFFFF;
-}
-
-ADSBPacket::TypeCode ADSBPacket::GetTypeCodeEnum() const
+bool TransponderPacket::TryCorrectBitErrors(uint32_t syndrome)
 {
-    // Table 3.3 from The 1090Mhz Riddle (Junzi Sun), pg. 37.
-    switch (typecode_)
+    if (packet_buffer_len_bits_ != kCRC24SyndromeMessageLenBits)
     {
-    case 1:
-    case 2:
-    case 3:
-    case 4:
-        return kTypeCodeAircraftID;
-        break;
-    case 5:
-    case 6:
-    case 7:
-    case 8:
-        return kTypeCodeSurfacePosition;
-        break;
-    case 9:
-    case 10:
-    case 11:
-    case 12:
-    case 13:
-    case 14:
-    case 15:
-    case 16:
-    case 17:
-    case 18:
-        return kTypeCodeAirbornePositionBaroAlt;
-        break;
-    case 19:
-        return kTypeCodeAirborneVelocities;
-        break;
-    case 20:
-    case 21:
-    case 22:
-        return kTypeCodeAirbornePositionGNSSAlt;
-        break;
-    case 23:
-    case 24:
-    case 25:
-    case 26:
-    case 27:
-        return kTypeCodeReserved;
-        break;
-    case 28:
-        return kTypeCodeAircraftStatus;
-        break;
-    case 29:
-        return kTypeCodeTargetStateAndStatusInfo;
-        break;
-    case 31:
-        return kTypeCodeAircraftOperationStatus;
-        break;
-    default:
-        return kTypeCodeInvalid;
+        return false;
+    }
+    uint16_t bit_indices[kCRC24SyndromeMaxNumBits];
+    uint16_t num_bits = crc24_syndrome_lookup(syndrome, max_num_corrected_bits, bit_indices);
+    if (num_bits == 0)
+    {
+        return false;
     }
-}
\ No newline at end of file
+    for (uint16_t i = 0; i < num_bits; i++)
+    {
+        if (bit_indices[i] < kDFNUmBits)
+        {
+            // Downlink format was used to decide to correct this packet, so it's not allowed to change.
+            return false;
+        }
+    }
+    for (uint16_t i = 0; i < num_bits; i++)
+    {
+        packet_buffer_[bit_indices[i] / BITS_PER_WORD_32] ^= 0x80000000u >> (bit_indices[i] % BITS_PER_WORD_32);
+    }
+    num_corrected_bits_ = num_bits;
+    return true;
+}
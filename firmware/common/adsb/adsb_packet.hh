@@ -2,16 +2,46 @@
 #define _ADSB_PACKET_HH_
 
 #include <cstdint>
+#include <type_traits> // For std::is_trivially_copyable.
 
 #include "buffer_utils.hh"
+#include "crc.hh"
 #include "unit_conversions.hh"
 
 // Useful resource: https://mode-s.org/decode/content/ads-b/1-basics.html
 
+/**
+ * Compact record of a demodulated transponder packet, before any decoding. This is what gets passed through the packet
+ * queues between the demodulator, decoder, and reporting code. Construct a TransponderPacket from it to decode it.
+ */
+struct RawTransponderPacket
+{
+    static const uint16_t kMaxPacketLenWords32 = 4;
+    static const uint64_t kMLAT12MHzCountsMask = 0xFFFFFFFFFFFF; // 48-bit MLAT counter, same as Mode S Beast.
+
+    enum Flag : uint8_t
+    {
+        kFlagNone = 0b0,
+        kFlagCRCCalculated = 0b1, // crc already holds the CRC of the data bits, no need to recalculate it.
+        // Number of bits fixed by error correction before buffer was filled, since a corrected buffer passes CRC.
+        kFlagNumCorrectedBitsMask = 0b110
+    };
+    static const uint16_t kFlagNumCorrectedBitsShift = 1;
+
+    // Big-endian, left-aligned packet bits with the MSb of buffer[0] as the oldest bit. Unused bits are 0.
+    uint32_t buffer[kMaxPacketLenWords32] = {0};
+    uint64_t mlat_12mhz_counts : 48 = 0;
+    uint64_t buffer_len_bits : 8 = 0;
+    uint64_t flags : 8 = kFlagNone;
+    uint32_t crc = 0; // CRC-24 of the data bits, only valid if kFlagCRCCalculated is set.
+    int rssi_dbm = INT32_MIN;
+};
+static_assert(sizeof(RawTransponderPacket) <= 32, "RawTransponderPacket should stay small enough to queue cheaply.");
+
 class TransponderPacket
 {
 public:
-    static const uint16_t kMaxPacketLenWords32 = 4;
+    static const uint16_t kMaxPacketLenWords32 = RawTransponderPacket::kMaxPacketLenWords32;
     static const uint16_t kDFNUmBits = 5;    // [1-5] Downlink Format bitlength.
     static const uint16_t kMaxDFStrLen = 50; // Max length of TypeCode string.
     static const uint16_t kDebugStrLen = 200;
@@ -19,6 +49,8 @@ public:
     static const uint16_t kSquitterPacketNumWords32 = 2; // 56 bits = 1.75 words, round up to 2.
     static const uint16_t kExtendedSquitterPacketLenBits = 112;
     static const uint16_t kExtendedSquitterPacketNumWords32 = 4; // 112 bits = 3.5 words, round up to 4.
+    // DF11 parity field is XORed with the 7-bit interrogator ID (II or SI code) of the interrogation being answered.
+    static const uint32_t kAllCallReplyInterrogatorIDMask = 0x7F;
 
     // Bits 1-5: Downlink Format (DF)
     enum DownlinkFormat
@@ -40,6 +72,14 @@ public:
         // DF 1-3, 6-10, 11-15, 22-23 not used
     };
 
+    // Result of checking a packet's parity field against its CRC, see CheckParity.
+    enum ParityCheck
+    {
+        kParityCheckFailed = 0,
+        kParityCheckPassed,
+        kParityCheckCorrectable // Failed, but the downlink format allows trying bit error correction.
+    };
+
     // Constructors
     /**
      * TransponderPacket constructor.
@@ -52,6 +92,12 @@ public:
      */
     TransponderPacket(uint32_t rx_buffer[kMaxPacketLenWords32], uint16_t rx_buffer_len, int rssi_dbm = INT32_MIN, uint64_t mlat_12mhz_counts = 0);
 
+    /**
+     * TransponderPacket constructor from a raw packet. Uses the CRC in the raw packet if it was already calculated.
+     * @param[in] raw_packet RawTransponderPacket to decode.
+     */
+    TransponderPacket(const RawTransponderPacket &raw_packet);
+
     /**
      * TransponderPacket constructor from string.
      * @param[in] rx_string String of nibbles as hex characters. Big-endian, MSB (oldest byte) first.
@@ -63,9 +109,16 @@ public:
     /**
      * Default constructor.
      */
-    TransponderPacket() { debug_string[0] = '\0'; };
+    TransponderPacket() {};
 
-    bool IsValid() const { return is_valid_; };
+    constexpr bool IsValid() const { return is_valid_; };
+
+    /**
+     * Returns the number of bits that were flipped by syndrome-based error correction in order to make the packet pass
+     * its CRC. A packet with a nonzero value here is still marked as valid.
+     * @retval Number of corrected bits, 0 if the packet was received clean or could not be corrected.
+     */
+    uint16_t GetNumCorrectedBits() const { return num_corrected_bits_; }
 
     int GetRSSIdBm() const { return rssi_dbm_; }
     uint64_t GetMLAT12MHzCounter() const { return mlat_12mhz_counts_; }
@@ -73,7 +126,23 @@ public:
     uint16_t GetDownlinkFormatString(char str_buf[kMaxDFStrLen]) const;
     DownlinkFormat GetDownlinkFormatEnum();
     uint32_t GetICAOAddress() const { return icao_address_; };
-    uint16_t GetPacketBufferLenBits() const { return packet_buffer_len_bits_; };
+    constexpr uint16_t GetPacketBufferLenBits() const { return packet_buffer_len_bits_; };
+    constexpr const uint32_t *GetPacketBuffer() const { return packet_buffer_; };
+
+    /**
+     * Formats a human readable description of why the packet failed to decode. Only meant for debugging, so nothing is
+     * formatted until this is called.
+     * @param[out] str_buf Buffer to write the string to.
+     * @retval Number of characters written, 0 if there is nothing to report.
+     */
+    uint16_t GetDebugString(char str_buf[kDebugStrLen]) const;
+
+    /**
+     * Packs the contents of the packet back into a compact RawTransponderPacket, e.g. for forwarding to a reporting
+     * queue. Includes any bit error corrections that were made to the packet.
+     * @retval RawTransponderPacket with the packet buffer, RSSI, and MLAT timestamp.
+     */
+    RawTransponderPacket GetRaw() const;
 
     /**
      * Dumps the internal packet buffer to a destination and returns the number of bytes written.
@@ -96,11 +165,29 @@ public:
      */
     uint32_t CalculateCRC24(uint16_t packet_len_bits = kExtendedSquitterPacketLenBits) const;
 
-    char debug_string[kDebugStrLen] = "";
+    /**
+     * Checks the parity field of a packet against the CRC of its data bits, based on how its downlink format uses the
+     * parity field, and pulls out its ICAO address. Formats with the ICAO address overlaid on the parity field (AP)
+     * never pass, since the address still needs to be confirmed. DF11 passes with any interrogator ID overlaid on the
+     * parity field (PI). Everything else passes only if the parity field matches the CRC.
+     * @param[in] packet_buffer Packet buffer with the MSb of the first word as the oldest bit.
+     * @param[in] packet_len_bits Number of bits in the packet, must be 56 or 112.
+     * @param[in] calculated_checksum CRC-24 of the data bits in the packet buffer.
+     * @param[out] icao_address ICAO address from the AA field, or recovered from the AP field.
+     * @retval Whether the packet passed, failed, or failed but may be fixed by TryCorrectBitErrors.
+     */
+    static ParityCheck CheckParity(const uint32_t packet_buffer[kMaxPacketLenWords32], uint16_t packet_len_bits,
+                                   uint32_t calculated_checksum, uint32_t &icao_address);
+
+    // Maximum number of bit errors that ConstructTransponderPacket will try to repair in DF17/DF18 extended squitters.
+    // 1 is safe to leave on. 2 repairs more damaged frames at the cost of a higher chance of "repairing" noise into a
+    // plausible looking packet. 0 disables error correction.
+    static uint16_t max_num_corrected_bits;
 
 protected:
     bool is_valid_ = false;
-    uint32_t packet_buffer_[kMaxPacketLenWords32];
+    uint16_t num_corrected_bits_ = 0;
+    uint32_t packet_buffer_[kMaxPacketLenWords32] = {0};
     uint16_t packet_buffer_len_bits_ = 0;
 
     uint32_t icao_address_ = 0;
@@ -111,29 +198,70 @@ protected:
     uint32_t parity_interrogator_id = 0;
 
 private:
+    /**
+     * Packs the packet buffer from a word buffer, trimming any extra bits ingested into the last word.
+     * @param[in] rx_buffer Buffer to read from.
+     * @param[in] rx_buffer_len_words32 Number of 32-bit words to read from the rx_buffer.
+     */
+    void PackPacketBuffer(uint32_t rx_buffer[kMaxPacketLenWords32], uint16_t rx_buffer_len_words32);
+
     void ConstructTransponderPacket();
+
+    /**
+     * Helper function used by constructors once the packet buffer is filled.
+     * @param[in] calculated_checksum CRC of the data bits in the packet buffer.
+     */
+    void ConstructTransponderPacket(uint32_t calculated_checksum);
+
+    /**
+     * Attempts to repair a 112-bit packet that failed its CRC by flipping the bits indicated by its syndrome. Packets
+     * are only modified if the correction succeeds.
+     * @param[in] syndrome CRC of the packet's data bits XORed with its parity bits.
+     * @retval True if the packet was repaired, false otherwise.
+     */
+    bool TryCorrectBitErrors(uint32_t syndrome);
 };
 
-class ADSBPacket : public TransponderPacket
+/**
+ * Non-owning view of a 112-bit extended squitter stored in a packet buffer, usually the one inside a TransponderPacket.
+ * Field accessors pull bits straight out of the referenced buffer, so an ADSBPacket is only a pointer and a validity
+ * flag and is cheap to pass by value. The ADSBPacket cannot outlive the packet buffer it was created from!
+ */
+class ADSBPacket
 {
 public:
     static const uint16_t kMaxTCStrLen = 50;
 
     // Bitlengths of each field in the ADS-B frame. See Table 3.1 in The 1090MHz Riddle (Junzi Sun) pg. 35.
-    static const uint16_t kCANumBits = 3;    // [6-8] Capability bitlength.
-    static const uint16_t kICAONumBits = 24; // [9-32] ICAO Address bitlength.
-    static const uint16_t kMENumBits = 56;   // [33-88] Extended Squitter Message bitlength.
-    static const uint16_t kTCNumBits = 5;    // [33-37] Type code bitlength. Not always included.
-    static const uint16_t kPINumBits = 24;   // Parity / Interrogator ID bitlength.
+    static const uint16_t kDFNUmBits = TransponderPacket::kDFNUmBits; // [1-5] Downlink Format bitlength.
+    static const uint16_t kCANumBits = 3;                             // [6-8] Capability bitlength.
+    static const uint16_t kICAONumBits = 24;                          // [9-32] ICAO Address bitlength.
+    static const uint16_t kMENumBits = 56;                            // [33-88] Extended Squitter Message bitlength.
+    static const uint16_t kTCNumBits = 5;  // [33-37] Type code bitlength. Not always included.
+    static const uint16_t kPINumBits = 24; // Parity / Interrogator ID bitlength.
 
     static const uint16_t kMEFirstBitIndex = kDFNUmBits + kCANumBits + kICAONumBits;
 
     /**
-     * Constructor. Can only create an ADSBPacket from an existing TransponderPacket, which is is referenced as the
-     * parent of the ADSBPacket. Think of this as a way to use the ADSBPacket as a "window" into the contents of the
-     * parent TransponderPacket. The ADSBPacket cannot exist without the parent TransponderPacket!
+     * Constructor. Creates an ADSBPacket as a "window" into the packet buffer of an existing TransponderPacket. The
+     * ADSBPacket is only valid if the TransponderPacket is a valid 112-bit packet.
+     * @param[in] packet TransponderPacket to reference. Must stay in scope for as long as the ADSBPacket is used.
+     */
+    constexpr ADSBPacket(const TransponderPacket &packet)
+        : packet_buffer_(packet.GetPacketBuffer()),
+          is_valid_(packet.IsValid() &&
+                    packet.GetPacketBufferLenBits() == TransponderPacket::kExtendedSquitterPacketLenBits) {};
+    // A temporary TransponderPacket would be gone before the ADSBPacket could be used.
+    ADSBPacket(const TransponderPacket &&) = delete;
+
+    /**
+     * Constructor from a bare packet buffer, e.g. the buffer of a RawTransponderPacket.
+     * @param[in] packet_buffer Big-endian, left-aligned buffer holding a 112-bit packet. Must stay in scope for as long
+     * as the ADSBPacket is used.
+     * @param[in] is_valid Whether the packet in the buffer passed its CRC.
      */
-    ADSBPacket(const TransponderPacket &packet) : TransponderPacket(packet) { ConstructADSBPacket(); };
+    constexpr ADSBPacket(const uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32], bool is_valid)
+        : packet_buffer_(packet_buffer), is_valid_(is_valid) {};
 
     // Bits 6-8 [3]: Capability (CA)
     // Bits 9-32 [24]: ICAO Aircraft Address (ICAO)
@@ -163,22 +291,128 @@ public:
         kAirborneVelocitiesAirspeedSupersonic = 4
     };
 
-    uint16_t GetCapability() const { return capability_; };
-    uint16_t GetTypeCode() const { return typecode_; };
-    TypeCode GetTypeCodeEnum() const;
+    /**
+     * Location of a field within the ME field. FirstBitIndex 0 is the MSb of the ME field (first bit of the type code).
+     */
+    template <unsigned FirstBitIndex, unsigned NumBits>
+    struct MEField
+    {
+        static_assert(FirstBitIndex + NumBits <= kMENumBits, "Field must fit inside the ME field.");
+        static const unsigned kFirstBitIndex = FirstBitIndex;
+        static const unsigned kNumBits = NumBits;
+    };
 
-    // Exposed for testing only.
-    uint32_t GetNBitWordFromMessage(uint16_t n, uint16_t first_bit_index) const
+    // ME field layouts by type code. See The 1090MHz Riddle (Junzi Sun) chapters 4 (identification), 5 (airborne
+    // position) and 6 (airborne velocity).
+    struct AircraftIDFields
+    {
+        using Category = MEField<5, 3>;
+        // 8 callsign characters, 6 bits each, read as two 24-bit halves.
+        using CallsignFirstHalf = MEField<8, 24>;
+        using CallsignSecondHalf = MEField<32, 24>;
+    };
+    struct AirbornePositionFields
     {
-        return get_n_bit_word_from_buffer(n, kMEFirstBitIndex + first_bit_index, packet_buffer_);
+        using SurveillanceStatus = MEField<5, 2>;
+        using SingleAntennaFlag = MEField<7, 1>;
+        using EncodedAltitude = MEField<8, 12>;
+        using Time = MEField<20, 1>;
+        using CPRFormat = MEField<21, 1>;
+        using CPRLat = MEField<22, 17>;
+        using CPRLon = MEField<39, 17>;
+    };
+    struct AirborneVelocitiesFields
+    {
+        using Subtype = MEField<5, 3>;
+        // Subtypes 1-2 (ground speed).
+        using DirectionEW = MEField<13, 1>;
+        using VelocityEW = MEField<14, 10>;
+        using DirectionNS = MEField<24, 1>;
+        using VelocityNS = MEField<25, 10>;
+        // Subtypes 3-4 (airspeed).
+        using Heading = MEField<14, 10>;
+        using AirspeedType = MEField<24, 1>;
+        using Airspeed = MEField<25, 10>;
+        // All subtypes.
+        using VerticalRateSource = MEField<35, 1>;
+        using VerticalRateSign = MEField<36, 1>;
+        using VerticalRate = MEField<37, 9>;
+        using GNSSBaroAltDifferenceSign = MEField<48, 1>;
+        using GNSSBaroAltDifference = MEField<49, 7>;
     };
 
-private:
-    uint16_t capability_ = 0;
+    constexpr bool IsValid() const { return is_valid_; };
+    constexpr uint16_t GetDownlinkFormat() const { return packet_buffer_[0] >> 27; };
+    constexpr uint16_t GetCapability() const { return (packet_buffer_[0] >> 24) & 0b111; };
+    constexpr uint32_t GetICAOAddress() const { return packet_buffer_[0] & 0xFFFFFF; };
+    constexpr uint16_t GetTypeCode() const { return packet_buffer_[1] >> 27; };
+    constexpr TypeCode GetTypeCodeEnum() const { return kTypeCodeEnums[GetTypeCode()]; };
+
+    /**
+     * Returns an n-bit word from the ME field, where first_bit_index 0 is the MSb of the ME field (first bit of the
+     * type code).
+     * @param[in] n Number of bits to read, max 32.
+     * @param[in] first_bit_index Index of the first bit to read within the ME field.
+     * @retval Right-aligned n-bit word.
+     */
+    constexpr uint32_t GetNBitWordFromMessage(uint16_t n, uint16_t first_bit_index) const
+    {
+        // ME field is the last 32 bits of word 1 followed by the first 24 bits of word 2, so it fits in a uint64_t.
+        uint64_t me_left_aligned = (static_cast<uint64_t>(packet_buffer_[1]) << 32) | packet_buffer_[2];
+        return (me_left_aligned >> (64 - first_bit_index - n)) & (UINT64_MAX >> (64 - n));
+    };
 
-    uint16_t typecode_ = static_cast<uint16_t>(kTypeCodeInvalid);
+    /**
+     * Returns a field from the ME field, with the field location resolved at compile time.
+     * Example: packet.GetMEField<ADSBPacket::AirbornePositionFields::CPRLat>()
+     * @retval Right-aligned field value.
+     */
+    template <typename Field>
+    constexpr uint32_t GetMEField() const
+    {
+        return get_n_bit_word_from_buffer<kMEFirstBitIndex + Field::kFirstBitIndex, Field::kNumBits>(packet_buffer_);
+    };
+
+private:
+    // Table 3.3 from The 1090Mhz Riddle (Junzi Sun), pg. 37.
+    static constexpr TypeCode kTypeCodeEnums[1 << kTCNumBits] = {
+        kTypeCodeInvalid,                  // 0
+        kTypeCodeAircraftID,               // 1
+        kTypeCodeAircraftID,               // 2
+        kTypeCodeAircraftID,               // 3
+        kTypeCodeAircraftID,               // 4
+        kTypeCodeSurfacePosition,          // 5
+        kTypeCodeSurfacePosition,          // 6
+        kTypeCodeSurfacePosition,          // 7
+        kTypeCodeSurfacePosition,          // 8
+        kTypeCodeAirbornePositionBaroAlt,  // 9
+        kTypeCodeAirbornePositionBaroAlt,  // 10
+        kTypeCodeAirbornePositionBaroAlt,  // 11
+        kTypeCodeAirbornePositionBaroAlt,  // 12
+        kTypeCodeAirbornePositionBaroAlt,  // 13
+        kTypeCodeAirbornePositionBaroAlt,  // 14
+        kTypeCodeAirbornePositionBaroAlt,  // 15
+        kTypeCodeAirbornePositionBaroAlt,  // 16
+        kTypeCodeAirbornePositionBaroAlt,  // 17
+        kTypeCodeAirbornePositionBaroAlt,  // 18
+        kTypeCodeAirborneVelocities,       // 19
+        kTypeCodeAirbornePositionGNSSAlt,  // 20
+        kTypeCodeAirbornePositionGNSSAlt,  // 21
+        kTypeCodeAirbornePositionGNSSAlt,  // 22
+        kTypeCodeReserved,                 // 23
+        kTypeCodeReserved,                 // 24
+        kTypeCodeReserved,                 // 25
+        kTypeCodeReserved,                 // 26
+        kTypeCodeReserved,                 // 27
+        kTypeCodeAircraftStatus,           // 28
+        kTypeCodeTargetStateAndStatusInfo, // 29
+        kTypeCodeInvalid,                  // 30
+        kTypeCodeAircraftOperationStatus   // 31
+    };
 
-    void ConstructADSBPacket();
+    const uint32_t *packet_buffer_;
+    bool is_valid_;
 };
+static_assert(std::is_trivially_copyable<ADSBPacket>::value, "ADSBPacket should be a lightweight view.");
 
 #endif /* _ADSB_PACKET_HH_ */
\ No newline at end of file
@@ -9,6 +9,9 @@
 #include "macros.hh"
 
 const float kRadiansToDegrees = 360.0f / (2.0f * M_PI);
+// Equirectangular approximation of distances on the Earth's surface, which is plenty close for receiver ranges.
+const float kKmPerDegLat = 110.574f;
+const float kKmPerDegLonAtEquator = 111.320f;
 
 /**
  * Aircraft
@@ -16,11 +19,13 @@ const float kRadiansToDegrees = 360.0f / (2.0f * M_PI);
 
 Aircraft::Aircraft(uint32_t icao_address_in) : icao_address(icao_address_in)
 {
+    memset(changed_fields, kChangedFieldsAll, sizeof(changed_fields));
     // memset(callsign, '\0', kCallSignMaxNumChars + 1);  // clear out callsign string, including extra EOS character
 }
 
 Aircraft::Aircraft()
 {
+    memset(changed_fields, kChangedFieldsAll, sizeof(changed_fields));
     // memset(callsign, '\0', kCallSignMaxNumChars + 1);  // clear out callsign string, including extra EOS character
 }
 
@@ -33,34 +38,33 @@ bool Aircraft::DecodePosition()
         return false; // need both an even and an odd packet to be able to decode position
     }
 
-    // Equation 5.6
-    int32_t lat_zone_index = floorf(59.0f * last_even_packet_.lat_cpr - 60.0f * last_odd_packet_.lat_cpr + 0.5f);
+    // Equation 5.5
+    float odd_lat_cpr = static_cast<float>(last_odd_packet_.n_lat) / kCPRLatLonMaxCount;
+    float even_lat_cpr = static_cast<float>(last_even_packet_.n_lat) / kCPRLatLonMaxCount;
 
-    bool calculate_odd =
-        last_odd_packet_.calculated_timestamp_ms > last_odd_packet_.received_timestamp_ms ? false : true;
-    bool calculate_even =
-        last_even_packet_.calculated_timestamp_ms > last_even_packet_.received_timestamp_ms ? false : true;
+    // Equation 5.6
+    int32_t lat_zone_index = floorf(59.0f * even_lat_cpr - 60.0f * odd_lat_cpr + 0.5f);
 
-    if (calculate_odd)
+    if (!last_odd_packet_.lat_calculated)
     {
         // Equation 5.7
-        last_odd_packet_.lat = kCPRdLatOdd * ((lat_zone_index % 59) + last_odd_packet_.lat_cpr);
+        last_odd_packet_.lat = kCPRdLatOdd * ((lat_zone_index % 59) + odd_lat_cpr);
         // Equation 5.8: wrap latitude to between -90 and +90 degrees.
         last_odd_packet_.lat = wrap_latitude(last_odd_packet_.lat);
         // Calculate NL, which will be used later to calculate the number of longitude zones in this latitude band.
         last_odd_packet_.nl_cpr = calc_nl_cpr_from_lat(last_odd_packet_.lat);
-        last_odd_packet_.calculated_timestamp_ms = get_time_since_boot_ms();
+        last_odd_packet_.lat_calculated = true;
     }
 
-    if (calculate_even)
+    if (!last_even_packet_.lat_calculated)
     {
         // Equation 5.7
-        last_even_packet_.lat = kCPRdLatEven * ((lat_zone_index % 60) + last_even_packet_.lat_cpr);
+        last_even_packet_.lat = kCPRdLatEven * ((lat_zone_index % 60) + even_lat_cpr);
         // Equation 5.8: wrap latitude to between -90 and +90 degrees.
         last_even_packet_.lat = wrap_latitude(last_even_packet_.lat);
         // Calculate NL, which will be used later to calculate the number of longitude zones in this latitude band.
         last_even_packet_.nl_cpr = calc_nl_cpr_from_lat(last_even_packet_.lat);
-        last_even_packet_.calculated_timestamp_ms = get_time_since_boot_ms();
+        last_even_packet_.lat_calculated = true;
     }
 
     /**
@@ -92,9 +96,12 @@ bool Aircraft::DecodePosition()
     CPRPacket &last_packet = received_odd_last ? last_odd_packet_ : last_even_packet_;
     latitude_deg = last_packet.lat; // Publish latitude.
 
+    // Equation 5.5
+    float odd_lon_cpr = static_cast<float>(last_odd_packet_.n_lon) / kCPRLatLonMaxCount;
+    float even_lon_cpr = static_cast<float>(last_even_packet_.n_lon) / kCPRLatLonMaxCount;
+
     // Equation 5.10
-    int32_t lon_zone_index = floorf(last_even_packet_.lon_cpr * (last_packet.nl_cpr - 1) -
-                                    last_odd_packet_.lon_cpr * last_packet.nl_cpr + 0.5f);
+    int32_t lon_zone_index = floorf(even_lon_cpr * (last_packet.nl_cpr - 1) - odd_lon_cpr * last_packet.nl_cpr + 0.5f);
 
     // Equation 5.11: Use nl_lat_cpr to calculate actual number of longitude zones
     uint16_t num_lon_zones = received_odd_last ? MAX(last_packet.nl_cpr - 1, 1) : MAX(last_packet.nl_cpr, 1);
@@ -102,7 +109,8 @@ bool Aircraft::DecodePosition()
     float d_lon = 360.0f / num_lon_zones;
 
     // Equation 5.13 (calc longitude), 5.15 (wrap longitude to between -180 and +180 degrees)
-    longitude_deg = wrap_longitude(d_lon * ((lon_zone_index % num_lon_zones) + last_packet.lon_cpr));
+    longitude_deg = wrap_longitude(d_lon * ((lon_zone_index % num_lon_zones) +
+                                            (received_odd_last ? odd_lon_cpr : even_lon_cpr)));
     position_valid = true; // TODO: add "reasonable validation" that position is valid
     return true;
 }
@@ -118,9 +126,7 @@ bool Aircraft::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bo
     packet.received_timestamp_ms = get_time_since_boot_ms();
     packet.n_lat = n_lat_cpr;
     packet.n_lon = n_lon_cpr;
-    // Equation 5.5
-    packet.lat_cpr = static_cast<float>(n_lat_cpr) / kCPRLatLonMaxCount;
-    packet.lon_cpr = static_cast<float>(n_lon_cpr) / kCPRLatLonMaxCount;
+    packet.lat_calculated = false;
 
     return true;
 }
@@ -131,28 +137,25 @@ bool Aircraft::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bo
 
 void AircraftDictionary::Init()
 {
-    dict.clear(); // Remove all aircraft from the unordered map.
+    dict.Clear(); // Remove all aircraft.
+    grid_index_.Clear();
+    icao_confidence_set_.Clear();
 }
 
 void AircraftDictionary::Update(uint32_t timestamp_ms)
 {
-    // Iterate over each key-value pair in the unordered_map
-    for (auto it = dict.begin(); it != dict.end(); /* No increment here */)
+    // Stale aircraft are all at the least recent end of dict, so stop at the first one that's still fresh.
+    Aircraft *aircraft = dict.GetLeastRecent();
+    while (aircraft != nullptr && timestamp_ms - aircraft->last_seen_timestamp_ms > config_.aircraft_prune_interval_ms)
     {
-        if (timestamp_ms - it->second.last_seen_timestamp_ms > config_.aircraft_prune_interval_ms)
-        {
-            it = dict.erase(it); // Remove stale aircraft entry.
-        }
-        else
-        {
-            it++; // Move to the next aircraft entry.
-        }
+        RemoveAircraft(dict.GetICAOAddress(*aircraft)); // Remove stale aircraft entry.
+        aircraft = dict.GetLeastRecent();
     }
 }
 
 bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet)
 {
-    if (!packet.IsValid() || packet.GetDownlinkFormat() != ADSBPacket::kDownlinkFormatExtendedSquitter)
+    if (!packet.IsValid() || packet.GetDownlinkFormat() != TransponderPacket::kDownlinkFormatExtendedSquitter)
     {
         return false; // Only allow valid DF17 packets.
     }
@@ -167,7 +170,7 @@ bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet)
             icao_address);
         return false; // unable to find or create new aircraft in dictionary
     }
-    aircraft_ptr->last_seen_timestamp_ms = get_time_since_boot_ms();
+    MarkAircraftSeen(*aircraft_ptr, get_time_since_boot_ms());
 
     switch (packet.GetTypeCodeEnum())
     {
@@ -203,97 +206,273 @@ bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet)
     return false;
 }
 
-uint16_t AircraftDictionary::GetNumAircraft() { return dict.size(); }
-
-bool AircraftDictionary::InsertAircraft(const Aircraft &aircraft)
+bool AircraftDictionary::IngestTransponderPacket(const TransponderPacket &packet)
 {
-    auto itr = dict.find(aircraft.icao_address);
-    if (itr != dict.end())
+    uint32_t timestamp_ms = get_time_since_boot_ms();
+    uint32_t icao_address = packet.GetICAOAddress();
+    uint16_t downlink_format = packet.GetDownlinkFormat();
+
+    switch (downlink_format)
+    {
+    case TransponderPacket::kDownlinkFormatAllCallReply:
+    case TransponderPacket::kDownlinkFormatExtendedSquitter:
+    case TransponderPacket::kDownlinkFormatExtendedSquitterNonTransponder:
+        // ICAO address is sent in the clear and covered by the CRC.
+        if (!packet.IsValid())
+        {
+            return false;
+        }
+        // A corrected packet could have been fixed up into the wrong address, and DF18 only carries an ICAO address
+        // for CF = 0 (TIS-B and ADS-R may relay other address types), so neither vouches for the address.
+        if (packet.GetNumCorrectedBits() == 0 &&
+            (downlink_format != TransponderPacket::kDownlinkFormatExtendedSquitterNonTransponder ||
+             get_n_bit_word_from_buffer<5, 3>(packet.GetPacketBuffer()) == 0))
+        {
+            icao_confidence_set_.Insert(icao_address, timestamp_ms);
+        }
+        break;
+    case TransponderPacket::kDownlinkFormatShortRangeAirSurveillance:
+    case TransponderPacket::kDownlinkFormatAltitudeReply:
+    case TransponderPacket::kDownlinkFormatIdentityReply:
+    case TransponderPacket::kDownlinkFormatLongRangeAirSurveillance:
+    case TransponderPacket::kDownlinkFormatCommBAltitudeReply:
+    case TransponderPacket::kDownlinkFormatCommBIdentityReply:
+        // ICAO address is overlaid on the CRC, only trust it if it was recently seen in a CRC-clean packet.
+        if (!icao_confidence_set_.Contains(icao_address, timestamp_ms))
+        {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    if (downlink_format == TransponderPacket::kDownlinkFormatExtendedSquitter)
     {
-        // Overwriting an existing aircraft
-        itr->second = aircraft;
+        IngestADSBPacket(ADSBPacket(packet));
         return true;
     }
+    if (downlink_format == TransponderPacket::kDownlinkFormatExtendedSquitterNonTransponder)
+    {
+        return true; // Only used to build confidence in the ICAO address for now.
+    }
 
-    if (dict.size() >= kMaxNumAircraft)
+    Aircraft *aircraft_ptr = GetAircraftPtr(icao_address);
+    if (aircraft_ptr == nullptr)
     {
-        CONSOLE_INFO(
-            "AIrcraftDictionary::InsertAircraft: Failed to add aircraft to dictionary, max number of aircraft is %d.",
-            kMaxNumAircraft);
-        return false; // not enough room to add this aircraft
+        CONSOLE_WARNING(
+            "AircraftDictionary::IngestTransponderPacket: Unable to find or create new aircraft with ICAO address 0x%x "
+            "in dictionary.\r\n",
+            icao_address);
+        return true; // Packet was still verified.
     }
+    MarkAircraftSeen(*aircraft_ptr, timestamp_ms);
 
-    dict[aircraft.icao_address] = aircraft; // add the new aircraft to the dictionary
+    const uint32_t *packet_buffer = packet.GetPacketBuffer();
+    switch (downlink_format)
+    {
+    case TransponderPacket::kDownlinkFormatAllCallReply:
+        // Bits 6-8: Capability (CA)
+        aircraft_ptr->transponder_capability = get_n_bit_word_from_buffer<5, 3>(packet_buffer);
+        aircraft_ptr->MarkChanged(Aircraft::kChangedFieldsStatus);
+        break;
+    case TransponderPacket::kDownlinkFormatShortRangeAirSurveillance:
+    case TransponderPacket::kDownlinkFormatLongRangeAirSurveillance:
+        // Bit 6: Vertical Status (VS), 1 = on ground.
+        aircraft_ptr->is_airborne = get_n_bit_word_from_buffer<5, 1>(packet_buffer) == 0;
+        aircraft_ptr->MarkChanged(Aircraft::kChangedFieldsStatus);
+        IngestModeSAltitude(*aircraft_ptr, packet);
+        break;
+    case TransponderPacket::kDownlinkFormatAltitudeReply:
+    case TransponderPacket::kDownlinkFormatCommBAltitudeReply:
+    case TransponderPacket::kDownlinkFormatIdentityReply:
+    case TransponderPacket::kDownlinkFormatCommBIdentityReply:
+    {
+        // Bits 6-8: Flight Status (FS). 0 and 2 are airborne, 1 and 3 are on ground, others don't say.
+        uint16_t flight_status = get_n_bit_word_from_buffer<5, 3>(packet_buffer);
+        if (flight_status <= 3)
+        {
+            aircraft_ptr->is_airborne = (flight_status & 0b1) == 0;
+            aircraft_ptr->MarkChanged(Aircraft::kChangedFieldsStatus);
+        }
+        if (downlink_format == TransponderPacket::kDownlinkFormatAltitudeReply ||
+            downlink_format == TransponderPacket::kDownlinkFormatCommBAltitudeReply)
+        {
+            IngestModeSAltitude(*aircraft_ptr, packet);
+        }
+        else
+        {
+            IngestModeSIdentity(*aircraft_ptr, packet);
+        }
+        break;
+    }
+    }
     return true;
 }
 
-bool AircraftDictionary::RemoveAircraft(uint32_t icao_address)
+uint16_t AircraftDictionary::GetNumAircraft() { return dict.Size(); }
+
+bool AircraftDictionary::GetNextChangedAircraft(ChangeCursor &cursor, Aircraft &aircraft_out, uint8_t &changed_fields)
 {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end())
+    for (; cursor.pool_index < kMaxNumAircraft; cursor.pool_index++)
     {
-        dict.erase(itr);
+        Aircraft *aircraft = dict.GetAtPoolIndex(cursor.pool_index);
+        if (aircraft == nullptr || aircraft->changed_fields[cursor.consumer_id] == Aircraft::kChangedFieldsNone)
+        {
+            continue;
+        }
+        changed_fields = aircraft->changed_fields[cursor.consumer_id];
+        aircraft->changed_fields[cursor.consumer_id] = Aircraft::kChangedFieldsNone;
+        aircraft_out = *aircraft;
+        cursor.pool_index++;
         return true;
     }
-    return false; // aircraft was not found in the dictionary
+    cursor.pool_index = 0; // Start the next pass from the beginning.
+    return false;
 }
 
-bool AircraftDictionary::GetAircraft(uint32_t icao_address, Aircraft &aircraft_out) const
+bool AircraftDictionary::InsertAircraft(const Aircraft &aircraft)
 {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end())
+    bool inserted;
+    Aircraft *aircraft_ptr = FindOrInsertAircraft(aircraft.icao_address, inserted);
+    *aircraft_ptr = aircraft; // add the new aircraft to the dictionary, or overwrite the existing one
+    dict.Touch(*aircraft_ptr);
+    if (aircraft_ptr->position_valid)
     {
-        aircraft_out = itr->second;
-        return true;
+        grid_index_.Update(dict.GetPoolIndex(*aircraft_ptr), aircraft_ptr->latitude_deg, aircraft_ptr->longitude_deg);
     }
-    return false; // aircraft not found
+    else
+    {
+        grid_index_.Remove(dict.GetPoolIndex(*aircraft_ptr));
+    }
+    return true;
 }
 
-bool AircraftDictionary::ContainsAircraft(uint32_t icao_address) const
+bool AircraftDictionary::RemoveAircraft(uint32_t icao_address)
 {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end())
+    Aircraft *aircraft_ptr = dict.Find(icao_address);
+    if (aircraft_ptr == nullptr)
     {
-        return true;
+        return false;
     }
-    return false;
+    grid_index_.Remove(dict.GetPoolIndex(*aircraft_ptr));
+    return dict.Remove(icao_address);
 }
 
-Aircraft *AircraftDictionary::GetAircraftPtr(uint32_t icao_address)
+uint16_t AircraftDictionary::FindAircraftInRange(const AircraftRangeQuery &query, uint32_t icao_addresses_out[],
+                                                 uint16_t max_num_aircraft)
+{
+    float km_per_deg_lon = kKmPerDegLonAtEquator * cosf(query.latitude_deg / kRadiansToDegrees);
+    float radius_lat_deg = query.radius_km / kKmPerDegLat;
+    // Near the poles, longitude degrees get tiny and the search area wraps all the way around.
+    float radius_lon_deg = km_per_deg_lon > query.radius_km / 180.0f ? query.radius_km / km_per_deg_lon : 180.0f;
+    bool altitude_band_is_bounded = query.min_altitude_ft != INT32_MIN || query.max_altitude_ft != INT32_MAX;
+
+    uint16_t num_aircraft = 0;
+    grid_index_.ForEachInBox(
+        query.latitude_deg - radius_lat_deg, query.latitude_deg + radius_lat_deg, query.longitude_deg - radius_lon_deg,
+        query.longitude_deg + radius_lon_deg,
+        [&](uint16_t pool_index)
+        {
+            const Aircraft &aircraft = *dict.GetAtPoolIndex(pool_index);
+            if (num_aircraft >= max_num_aircraft || !aircraft.position_valid)
+            {
+                return;
+            }
+            if (altitude_band_is_bounded)
+            {
+                int32_t altitude_ft;
+                switch (aircraft.altitude_source)
+                {
+                case Aircraft::AltitudeSource::kAltitudeSourceBaro:
+                    altitude_ft = static_cast<int32_t>(aircraft.baro_altitude_ft);
+                    break;
+                case Aircraft::AltitudeSource::kAltitudeSourceGNSS:
+                    altitude_ft = static_cast<int32_t>(aircraft.gnss_altitude_ft);
+                    break;
+                default:
+                    return; // No altitude to check against the band.
+                }
+                if (altitude_ft < query.min_altitude_ft || altitude_ft > query.max_altitude_ft)
+                {
+                    return;
+                }
+            }
+            float d_lon_deg = remainderf(aircraft.longitude_deg - query.longitude_deg, 360.0f);
+            float dx_km = d_lon_deg * km_per_deg_lon;
+            float dy_km = (aircraft.latitude_deg - query.latitude_deg) * kKmPerDegLat;
+            if (dx_km * dx_km + dy_km * dy_km <= query.radius_km * query.radius_km)
+            {
+                icao_addresses_out[num_aircraft++] = dict.GetICAOAddress(aircraft);
+            }
+        });
+    return num_aircraft;
+}
+
+bool AircraftDictionary::GetAircraft(uint32_t icao_address, Aircraft &aircraft_out) const
 {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end())
+    const Aircraft *aircraft_ptr = dict.Find(icao_address);
+    if (aircraft_ptr != nullptr)
     {
-        return &(itr->second); // return address of existing aircraft
+        aircraft_out = *aircraft_ptr;
+        return true;
     }
-    else if (dict.size() < kMaxNumAircraft)
+    return false; // aircraft not found
+}
+
+bool AircraftDictionary::ContainsAircraft(uint32_t icao_address) const { return dict.Find(icao_address) != nullptr; }
+
+Aircraft *AircraftDictionary::GetAircraftPtr(uint32_t icao_address)
+{
+    bool inserted;
+    Aircraft *aircraft_ptr = FindOrInsertAircraft(icao_address, inserted);
+    if (inserted)
     {
-        Aircraft new_aircraft = Aircraft(icao_address);
-        dict[icao_address] = new_aircraft;
-        return &(dict[icao_address]); // insert new aircraft and return its address
+        *aircraft_ptr = Aircraft(icao_address);
     }
-    return nullptr; // can't find the aircraft or insert a new one
+    return aircraft_ptr;
 }
 
 /**
  * Private functions and associated helpers.
  */
 
+Aircraft *AircraftDictionary::FindOrInsertAircraft(uint32_t icao_address, bool &inserted)
+{
+    // Find and insert in one pass over the probe run.
+    Aircraft *aircraft_ptr = dict.FindOrInsert(icao_address, inserted);
+    if (aircraft_ptr == nullptr)
+    {
+        // Full. Newly seen aircraft are often the closest ones, so make room by dropping whichever aircraft has gone
+        // the longest without being heard from.
+        RemoveAircraft(dict.GetICAOAddress(*dict.GetLeastRecent()));
+        num_evictions_++;
+        aircraft_ptr = dict.FindOrInsert(icao_address, inserted);
+    }
+    return aircraft_ptr;
+}
+
+void AircraftDictionary::MarkAircraftSeen(Aircraft &aircraft, uint32_t timestamp_ms)
+{
+    aircraft.last_seen_timestamp_ms = timestamp_ms;
+    dict.Touch(aircraft);
+}
+
 /**
  * Returns the Wake Vortex value of the aircraft that sent a given ADS-B packet.
  * @param[in] packet ADS-B Packet to extract the AirframeType value from. Must be
  * @retval AirframeType that matches the combination of capability and typecode from the ADS-B packet, or
  * kAirframeTypeInvalid if there is no matching wake vortex value.
  */
-Aircraft::AirframeType ExtractAirframeType(const ADSBPacket &packet)
+Aircraft::AirframeType ExtractAirframeType(ADSBPacket packet)
 {
     if (packet.GetTypeCodeEnum() != ADSBPacket::kTypeCodeAircraftID)
     {
         return Aircraft::kAirframeTypeInvalid; // Must have typecode from 1-4.
     }
 
-    uint16_t typecode = packet.GetNBitWordFromMessage(5, 0);
-    uint16_t category = packet.GetNBitWordFromMessage(3, 5);
+    uint16_t typecode = packet.GetTypeCode();
+    uint16_t category = packet.GetMEField<ADSBPacket::AircraftIDFields::Category>();
 
     // Table 4.1 from The 1090Mhz Riddle (Junzi Sun), pg. 42.
     if (category == 0)
@@ -390,13 +569,18 @@ bool AircraftDictionary::IngestAircraftIDMessage(Aircraft &aircraft, ADSBPacket
 {
     aircraft.airframe_type = ExtractAirframeType(packet);
     aircraft.transponder_capability = packet.GetCapability();
+    // Callsign is 8 6-bit characters, MSb first.
+    uint64_t encoded_callsign =
+        (static_cast<uint64_t>(packet.GetMEField<ADSBPacket::AircraftIDFields::CallsignFirstHalf>()) << 24) |
+        packet.GetMEField<ADSBPacket::AircraftIDFields::CallsignSecondHalf>();
     for (uint16_t i = 0; i < Aircraft::kCallSignMaxNumChars; i++)
     {
-        char callsign_char = lookup_callsign_char(packet.GetNBitWordFromMessage(6, 8 + (6 * i)));
+        char callsign_char = lookup_callsign_char((encoded_callsign >> (6 * (7 - i))) & 0b111111);
         if (callsign_char == ' ')
             break; // ignore trailing spaces
         aircraft.callsign[i] = callsign_char;
     }
+    aircraft.MarkChanged(Aircraft::kChangedFieldsIdentification | Aircraft::kChangedFieldsStatus);
 
     return true;
 }
@@ -407,17 +591,21 @@ bool AircraftDictionary::IngestAirbornePositionMessage(Aircraft &aircraft, ADSBP
 {
     bool decode_successful = true;
     // ME[5-6] - Surveillance Status
-    aircraft.surveillance_status = static_cast<Aircraft::SurveillanceStatus>(packet.GetNBitWordFromMessage(2, 5));
+    aircraft.surveillance_status = static_cast<Aircraft::SurveillanceStatus>(
+        packet.GetMEField<ADSBPacket::AirbornePositionFields::SurveillanceStatus>());
 
     // ME[7] - Single Antenna Flag
-    aircraft.single_antenna_flag = packet.GetNBitWordFromMessage(1, 7) ? true : false;
+    aircraft.single_antenna_flag =
+        packet.GetMEField<ADSBPacket::AirbornePositionFields::SingleAntennaFlag>() ? true : false;
+    aircraft.MarkChanged(Aircraft::kChangedFieldsStatus | Aircraft::kChangedFieldsAltitude);
 
     // ME[8-19] - Encoded Altitude
     switch (packet.GetTypeCodeEnum())
     {
     case ADSBPacket::TypeCode::kTypeCodeAirbornePositionBaroAlt:
     {
-        uint16_t encoded_altitude_ft_with_q_bit = static_cast<uint16_t>(packet.GetNBitWordFromMessage(12, 8));
+        uint16_t encoded_altitude_ft_with_q_bit =
+            static_cast<uint16_t>(packet.GetMEField<ADSBPacket::AirbornePositionFields::EncodedAltitude>());
         if (encoded_altitude_ft_with_q_bit == 0)
         {
             aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeNotAvailable;
@@ -439,7 +627,8 @@ bool AircraftDictionary::IngestAirbornePositionMessage(Aircraft &aircraft, ADSBP
     case ADSBPacket::TypeCode::kTypeCodeAirbornePositionGNSSAlt:
     {
         aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeSourceGNSS;
-        uint16_t gnss_altitude_m = static_cast<uint16_t>(packet.GetNBitWordFromMessage(12, 8));
+        uint16_t gnss_altitude_m =
+            static_cast<uint16_t>(packet.GetMEField<ADSBPacket::AirbornePositionFields::EncodedAltitude>());
         aircraft.gnss_altitude_ft = MetersToFeet(gnss_altitude_m);
         break;
     }
@@ -454,18 +643,24 @@ bool AircraftDictionary::IngestAirbornePositionMessage(Aircraft &aircraft, ADSBP
     // TODO: figure out if we need this
 
     // ME[21] - CPR Format
-    bool odd = packet.GetNBitWordFromMessage(1, 21);
+    bool odd = packet.GetMEField<ADSBPacket::AirbornePositionFields::CPRFormat>();
 
     // ME[32-?]
-    aircraft.SetCPRLatLon(packet.GetNBitWordFromMessage(17, 22), packet.GetNBitWordFromMessage(17, 39), odd);
+    aircraft.SetCPRLatLon(packet.GetMEField<ADSBPacket::AirbornePositionFields::CPRLat>(),
+                          packet.GetMEField<ADSBPacket::AirbornePositionFields::CPRLon>(), odd);
     if (aircraft.CanDecodePosition())
     {
+        aircraft.MarkChanged(Aircraft::kChangedFieldsPosition); // Position is either updated or marked invalid.
         if (!aircraft.DecodePosition())
         {
             CONSOLE_WARNING("IngestAirbornePositionMessage: DecodePosition failed for aircraft 0x%x.\r\n",
                             aircraft.icao_address);
             decode_successful = false;
         }
+        else
+        {
+            grid_index_.Update(dict.GetPoolIndex(aircraft), aircraft.latitude_deg, aircraft.longitude_deg);
+        }
     }
 
     return decode_successful;
@@ -483,7 +678,8 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
 
     // Decode horizontal velocity.
     ADSBPacket::AirborneVelocitiesSubtype subtype =
-        static_cast<ADSBPacket::AirborneVelocitiesSubtype>(packet.GetNBitWordFromMessage(3, 5));
+        static_cast<ADSBPacket::AirborneVelocitiesSubtype>(
+            packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::Subtype>());
     bool is_supersonic = false;
     switch (subtype)
     {
@@ -493,8 +689,8 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
     case ADSBPacket::AirborneVelocitiesSubtype::kAirborneVelocitiesGroundSpeedSubsonic:
     {
         // Ground speed calculation.
-        int v_ew_kts_plus_1 = static_cast<int>(packet.GetNBitWordFromMessage(10, 14));
-        int v_ns_kts_plus_1 = static_cast<int>(packet.GetNBitWordFromMessage(10, 25));
+        int v_ew_kts_plus_1 = static_cast<int>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::VelocityEW>());
+        int v_ns_kts_plus_1 = static_cast<int>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::VelocityNS>());
         if (v_ew_kts_plus_1 == 0 || v_ns_kts_plus_1 == 0)
         {
             aircraft.velocity_source = Aircraft::VelocitySource::kVelocityNotAvailable;
@@ -507,9 +703,11 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
         else
         {
             aircraft.velocity_source = Aircraft::VelocitySource::kVelocitySourceGroundSpeed;
-            bool direction_is_east_to_west = static_cast<bool>(packet.GetNBitWordFromMessage(1, 13));
+            bool direction_is_east_to_west =
+                static_cast<bool>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::DirectionEW>());
             int v_x_kts = (v_ew_kts_plus_1 - 1) * (direction_is_east_to_west ? -1 : 1);
-            bool direction_is_north_to_south = static_cast<bool>(packet.GetNBitWordFromMessage(1, 24));
+            bool direction_is_north_to_south =
+                static_cast<bool>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::DirectionNS>());
             int v_y_kts = (v_ns_kts_plus_1 - 1) * (direction_is_north_to_south ? -1 : 1);
             if (is_supersonic)
             {
@@ -528,7 +726,7 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
     }
     case ADSBPacket::AirborneVelocitiesSubtype::kAirborneVelocitiesAirspeedSubsonic:
     {
-        int airspeed_kts_plus_1 = static_cast<int>(packet.GetNBitWordFromMessage(10, 25));
+        int airspeed_kts_plus_1 = static_cast<int>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::Airspeed>());
         if (airspeed_kts_plus_1 == 0)
         {
             CONSOLE_WARNING(
@@ -540,11 +738,13 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
         else
         {
             aircraft.velocity_kts = (airspeed_kts_plus_1 - 1) * (is_supersonic ? 4 : 1);
-            bool is_true_airspeed = static_cast<bool>(packet.GetNBitWordFromMessage(1, 24));
+            bool is_true_airspeed =
+                static_cast<bool>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::AirspeedType>());
             aircraft.velocity_source = is_true_airspeed
                                            ? Aircraft::VelocitySource::kVelocitySourceAirspeedTrue
                                            : Aircraft::VelocitySource::kVelocitySourceSirspeedIndicated;
-            aircraft.heading_deg = static_cast<float>((packet.GetNBitWordFromMessage(10, 14) * 360) / 1024.0f);
+            aircraft.heading_deg = static_cast<float>(
+                (packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::Heading>() * 360) / 1024.0f);
         }
 
         break;
@@ -557,8 +757,10 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
         return false; // Don't attempt vertical rate decode if message type is invalid.
     }
 
+    aircraft.MarkChanged(Aircraft::kChangedFieldsVelocity);
+
     // Decode vertical rate.
-    int vertical_rate_magnitude_fpm = packet.GetNBitWordFromMessage(9, 37);
+    int vertical_rate_magnitude_fpm = packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::VerticalRate>();
     if (vertical_rate_magnitude_fpm == 0)
     {
         aircraft.vertical_rate_source = Aircraft::VerticalRateSource::kVerticalRateNotAvailable;
@@ -570,8 +772,10 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
     }
     else
     {
-        aircraft.vertical_rate_source = static_cast<Aircraft::VerticalRateSource>(packet.GetNBitWordFromMessage(1, 35));
-        bool vertical_rate_sign_is_negative = packet.GetNBitWordFromMessage(1, 36);
+        aircraft.vertical_rate_source = static_cast<Aircraft::VerticalRateSource>(
+            packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::VerticalRateSource>());
+        bool vertical_rate_sign_is_negative =
+            packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::VerticalRateSign>();
         if (vertical_rate_sign_is_negative)
         {
             aircraft.vertical_rate_fpm = -(vertical_rate_magnitude_fpm - 1) * 64;
@@ -583,8 +787,10 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
     }
 
     // Decode altitude difference between GNSS and barometric altitude.
-    bool gnss_alt_below_baro_alt = static_cast<bool>(packet.GetNBitWordFromMessage(1, 48));
-    uint16_t encoded_gnss_alt_baro_alt_difference_ft = static_cast<uint16_t>(packet.GetNBitWordFromMessage(7, 49));
+    bool gnss_alt_below_baro_alt =
+        static_cast<bool>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::GNSSBaroAltDifferenceSign>());
+    uint16_t encoded_gnss_alt_baro_alt_difference_ft =
+        static_cast<uint16_t>(packet.GetMEField<ADSBPacket::AirborneVelocitiesFields::GNSSBaroAltDifference>());
     if (encoded_gnss_alt_baro_alt_difference_ft == 0)
     {
         CONSOLE_WARNING(
@@ -601,9 +807,11 @@ bool AircraftDictionary::IngestAirborneVelocitiesMessage(Aircraft &aircraft, ADS
         {
         case Aircraft::AltitudeSource::kAltitudeSourceBaro:
             aircraft.gnss_altitude_ft = aircraft.baro_altitude_ft + gnss_alt_baro_alt_difference_ft;
+            aircraft.MarkChanged(Aircraft::kChangedFieldsAltitude);
             break;
         case Aircraft::AltitudeSource::kAltitudeSourceGNSS:
             aircraft.baro_altitude_ft = aircraft.gnss_altitude_ft - gnss_alt_baro_alt_difference_ft;
+            aircraft.MarkChanged(Aircraft::kChangedFieldsAltitude);
             break;
         default:
             // Don't sweat it if the aircraft doesn't have an altitude yet.
@@ -618,4 +826,43 @@ bool AircraftDictionary::IngestAircraftStatusMessage(Aircraft &aircraft, ADSBPac
 
 bool AircraftDictionary::IngestTargetStateAndStatusInfoMessage(Aircraft &aircraft, ADSBPacket packet) { return false; }
 
-bool AircraftDictionary::IngestAircraftOperationStatusMessage(Aircraft &aircraft, ADSBPacket packet) { return false; }
\ No newline at end of file
+bool AircraftDictionary::IngestAircraftOperationStatusMessage(Aircraft &aircraft, ADSBPacket packet) { return false; }
+
+bool AircraftDictionary::IngestModeSAltitude(Aircraft &aircraft, const TransponderPacket &packet)
+{
+    // Bits 20-32 [13]: Altitude Code (AC). See The 1090MHz Riddle (Junzi Sun) pg. 96.
+    uint16_t altitude_code = get_n_bit_word_from_buffer<19, 13>(packet.GetPacketBuffer());
+    if (altitude_code == 0)
+    {
+        return false; // Altitude not available.
+    }
+    bool m_bit = altitude_code & 0b0000001000000;
+    bool q_bit = altitude_code & 0b0000000010000;
+    if (m_bit || !q_bit)
+    {
+        // FIXME: Metric altitudes and altitudes encoded in 100ft increments with Gillham code are not supported.
+        return false;
+    }
+    // Remove M and Q bits.
+    uint16_t encoded_altitude_ft =
+        ((altitude_code & 0b1111110000000) >> 2) | ((altitude_code & 0b0000000100000) >> 1) | (altitude_code & 0b1111);
+    aircraft.baro_altitude_ft = (encoded_altitude_ft * 25) - 1000;
+    aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeSourceBaro;
+    aircraft.MarkChanged(Aircraft::kChangedFieldsAltitude);
+    return true;
+}
+
+bool AircraftDictionary::IngestModeSIdentity(Aircraft &aircraft, const TransponderPacket &packet)
+{
+    // Bits 20-32 [13]: Identity Code (ID), bit order C1 A1 C2 A2 C4 A4 X B1 D1 B2 D2 B4 D4. See The 1090MHz Riddle
+    // (Junzi Sun) pg. 97.
+    uint16_t identity_code = get_n_bit_word_from_buffer<19, 13>(packet.GetPacketBuffer());
+    auto bit = [identity_code](uint16_t index) -> uint16_t { return (identity_code >> (12 - index)) & 0b1; };
+    uint16_t a = (bit(5) << 2) | (bit(3) << 1) | bit(1);
+    uint16_t b = (bit(11) << 2) | (bit(9) << 1) | bit(7);
+    uint16_t c = (bit(4) << 2) | (bit(2) << 1) | bit(0);
+    uint16_t d = (bit(12) << 2) | (bit(10) << 1) | bit(8);
+    aircraft.squawk = a * 1000 + b * 100 + c * 10 + d;
+    aircraft.MarkChanged(Aircraft::kChangedFieldsSquawk);
+    return true;
+}
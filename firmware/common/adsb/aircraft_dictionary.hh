@@ -2,16 +2,39 @@
 #define _AIRCRAFT_DICTIONARY_HH_
 
 #include <cstring>
-#include <unordered_map>
 
 #include "adsb_packet.hh"
+#include "grid_index.hh"
+#include "icao_confidence_set.hh"
+#include "icao_table.hh"
+
+// Memory set aside for tracked aircraft, which sets how many aircraft the dictionary can hold. Can be overridden at
+// build time.
+#ifndef AIRCRAFT_DICTIONARY_MEMORY_BUDGET_BYTES
+#define AIRCRAFT_DICTIONARY_MEMORY_BUDGET_BYTES 32768
+#endif
 
 class Aircraft
 {
 public:
     static const uint16_t kCallSignMaxNumChars = 8;
+    // Number of consumers (e.g. reporters on different interfaces) that can track changes to aircraft independently.
+    static const uint16_t kMaxNumChangeConsumers = 4;
 
-    enum AirframeType : uint16_t
+    // Groups of fields that change consumers are told about. See AircraftDictionary::GetNextChangedAircraft.
+    enum ChangedFields : uint8_t
+    {
+        kChangedFieldsNone = 0,
+        kChangedFieldsIdentification = 1 << 0, // callsign, airframe_type
+        kChangedFieldsPosition = 1 << 1,       // latitude_deg, longitude_deg, position_valid
+        kChangedFieldsAltitude = 1 << 2,       // baro_altitude_ft, gnss_altitude_ft, altitude_source
+        kChangedFieldsVelocity = 1 << 3,       // heading_deg, velocity_kts, vertical_rate_fpm, and their sources
+        kChangedFieldsSquawk = 1 << 4,
+        kChangedFieldsStatus = 1 << 5, // transponder_capability, surveillance_status, single_antenna_flag, is_airborne
+        kChangedFieldsAll = 0xFF
+    };
+
+    enum AirframeType : uint8_t
     {
         kAirframeTypeInvalid = 0,
         kAirframeTypeReserved,
@@ -34,7 +57,7 @@ public:
         kAirframeTypeRotorcraft
     };
 
-    enum SurveillanceStatus : int16_t
+    enum SurveillanceStatus : int8_t
     {
         kSurveillanceStatusNotSet = -1,
         kSurveillanceStatusNoCondition = 0,
@@ -43,7 +66,7 @@ public:
         kSurveillanceStatusSPICondition = 3
     };
 
-    enum AltitudeSource : int16_t
+    enum AltitudeSource : int8_t
     {
         kAltitudeNotAvailable = -2,
         kAltitudeSourceNotSet = -1,
@@ -51,7 +74,7 @@ public:
         kAltitudeSourceGNSS = 1
     };
 
-    enum VerticalRateSource : int16_t
+    enum VerticalRateSource : int8_t
     {
         kVerticalRateNotAvailable = -2,
         kVerticalRateSourceNotSet = -1,
@@ -59,7 +82,7 @@ public:
         kVerticalRateSourceBaro = 1
     };
 
-    enum VelocitySource : int16_t
+    enum VelocitySource : int8_t
     {
         kVelocityNotAvailable = -2,
         kVelocitySourceNotSet = -1,
@@ -68,37 +91,60 @@ public:
         kVelocitySourceSirspeedIndicated = 2
     };
 
+    // Fields are ordered from hot to cold, and sized so that the compiler doesn't need to pad between them. Hot fields
+    // are refreshed by most packets and read by every report.
     uint32_t last_seen_timestamp_ms = 0;
-
-    uint16_t transponder_capability = 0;
     uint32_t icao_address = 0;
-    char callsign[kCallSignMaxNumChars + 1] = "?"; // put extra EOS character at end
-    AirframeType airframe_type = kAirframeTypeInvalid;
-
-    SurveillanceStatus surveillance_status = kSurveillanceStatusNotSet;
-    bool single_antenna_flag = false;
-    uint32_t baro_altitude_ft = 0;
-    uint32_t gnss_altitude_ft = 0;
-    AltitudeSource altitude_source = kAltitudeSourceNotSet;
 
     // Airborne Position Message
     float latitude_deg = 0.0f;
     float longitude_deg = 0.0f;
-    bool position_valid = false;
-    bool is_airborne =
-        true; // assume that most aircraft encountered will be airborne, so put them there until proven otherwise
+    uint32_t baro_altitude_ft = 0;
+    uint32_t gnss_altitude_ft = 0;
 
     // Airborne Velocities Message
     float heading_deg = 0.0f;
     float velocity_kts = 0;
-    VelocitySource velocity_source = kVelocitySourceNotSet;
     int vertical_rate_fpm = 0.0f;
-    VerticalRateSource vertical_rate_source = kVerticalRateSourceNotSet;
     int altitude_difference_gnss_above_baro_ft = 0;
 
+    uint16_t squawk = 0; // Mode A identity code, 4 octal digits written out in decimal (e.g. 7700).
+    AltitudeSource altitude_source = kAltitudeSourceNotSet;
+    VelocitySource velocity_source = kVelocitySourceNotSet;
+    VerticalRateSource vertical_rate_source = kVerticalRateSourceNotSet;
+    bool position_valid = false;
+    bool is_airborne =
+        true; // assume that most aircraft encountered will be airborne, so put them there until proven otherwise
+
+    // Cold fields, which rarely change after the first few packets from an aircraft.
+    char callsign[kCallSignMaxNumChars + 1] = "?"; // put extra EOS character at end
+    AirframeType airframe_type = kAirframeTypeInvalid;
+    SurveillanceStatus surveillance_status = kSurveillanceStatusNotSet;
+    uint8_t transponder_capability = 0;
+    bool single_antenna_flag = false;
+
+    // ChangedFields bitmask for each change consumer, with the groups of fields that have changed since that consumer
+    // last looked at this aircraft. New aircraft start out with everything changed.
+    uint8_t changed_fields[kMaxNumChangeConsumers];
+    // ChangedFields bitmask of the groups of fields that have been filled in from a packet at least once.
+    uint8_t received_fields = kChangedFieldsNone;
+
     Aircraft(uint32_t icao_address_in);
     Aircraft();
 
+    /**
+     * Flags groups of fields as changed for every change consumer.
+     * @param[in] fields ChangedFields bitmask of the groups of fields that changed.
+     */
+    void MarkChanged(uint8_t fields)
+    {
+        for (uint16_t i = 0; i < kMaxNumChangeConsumers; i++)
+        {
+            changed_fields[i] |= fields;
+        }
+        received_fields |= fields;
+    }
+
     /**
      * Set an aircraft's position in Compact Position Reporting (CPR) format. Takes either an even or odd set of lat/lon
      * coordinates and uses them to set the aircraft's position.
@@ -130,26 +176,23 @@ public:
     bool DecodePosition();
 
 private:
+    // CPR decoding state, only used while ingesting position messages.
     struct CPRPacket
     {
-        // SetCPRLatLon values.
         uint32_t received_timestamp_ms = 0; // [ms] time since boot when packet was recorded
-        uint32_t n_lat = 0;                 // 17-bit latitude count
-        uint32_t n_lon = 0;                 // 17-bit longitude count
-
-        // DecodePosition values.
-        uint32_t calculated_timestamp_ms = 0; // [ms] time since boot when packet was calculated
-        float lat_cpr = 0.0f;
-        float lon_cpr = 0.0f;
-        uint16_t nl_cpr = 0; // number of longitude cells in latitude band
-        float lat =
-            0.0f; // only keep latitude since it's reused in cooperative calculations between odd and even packets
-        // float lon = 0.0f; // longitude
+        float lat = 0.0f; // only keep latitude, since it's reused in calculations between odd and even packets
+        uint32_t n_lat : 17 = 0; // 17-bit latitude count
+        uint32_t nl_cpr : 7 = 0; // number of longitude cells in latitude band, at most 59
+        uint32_t lat_calculated : 1 = 0; // lat and nl_cpr have been calculated since n_lat was last set
+        uint32_t n_lon : 17 = 0; // 17-bit longitude count
     };
+    static_assert(sizeof(CPRPacket) == 16, "CPRPacket counts should be packed into bit fields.");
 
     CPRPacket last_odd_packet_;
     CPRPacket last_even_packet_;
 };
+// Aircraft are stored in the aircraft dictionary and sent to the ESP32 in bulk, so every byte counts.
+static_assert(sizeof(Aircraft) <= 96, "Aircraft has grown, check for padding between fields.");
 
 class AircraftDictionary
 {
@@ -158,7 +201,26 @@ public:
     {
         uint32_t aircraft_prune_interval_ms = 60e3;
     };
-    static const uint16_t kMaxNumAircraft = 100;
+
+    // Area to search for aircraft in. See FindAircraftInRange.
+    struct AircraftRangeQuery
+    {
+        float latitude_deg = 0.0f;  // Center of the search area.
+        float longitude_deg = 0.0f; // Center of the search area.
+        float radius_km = 0.0f;     // Horizontal distance from the center.
+        // Altitude band. Aircraft without an altitude are only included if the band is left unbounded.
+        int32_t min_altitude_ft = INT32_MIN;
+        int32_t max_altitude_ft = INT32_MAX;
+    };
+
+    // Position of a change consumer in its walk through the dictionary. See GetNextChangedAircraft.
+    struct ChangeCursor
+    {
+        uint16_t consumer_id = 0; // Index into Aircraft::changed_fields, unique to each consumer.
+        uint16_t pool_index = 0;  // Where to pick up the walk from.
+    };
+    static constexpr uint16_t kMaxNumAircraft =
+        icao_table_capacity_for_budget<Aircraft>(AIRCRAFT_DICTIONARY_MEMORY_BUDGET_BYTES);
 
     /**
      * Default constructor. Uses default config values.
@@ -171,13 +233,76 @@ public:
     AircraftDictionary(AircraftDictionaryConfig_t config_in) : config_(config_in){};
 
     void Init();
-    void Update(uint32_t timestamp_us);
 
+    /**
+     * Removes aircraft that haven't been seen for longer than aircraft_prune_interval_ms. Aircraft are kept in order of
+     * when they were last seen, so this only visits the aircraft that are removed, plus one.
+     * @param[in] timestamp_ms Current time, in milliseconds.
+     */
+    void Update(uint32_t timestamp_ms);
+
+    /**
+     * Updates the aircraft dictionary with the contents of a DF17 extended squitter.
+     * @param[in] packet ADSBPacket to ingest. This is a lightweight view into the packet buffer of a TransponderPacket,
+     * so it's passed by value all the way through the ingestion helpers.
+     * @retval True if the packet was ingested successfully, false otherwise.
+     */
     bool IngestADSBPacket(ADSBPacket packet);
+
+    /**
+     * Verifies a transponder packet of any supported downlink format and uses it to update the dictionary. CRC-clean
+     * DF11/17/18 packets mark their ICAO address as trusted. Packets with Address/Parity (DF0/4/5/16/20/21) are only
+     * accepted if the ICAO address recovered from their parity field is trusted. Decode failures within a verified
+     * packet are logged by the ingestion helpers but don't cause the packet to be rejected.
+     * @param[in] packet TransponderPacket to verify and ingest.
+     * @retval True if the packet was verified and applied to the dictionary, false if it couldn't be verified.
+     */
+    bool IngestTransponderPacket(const TransponderPacket &packet);
+
     uint16_t GetNumAircraft();
 
     /**
-     * Adds an Aircraft object to the aircraft dictionary, hashed by ICAO address.
+     * Finds the next aircraft with changes that a change consumer hasn't seen yet, copies it out, and clears its
+     * changes for that consumer. Aircraft are visited in storage order, which doesn't change as aircraft are added,
+     * seen, and removed, so the dictionary can be unlocked between calls. Aircraft that change again behind the cursor
+     * are picked up on the next pass.
+     * @param[inout] cursor Change consumer's cursor. Rewound to the start of the dictionary once a pass is complete.
+     * @param[out] aircraft_out Copy of the changed aircraft.
+     * @param[out] changed_fields ChangedFields bitmask of the groups of fields that changed.
+     * @retval True if a changed aircraft was found, false if there were no more changed aircraft in this pass.
+     */
+    bool GetNextChangedAircraft(ChangeCursor &cursor, Aircraft &aircraft_out, uint8_t &changed_fields);
+
+    /**
+     * Same as above, for change consumers that only need the changed aircraft and not which of its fields changed.
+     */
+    bool GetNextChangedAircraft(ChangeCursor &cursor, Aircraft &aircraft_out)
+    {
+        uint8_t changed_fields;
+        return GetNextChangedAircraft(cursor, aircraft_out, changed_fields);
+    }
+
+    /**
+     * Finds the aircraft with a valid position within a horizontal distance of a point, and optionally within a band
+     * of altitudes. Aircraft are indexed by position whenever a new position is decoded, so this only visits the
+     * aircraft in the grid cells that overlap the search area.
+     * @param[in] query Area to search.
+     * @param[out] icao_addresses_out Array to fill with the ICAO addresses of the aircraft that were found.
+     * @param[in] max_num_aircraft Maximum number of ICAO addresses to write to icao_addresses_out.
+     * @retval Number of aircraft found, up to max_num_aircraft.
+     */
+    uint16_t FindAircraftInRange(const AircraftRangeQuery &query, uint32_t icao_addresses_out[],
+                                 uint16_t max_num_aircraft);
+
+    /**
+     * Returns the number of aircraft that were evicted to make room for new ones because the dictionary was full.
+     */
+    uint32_t GetNumEvictions() const { return num_evictions_; }
+
+    /**
+     * Adds an Aircraft object to the aircraft dictionary, hashed by ICAO address. If the dictionary is full, the least
+     * recently seen aircraft is evicted to make room. The aircraft counts as the most recently seen one for pruning,
+     * regardless of its last_seen_timestamp_ms.
      * @param[in] aircraft Aircraft to insert.
      * @retval True if insertaion succeeded, false if failed.
      */
@@ -206,13 +331,17 @@ public:
     bool ContainsAircraft(uint32_t icao_address) const;
 
     /**
-     * Return a pointer to an aircraft if it's in the aircraft dictionary.
+     * Return a pointer to an aircraft, inserting it if it's not in the aircraft dictionary yet. New aircraft count as
+     * the most recently seen one. If the dictionary is full, the least recently seen aircraft is evicted to make room.
      * @param[in] icao_address ICAO address of the aircraft to find.
-     * @retval Pointer to the aircraft if it exists, or NULL if it wasn't in the dictionary.
+     * @retval Pointer to the aircraft.
      */
     Aircraft *GetAircraftPtr(uint32_t icao_address);
 
-    std::unordered_map<uint32_t, Aircraft> dict; // index Aircraft objects by their ICAO identifier
+    // Aircraft indexed by ICAO address, ordered from most to least recently seen. Statically allocated, so ingesting
+    // packets never touches the heap.
+    ICAOTable<Aircraft, kMaxNumAircraft> dict;
+    static_assert(sizeof(dict) <= AIRCRAFT_DICTIONARY_MEMORY_BUDGET_BYTES, "Aircraft dictionary is over its budget.");
 
 private:
     // Helper functions for ingesting specific ADS-B packet types, called by IngestADSBPacket.
@@ -236,7 +365,33 @@ private:
     bool IngestTargetStateAndStatusInfoMessage(Aircraft &aircraft, ADSBPacket packet);
     bool IngestAircraftOperationStatusMessage(Aircraft &aircraft, ADSBPacket packet);
 
+    // Helper functions for ingesting fields from Mode S surveillance replies, called by IngestTransponderPacket.
+    bool IngestModeSAltitude(Aircraft &aircraft, const TransponderPacket &packet);
+    bool IngestModeSIdentity(Aircraft &aircraft, const TransponderPacket &packet);
+
+    /**
+     * Finds an aircraft, or adds it and evicts the least recently seen aircraft if there's no room.
+     * @param[in] icao_address ICAO address of the aircraft.
+     * @param[out] inserted Set to true if the aircraft was added, false if it was already in the dictionary.
+     * @retval Pointer to the aircraft.
+     */
+    Aircraft *FindOrInsertAircraft(uint32_t icao_address, bool &inserted);
+
+    /**
+     * Refreshes an aircraft's last seen time and moves it to the most recent end of dict, which keeps dict sorted by
+     * last seen time for pruning.
+     * @param[in] aircraft Aircraft in dict.
+     * @param[in] timestamp_ms Time that the aircraft was seen, in milliseconds.
+     */
+    void MarkAircraftSeen(Aircraft &aircraft, uint32_t timestamp_ms);
+
     AircraftDictionaryConfig_t config_;
+    // ICAO addresses stay trusted for as long as their aircraft would stay in the dictionary.
+    ICAOConfidenceSet icao_confidence_set_ = ICAOConfidenceSet({.ttl_ms = config_.aircraft_prune_interval_ms});
+
+    uint32_t num_evictions_ = 0;
+    // Aircraft with a decoded position, by position in dict.
+    GridIndex<kMaxNumAircraft> grid_index_;
 };
 
 #endif /* _AIRCRAFT_DICTIONARY_HH_ */
\ No newline at end of file
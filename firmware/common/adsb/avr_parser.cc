@@ -0,0 +1,166 @@
+#include "avr_parser.hh"
+
+#include <cstring> // For memchr.
+
+// Value of each hex digit character, or kHexInvalid for characters that aren't hex digits. OR-ing together the table
+// values for a run of characters validates all of them at once, without branching on each character.
+static const uint8_t kHexInvalid = 0x80;
+struct HexTable
+{
+    uint8_t value[256];
+};
+
+static constexpr HexTable GenerateHexTable()
+{
+    HexTable table = {};
+    for (uint16_t c = 0; c < 256; c++)
+    {
+        table.value[c] = kHexInvalid;
+    }
+    for (uint16_t i = 0; i < 10; i++)
+    {
+        table.value['0' + i] = i;
+    }
+    for (uint16_t i = 0; i < 6; i++)
+    {
+        table.value['A' + i] = 10 + i;
+        table.value['a' + i] = 10 + i;
+    }
+    return table;
+}
+
+static constexpr HexTable kHexTable = GenerateHexTable();
+static_assert(kHexTable.value['f'] == 0xF && kHexTable.value['g'] == kHexInvalid);
+
+/**
+ * Decodes a run of hex digits into the top bits of a word, MSB first. Length is fixed at compile time so that the loop
+ * unrolls into straight-line table lookups.
+ * @param[in] chars Characters to decode.
+ * @param[inout] invalid Accumulates kHexInvalid if any character isn't a hex digit.
+ * @retval Decoded word, left-aligned.
+ */
+template <uint16_t NumNibbles>
+static inline uint32_t decode_hex_word(const char chars[], uint8_t &invalid)
+{
+    static_assert(NumNibbles <= 8, "Can't fit more than 8 nibbles in a word.");
+    uint32_t word = 0;
+    for (uint16_t i = 0; i < NumNibbles; i++)
+    {
+        uint8_t nibble = kHexTable.value[static_cast<uint8_t>(chars[i])];
+        invalid |= nibble;
+        word = (word << 4) | (nibble & 0xF);
+    }
+    return word << (32 - 4 * NumNibbles);
+}
+
+static inline bool is_line_padding(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ';'; }
+
+uint32_t AVRParser::Parse(const char buffer[], uint32_t buffer_len, RawTransponderPacket packets_out[],
+                          uint16_t max_num_packets, uint16_t &num_packets, bool end_of_stream)
+{
+    num_packets = 0;
+    uint32_t line_start = 0;
+    while (line_start < buffer_len && num_packets < max_num_packets)
+    {
+        uint32_t num_chars_remaining = buffer_len - line_start;
+        const char *newline = static_cast<const char *>(memchr(buffer + line_start, '\n', num_chars_remaining));
+        uint32_t line_len;
+        if (newline != nullptr)
+        {
+            line_len = newline - (buffer + line_start);
+        }
+        else if (end_of_stream || num_chars_remaining > kMaxLineLenChars)
+        {
+            // Last line in the stream, or a line that's too long to ever be valid. Don't make the caller carry it.
+            line_len = num_chars_remaining;
+        }
+        else
+        {
+            break; // Partial line, wait for the rest of it.
+        }
+
+        if (ParseLine(buffer + line_start, line_len, packets_out[num_packets]))
+        {
+            num_packets++;
+        }
+        line_start += newline != nullptr ? line_len + 1 : line_len;
+    }
+    return line_start;
+}
+
+bool AVRParser::ParseLine(const char line[], uint32_t line_len, RawTransponderPacket &packet)
+{
+    // Trim whitespace, line endings, and AVR terminators from both ends.
+    uint32_t start = 0;
+    uint32_t end = line_len;
+    while (start < end && is_line_padding(line[start]))
+    {
+        start++;
+    }
+    while (end > start && is_line_padding(line[end - 1]))
+    {
+        end--;
+    }
+    if (start == end)
+    {
+        return false; // Blank lines aren't malformed.
+    }
+
+    uint64_t mlat_12mhz_counts = 0;
+    uint8_t invalid = 0;
+    if (line[start] == '*')
+    {
+        start++;
+    }
+    else if (line[start] == '@')
+    {
+        start++;
+        if (end - start < kMLATNumNibbles)
+        {
+            num_malformed_lines_++;
+            return false;
+        }
+        // 12 nibbles, split across two words to reuse the word decoder.
+        mlat_12mhz_counts = (static_cast<uint64_t>(decode_hex_word<8>(line + start, invalid)) << 16) |
+                            (decode_hex_word<4>(line + start + 8, invalid) >> 16);
+        start += kMLATNumNibbles;
+    }
+
+    uint32_t num_nibbles = end - start;
+    if (num_nibbles != TransponderPacket::kSquitterPacketNumBits / 4 &&
+        num_nibbles != TransponderPacket::kExtendedSquitterPacketLenBits / 4)
+    {
+        num_malformed_lines_++;
+        return false;
+    }
+
+    const char *chars = line + start;
+    uint32_t buffer[RawTransponderPacket::kMaxPacketLenWords32] = {0};
+    if (num_nibbles == TransponderPacket::kSquitterPacketNumBits / 4)
+    {
+        buffer[0] = decode_hex_word<8>(chars, invalid);
+        buffer[1] = decode_hex_word<6>(chars + 8, invalid);
+    }
+    else
+    {
+        buffer[0] = decode_hex_word<8>(chars, invalid);
+        buffer[1] = decode_hex_word<8>(chars + 8, invalid);
+        buffer[2] = decode_hex_word<8>(chars + 16, invalid);
+        buffer[3] = decode_hex_word<4>(chars + 24, invalid);
+    }
+    if (invalid & kHexInvalid)
+    {
+        num_malformed_lines_++;
+        return false;
+    }
+
+    packet = RawTransponderPacket();
+    for (uint16_t i = 0; i < RawTransponderPacket::kMaxPacketLenWords32; i++)
+    {
+        packet.buffer[i] = buffer[i];
+    }
+    packet.buffer_len_bits = num_nibbles * 4;
+    packet.mlat_12mhz_counts = mlat_12mhz_counts;
+    num_packets_++;
+    return true;
+}
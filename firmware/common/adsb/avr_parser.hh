@@ -0,0 +1,61 @@
+#ifndef _AVR_PARSER_HH_
+#define _AVR_PARSER_HH_
+
+#include <cstdint>
+
+#include "adsb_packet.hh"
+
+/**
+ * Streaming parser for text capture logs with one Mode S frame per line. Accepts the following line formats:
+ *   AVR:                  *8D4840D6202CC371C32CE0576098;
+ *   Timestamped AVR:      @0000002B6C5A8D4840D6202CC371C32CE0576098;  (48-bit 12MHz MLAT counter, then the frame)
+ *   Bare hex:             8D4840D6202CC371C32CE0576098
+ * Lines may end with \n or \r\n, and the trailing ';' is optional. Blank lines are skipped, and any other line that
+ * isn't a 56-bit or 112-bit frame is skipped and counted as malformed.
+ */
+class AVRParser
+{
+public:
+    static const uint16_t kMaxLineLenChars = 64; // Longest line that could be valid, with some room for whitespace.
+    static const uint16_t kMLATNumNibbles = 12;  // 48-bit MLAT counter in timestamped AVR lines.
+
+    /**
+     * Parses as many complete lines as possible from a buffer. Lines are parsed in place, so the buffer can be an
+     * mmapped file or a chunk read from a stream. A partial line at the end of the buffer is left unconsumed so that
+     * the caller can carry it over to the start of the next chunk.
+     * @param[in] buffer Characters to parse.
+     * @param[in] buffer_len Number of characters in buffer.
+     * @param[out] packets_out Array to fill with parsed packets.
+     * @param[in] max_num_packets Size of packets_out. Parsing stops early if it fills up.
+     * @param[out] num_packets Number of packets written to packets_out.
+     * @param[in] end_of_stream Set to true if there is no more data after this buffer, so that a last line without a
+     * line ending gets parsed too.
+     * @retval Number of characters consumed from the start of buffer.
+     */
+    uint32_t Parse(const char buffer[], uint32_t buffer_len, RawTransponderPacket packets_out[],
+                   uint16_t max_num_packets, uint16_t &num_packets, bool end_of_stream = false);
+
+    /**
+     * Parses a single line.
+     * @param[in] line Characters in the line, with or without the line ending.
+     * @param[in] line_len Number of characters in the line.
+     * @param[out] packet RawTransponderPacket to fill if the line holds a valid frame.
+     * @retval True if a packet was parsed, false if the line was blank or malformed.
+     */
+    bool ParseLine(const char line[], uint32_t line_len, RawTransponderPacket &packet);
+
+    uint32_t GetNumPackets() const { return num_packets_; }
+    uint32_t GetNumMalformedLines() const { return num_malformed_lines_; }
+
+    void ResetCounters()
+    {
+        num_packets_ = 0;
+        num_malformed_lines_ = 0;
+    }
+
+private:
+    uint32_t num_packets_ = 0;
+    uint32_t num_malformed_lines_ = 0;
+};
+
+#endif /* _AVR_PARSER_HH_ */
@@ -0,0 +1,187 @@
+#include "crc.hh"
+
+#include <algorithm> // For std::sort, std::lower_bound.
+
+/**
+ * Builds the slice-by-4 CRC-24 lookup tables at compile time. Table 0 is the CRC of each possible byte value, and each
+ * following table pushes the previous one through another zero byte.
+ */
+static constexpr CRC24Tables GenerateCRC24Tables()
+{
+    CRC24Tables tables = {};
+    for (uint32_t byte = 0; byte < 256; byte++)
+    {
+        uint32_t crc = byte << 16;
+        for (uint16_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x800000) ? (crc << 1) ^ kCRC24Generator : crc << 1;
+        }
+        tables.table[0][byte] = crc & kCRC24Mask;
+    }
+    for (uint16_t k = 1; k < kCRC24NumTables; k++)
+    {
+        for (uint32_t byte = 0; byte < 256; byte++)
+        {
+            uint32_t crc = tables.table[k - 1][byte];
+            tables.table[k][byte] = ((crc << 8) & kCRC24Mask) ^ tables.table[0][crc >> 16];
+        }
+    }
+    return tables;
+}
+
+constexpr CRC24Tables kCRC24Tables = GenerateCRC24Tables();
+static_assert(kCRC24Tables.table[0][1] == (kCRC24Generator & kCRC24Mask));
+
+uint32_t crc24(const uint32_t buffer[], uint16_t num_bits)
+{
+    uint32_t crc = 0;
+    uint16_t num_words = num_bits / 32;
+    for (uint16_t i = 0; i < num_words; i++)
+    {
+        crc = crc24_word(crc, buffer[i]);
+    }
+    // Finish off any remaining bytes in a partially filled word.
+    uint16_t num_tail_bytes = (num_bits % 32) / 8;
+    for (uint16_t i = 0; i < num_tail_bytes; i++)
+    {
+        crc = crc24_byte(crc, buffer[num_words] >> (24 - 8 * i));
+    }
+    return crc;
+}
+
+uint32_t crc24(const uint8_t buffer[], uint16_t num_bytes)
+{
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < num_bytes; i++)
+    {
+        crc = crc24_byte(crc, buffer[i]);
+    }
+    return crc;
+}
+
+struct CRC24SyndromeEntry
+{
+    uint32_t syndrome;
+    uint8_t bit_index_a;
+    uint8_t bit_index_b; // Unused for single-bit syndromes.
+};
+
+const uint16_t kCRC24NumSingleBitSyndromes = kCRC24SyndromeMessageLenBits;
+const uint16_t kCRC24NumTwoBitSyndromes = kCRC24SyndromeMessageLenBits * (kCRC24SyndromeMessageLenBits - 1) / 2;
+
+struct CRC24SyndromeTables
+{
+    CRC24SyndromeEntry single_bit[kCRC24NumSingleBitSyndromes];
+    CRC24SyndromeEntry two_bit[kCRC24NumTwoBitSyndromes];
+};
+
+/**
+ * Builds sorted tables of the syndromes for every single-bit and two-bit error in a 112-bit message. Flipping bit i
+ * adds x^(111-i) to the message polynomial, so the syndrome of bit i is x^(111-i) mod G, and two-bit syndromes are
+ * the XOR of two single-bit syndromes.
+ */
+static constexpr CRC24SyndromeTables GenerateCRC24SyndromeTables()
+{
+    CRC24SyndromeTables tables = {};
+    uint32_t syndrome = 1; // Last parity bit.
+    for (int16_t i = kCRC24SyndromeMessageLenBits - 1; i >= 0; i--)
+    {
+        tables.single_bit[i] = {.syndrome = syndrome, .bit_index_a = static_cast<uint8_t>(i), .bit_index_b = 0};
+        syndrome <<= 1;
+        if (syndrome & (0b1 << 24))
+        {
+            syndrome ^= kCRC24Generator;
+        }
+    }
+    uint16_t num_two_bit = 0;
+    for (uint16_t a = 0; a < kCRC24SyndromeMessageLenBits; a++)
+    {
+        for (uint16_t b = a + 1; b < kCRC24SyndromeMessageLenBits; b++)
+        {
+            tables.two_bit[num_two_bit++] = {.syndrome = tables.single_bit[a].syndrome ^ tables.single_bit[b].syndrome,
+                                             .bit_index_a = static_cast<uint8_t>(a),
+                                             .bit_index_b = static_cast<uint8_t>(b)};
+        }
+    }
+    auto syndrome_less = [](const CRC24SyndromeEntry &lhs, const CRC24SyndromeEntry &rhs)
+    { return lhs.syndrome < rhs.syndrome; };
+    std::sort(tables.single_bit, tables.single_bit + kCRC24NumSingleBitSyndromes, syndrome_less);
+    std::sort(tables.two_bit, tables.two_bit + kCRC24NumTwoBitSyndromes, syndrome_less);
+    return tables;
+}
+
+static constexpr CRC24SyndromeTables kCRC24SyndromeTables = GenerateCRC24SyndromeTables();
+
+/**
+ * Checks that no syndrome shows up twice across both tables, which would make the correction ambiguous.
+ */
+static constexpr bool CRC24SyndromesAreUnique()
+{
+    uint16_t a = 0, b = 0;
+    uint32_t last_syndrome = 0; // A syndrome of 0 means no error, so it can't appear in the tables.
+    while (a < kCRC24NumSingleBitSyndromes || b < kCRC24NumTwoBitSyndromes)
+    {
+        uint32_t syndrome;
+        if (b >= kCRC24NumTwoBitSyndromes ||
+            (a < kCRC24NumSingleBitSyndromes &&
+             kCRC24SyndromeTables.single_bit[a].syndrome < kCRC24SyndromeTables.two_bit[b].syndrome))
+        {
+            syndrome = kCRC24SyndromeTables.single_bit[a++].syndrome;
+        }
+        else
+        {
+            syndrome = kCRC24SyndromeTables.two_bit[b++].syndrome;
+        }
+        if (syndrome == last_syndrome)
+        {
+            return false;
+        }
+        last_syndrome = syndrome;
+    }
+    return true;
+}
+static_assert(CRC24SyndromesAreUnique(), "CRC-24 one and two bit error syndromes must be unique.");
+
+/**
+ * Binary searches a sorted syndrome table.
+ * @retval Pointer to the matching entry, or nullptr if the syndrome isn't in the table.
+ */
+static const CRC24SyndromeEntry *FindSyndrome(const CRC24SyndromeEntry *table, uint16_t table_len, uint32_t syndrome)
+{
+    const CRC24SyndromeEntry *entry =
+        std::lower_bound(table, table + table_len, syndrome,
+                         [](const CRC24SyndromeEntry &lhs, uint32_t rhs) { return lhs.syndrome < rhs; });
+    if (entry == table + table_len || entry->syndrome != syndrome)
+    {
+        return nullptr;
+    }
+    return entry;
+}
+
+uint16_t crc24_syndrome_lookup(uint32_t syndrome, uint16_t max_num_bits,
+                               uint16_t bit_indices[kCRC24SyndromeMaxNumBits])
+{
+    if (syndrome == 0 || max_num_bits < 1)
+    {
+        return 0;
+    }
+    const CRC24SyndromeEntry *entry =
+        FindSyndrome(kCRC24SyndromeTables.single_bit, kCRC24NumSingleBitSyndromes, syndrome);
+    if (entry != nullptr)
+    {
+        bit_indices[0] = entry->bit_index_a;
+        return 1;
+    }
+    if (max_num_bits < 2)
+    {
+        return 0;
+    }
+    entry = FindSyndrome(kCRC24SyndromeTables.two_bit, kCRC24NumTwoBitSyndromes, syndrome);
+    if (entry != nullptr)
+    {
+        bit_indices[0] = entry->bit_index_a;
+        bit_indices[1] = entry->bit_index_b;
+        return 2;
+    }
+    return 0;
+}
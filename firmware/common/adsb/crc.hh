@@ -0,0 +1,148 @@
+#ifndef _CRC_HH_
+#define _CRC_HH_
+
+#include <cstdint>
+
+// Mode S CRC-24. Generator polynomial from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
+const uint32_t kCRC24Generator = 0x1FFF409;
+const uint16_t kCRC24GeneratorNumBits = 25;
+const uint32_t kCRC24Mask = 0xFFFFFF;
+
+// Slice-by-4 lookup tables. table[k][b] is the CRC of byte b followed by k zero bytes, so table[0] is the regular
+// byte-wise table. Generated at compile time in crc.cc.
+const uint16_t kCRC24NumTables = 4;
+struct CRC24Tables
+{
+    uint32_t table[kCRC24NumTables][256];
+};
+extern const CRC24Tables kCRC24Tables;
+
+/**
+ * Advances a CRC-24 by a single byte.
+ * @param[in] crc Current 24-bit CRC value (0 at the start of a message).
+ * @param[in] byte Next byte of the message.
+ * @retval Updated 24-bit CRC value.
+ */
+inline uint32_t crc24_byte(uint32_t crc, uint8_t byte)
+{
+    return ((crc << 8) & kCRC24Mask) ^ kCRC24Tables.table[0][((crc >> 16) ^ byte) & 0xFF];
+}
+
+/**
+ * Advances a CRC-24 by a full 32-bit word. The MSB of the word is the oldest bit, matching the packet buffers built by
+ * TransponderPacket.
+ * @param[in] crc Current 24-bit CRC value (0 at the start of a message).
+ * @param[in] word Next 32 bits of the message.
+ * @retval Updated 24-bit CRC value.
+ */
+inline uint32_t crc24_word(uint32_t crc, uint32_t word)
+{
+    uint32_t x = word ^ (crc << 8);
+    return kCRC24Tables.table[3][x >> 24] ^ kCRC24Tables.table[2][(x >> 16) & 0xFF] ^
+           kCRC24Tables.table[1][(x >> 8) & 0xFF] ^ kCRC24Tables.table[0][x & 0xFF];
+}
+
+/**
+ * Calculates the Mode S CRC-24 over the first num_bits of a big-endian buffer of 32-bit words.
+ * @param[in] buffer Buffer to read from. MSb of the first word is the first bit of the message.
+ * @param[in] num_bits Number of bits to calculate the CRC over. Must be a multiple of 8.
+ * @retval 24-bit CRC.
+ */
+uint32_t crc24(const uint32_t buffer[], uint16_t num_bits);
+
+/**
+ * Calculates the Mode S CRC-24 over a byte buffer.
+ * @param[in] buffer Buffer to read from. First byte is the first byte of the message.
+ * @param[in] num_bytes Number of bytes to calculate the CRC over.
+ * @retval 24-bit CRC.
+ */
+uint32_t crc24(const uint8_t buffer[], uint16_t num_bytes);
+
+/**
+ * Calculates the CRC-24 of a Mode S message one 32-bit word at a time, as words arrive from the demodulator. The
+ * message length isn't known until the last word lands, so the CRC of the data bits is captured for both the 56-bit and
+ * 112-bit layouts along the way. Only the first 1 (56-bit) or 3 (112-bit) words carry data bits, so the word holding
+ * the end of the parity field never needs to be ingested.
+ */
+class StreamingCRC24
+{
+public:
+    static const uint16_t kSquitterDataNumWords = 1;         // 32 data bits.
+    static const uint16_t kExtendedSquitterDataNumWords = 3; // 88 data bits = 2 words + 3 bytes of the third word.
+
+    /**
+     * Clears the CRC in preparation for a new message.
+     */
+    void Reset()
+    {
+        num_words_ingested_ = 0;
+        crc_ = 0;
+    }
+
+    /**
+     * Advances the CRC by the next word of the message.
+     * @param[in] word Next 32 bits of the message, MSb first.
+     */
+    void IngestWord(uint32_t word)
+    {
+        if (num_words_ingested_ == kExtendedSquitterDataNumWords - 1)
+        {
+            // Only the first 3 bytes of the third word are data bits in a 112-bit message.
+            extended_squitter_crc_ = crc24_byte(crc24_byte(crc24_byte(crc_, word >> 24), word >> 16), word >> 8);
+        }
+        crc_ = crc24_word(crc_, word);
+        num_words_ingested_++;
+        if (num_words_ingested_ == kSquitterDataNumWords)
+        {
+            squitter_crc_ = crc_;
+        }
+    }
+
+    /**
+     * Returns the CRC of the data bits of a message, which should match its parity field if the message is valid.
+     * @param[in] packet_len_bits Length of the message, 56 or 112 bits.
+     * @param[out] crc Reference to fill with the 24-bit CRC.
+     * @retval True if enough words were ingested to calculate the CRC for the message length, false otherwise.
+     */
+    bool GetCRC(uint16_t packet_len_bits, uint32_t &crc) const
+    {
+        if (packet_len_bits == 56 && num_words_ingested_ >= kSquitterDataNumWords)
+        {
+            crc = squitter_crc_;
+            return true;
+        }
+        if (packet_len_bits == 112 && num_words_ingested_ >= kExtendedSquitterDataNumWords)
+        {
+            crc = extended_squitter_crc_;
+            return true;
+        }
+        return false;
+    }
+
+    uint16_t GetNumWordsIngested() const { return num_words_ingested_; }
+
+private:
+    uint16_t num_words_ingested_ = 0;
+    uint32_t crc_ = 0;
+    uint32_t squitter_crc_ = 0;
+    uint32_t extended_squitter_crc_ = 0;
+};
+
+// Syndrome-based error correction. The syndrome of a 112-bit message is the CRC of its first 88 bits XORed with its
+// 24-bit parity field, which is 0 for a clean message and otherwise depends only on which bits were flipped.
+const uint16_t kCRC24SyndromeMessageLenBits = 112;
+const uint16_t kCRC24SyndromeMaxNumBits = 2;
+
+/**
+ * Looks up the bit error pattern that produced a given syndrome in a 112-bit message. Uses precomputed tables of all
+ * single-bit (and, if allowed, two-bit) error syndromes sorted for binary search.
+ * @param[in] syndrome Syndrome of the received message. Must be nonzero.
+ * @param[in] max_num_bits Largest number of flipped bits to consider (1 or 2).
+ * @param[out] bit_indices Indices of the flipped bits, where the MSb of the message is bit 0. Only the first N entries
+ * are written, where N is the return value.
+ * @retval Number of flipped bits that explain the syndrome, or 0 if it can't be corrected.
+ */
+uint16_t crc24_syndrome_lookup(uint32_t syndrome, uint16_t max_num_bits,
+                               uint16_t bit_indices[kCRC24SyndromeMaxNumBits]);
+
+#endif /* _CRC_HH_ */
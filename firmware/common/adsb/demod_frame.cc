@@ -0,0 +1,93 @@
+#include "demod_frame.hh"
+
+#include "crc.hh"
+#include "macros.hh" // For MIN.
+#include "unit_conversions.hh"
+
+uint16_t demod_find_frames(const uint32_t ring[], uint16_t ring_num_words, uint32_t &last_message_end_word_count,
+                           uint32_t num_words_written, uint16_t num_messages, DemodFrame frames[])
+{
+    // Messages are written back to back, so walk forward from the end of the last message found. The end of the ring
+    // can't be used as a reference, since the DEMOD ISR may run late enough for the next message to have started.
+    uint32_t start_word_count = last_message_end_word_count;
+    uint32_t num_words_available = MIN(num_words_written - start_word_count, ring_num_words);
+    for (uint16_t i = 0; i < num_messages; i++)
+    {
+        // The end-of-frame word is the first word whose bit count puts it right after the message's full words and
+        // partial last word.
+        bool found_end_of_frame = false;
+        for (uint32_t j = 1; j < num_words_available; j++)
+        {
+            uint32_t num_bits = ~ring[(start_word_count + j) & (ring_num_words - 1)];
+            if (num_bits / kBitsPerWord + 1 == j)
+            {
+                frames[i].start_word_count = start_word_count;
+                frames[i].num_bits = num_bits;
+                start_word_count += j + 1;
+                num_words_available -= j + 1;
+                found_end_of_frame = true;
+                break;
+            }
+        }
+        if (!found_end_of_frame)
+        {
+            // The end-of-frame word is missing or garbled, so there's no telling where this message ends. Drop it and
+            // any after it, and pick up again from the end of the ring next time.
+            last_message_end_word_count = num_words_written;
+            return i;
+        }
+    }
+    last_message_end_word_count = start_word_count;
+    return num_messages;
+}
+
+bool demod_frame_to_raw_packet(const uint32_t ring[], uint16_t ring_num_words, const DemodFrame &frame,
+                               RawTransponderPacket &raw_packet)
+{
+    uint16_t num_data_words;
+    if (frame.num_bits >= TransponderPacket::kExtendedSquitterPacketLenBits)
+    {
+        raw_packet.buffer_len_bits = TransponderPacket::kExtendedSquitterPacketLenBits;
+        num_data_words = StreamingCRC24::kExtendedSquitterDataNumWords;
+    }
+    else if (frame.num_bits >= TransponderPacket::kSquitterPacketNumBits)
+    {
+        raw_packet.buffer_len_bits = TransponderPacket::kSquitterPacketNumBits;
+        num_data_words = StreamingCRC24::kSquitterDataNumWords;
+    }
+    else
+    {
+        return false; // Too short to be a packet.
+    }
+
+    StreamingCRC24 crc;
+    uint16_t num_full_words = frame.num_bits / kBitsPerWord;
+    uint16_t num_partial_word_bits = frame.num_bits % kBitsPerWord;
+    uint16_t num_packet_words = (raw_packet.buffer_len_bits + kBitsPerWord - 1) / kBitsPerWord;
+    for (uint16_t i = 0; i < num_packet_words; i++)
+    {
+        uint32_t word = ring[(frame.start_word_count + i) & (ring_num_words - 1)];
+        if (i == num_full_words)
+        {
+            // The partial last word is right aligned, so left align it to match the full words.
+            word <<= kBitsPerWord - num_partial_word_bits;
+        }
+        raw_packet.buffer[i] = word;
+        if (i < num_data_words)
+        {
+            crc.IngestWord(word);
+        }
+    }
+    // Mask off any bits past the end of the packet in its last word.
+    uint16_t num_last_word_bits = raw_packet.buffer_len_bits - (num_packet_words - 1) * kBitsPerWord;
+    raw_packet.buffer[num_packet_words - 1] &= UINT32_MAX << (kBitsPerWord - num_last_word_bits);
+    // Data bits were already run through the CRC as they came out of the ring, so validating the packet during decode
+    // is just a compare against the parity bits in the last word.
+    uint32_t calculated_crc;
+    if (crc.GetCRC(raw_packet.buffer_len_bits, calculated_crc))
+    {
+        raw_packet.crc = calculated_crc;
+        raw_packet.flags |= RawTransponderPacket::kFlagCRCCalculated;
+    }
+    return true;
+}
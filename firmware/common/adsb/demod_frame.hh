@@ -0,0 +1,68 @@
+#ifndef _DEMOD_FRAME_HH_
+#define _DEMOD_FRAME_HH_
+
+#include <cstdint>
+
+#include "adsb_packet.hh" // For RawTransponderPacket.
+
+// The receiver's RSSI peak detector is read by a 12-bit ADC referenced to the 3.3V rail.
+const uint16_t kRSSIADCMaxCounts = 4095;
+const int kRSSIADCReferenceMilliVolts = 3300;
+
+/**
+ * Location of a demodulated message in the demod ring buffer. The message_demodulator PIO program writes each message
+ * as its full words, then the partial last word (right aligned, may be empty), then an end-of-frame word holding the
+ * one's complement of the number of bits in the message. The partial last word has fewer than 32 bits, so it can never
+ * be mistaken for an end-of-frame word, which always has its MSB set. Positions in the ring are counts of words
+ * written, which wrap at 2^32.
+ */
+struct DemodFrame
+{
+    uint32_t start_word_count = 0; // Position of the message's first word.
+    uint32_t num_bits = 0;         // Number of bits in the message, from its end-of-frame word.
+};
+
+/**
+ * Finds the frames of messages that the preamble detectors have reported as finished, by walking forward from the end
+ * of the last message found. Words past the finished messages are left alone, since they may belong to a message that
+ * is still coming in. Shared by ADSBee's DEMOD ISR and the host software demodulator.
+ * @param[in] ring Demod ring buffer. Length must be a power of 2.
+ * @param[in] ring_num_words Number of words in the ring buffer.
+ * @param[inout] last_message_end_word_count Position just past the end-of-frame word of the last message found. Moved
+ * past the messages found by this call.
+ * @param[in] num_words_written Total number of words written to the ring buffer so far.
+ * @param[in] num_messages Number of messages that have finished since the last call.
+ * @param[out] frames Filled with the location of each message that was found, in the order the messages were received.
+ * Must have room for num_messages frames.
+ * @retval Number of messages that were found. The rest had no end-of-frame word where it should be, and are framing
+ * errors.
+ */
+uint16_t demod_find_frames(const uint32_t ring[], uint16_t ring_num_words, uint32_t &last_message_end_word_count,
+                           uint32_t num_words_written, uint16_t num_messages, DemodFrame frames[]);
+
+/**
+ * Assembles a demodulated message from the demod ring buffer into a RawTransponderPacket, and calculates its CRC on the
+ * way. Bits past the longest valid packet are thrown away, and the length is rounded down to a valid packet length.
+ * @param[in] ring Demod ring buffer. Length must be a power of 2.
+ * @param[in] ring_num_words Number of words in the ring buffer.
+ * @param[in] frame Location of the message in the ring buffer.
+ * @param[out] raw_packet Packet to fill in. RSSI and MLAT timestamp are left for the caller.
+ * @retval True if the message was long enough to be a packet, false otherwise.
+ */
+bool demod_frame_to_raw_packet(const uint32_t ring[], uint16_t ring_num_words, const DemodFrame &frame,
+                               RawTransponderPacket &raw_packet);
+
+/**
+ * Converts a reading from the RSSI peak detector to dBm.
+ * @param[in] rssi_adc_counts Raw 12-bit ADC reading of the RSSI peak detector.
+ * @param[in] rx_gain Gain of the receive signal path ahead of the peak detector (integer ratio between 1-101).
+ * @retval RSSI in dBm.
+ */
+inline int rssi_adc_counts_to_dbm(uint16_t rssi_adc_counts, int rx_gain)
+{
+    int normalized_rssi_adc_counts = rssi_adc_counts / (rx_gain > 1 ? rx_gain : 1); // Avoid divide by 0.
+    int rssi_mv = normalized_rssi_adc_counts * kRSSIADCReferenceMilliVolts / kRSSIADCMaxCounts;
+    return 60 * (rssi_mv - 1600) / 1000; // AD8313 0dBm intercept at 1.6V, slope is 60dBm/V.
+}
+
+#endif /* _DEMOD_FRAME_HH_ */
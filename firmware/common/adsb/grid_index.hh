@@ -0,0 +1,174 @@
+#ifndef _GRID_INDEX_HH_
+#define _GRID_INDEX_HH_
+
+#include <cmath>
+#include <cstdint>
+
+#include "icao_address_hash.hh"
+
+/**
+ * Fixed-memory spatial index that sorts entries into a uniform grid of latitude/longitude cells, for finding the
+ * entries near a point without visiting every entry. Entries are identified by their index (e.g. their position in an
+ * ICAOTable pool), and are threaded onto singly linked lists hanging off a hashed table of cell buckets, so the index
+ * takes the same amount of memory no matter where entries are. Since several cells can share a bucket, each entry
+ * remembers its cell, and entries from other cells are skipped when walking a bucket.
+ */
+template <uint16_t kCapacity>
+class GridIndex
+{
+public:
+    static_assert(kCapacity > 0 && kCapacity < UINT16_MAX / 2, "GridIndex entry indices must fit in a uint16_t.");
+
+    static constexpr float kCellSizeDeg = 0.5f; // About 55km north to south.
+    static const int16_t kNumLatCells = 180.0f / kCellSizeDeg;
+    static const int16_t kNumLonCells = 360.0f / kCellSizeDeg;
+    // Smallest power of 2 that's at least twice the capacity, so buckets stay short.
+    static const uint16_t kNumBuckets = 1u << (32 - __builtin_clz(kCapacity * 2u - 1));
+
+    GridIndex() { Clear(); };
+
+    /**
+     * Removes all entries.
+     */
+    void Clear()
+    {
+        for (uint16_t i = 0; i < kNumBuckets; i++)
+        {
+            bucket_heads_[i] = kNoEntry;
+        }
+        for (uint16_t i = 0; i < kCapacity; i++)
+        {
+            entries_[i].next = kNoEntry;
+            entries_[i].lat_cell = kNotIndexed;
+        }
+    }
+
+    /**
+     * Adds an entry at a position, or moves it there if it's already in the index.
+     * @param[in] entry_index Index of the entry, from 0 to kCapacity - 1.
+     * @param[in] latitude_deg Latitude of the entry, in degrees.
+     * @param[in] longitude_deg Longitude of the entry, in degrees.
+     */
+    void Update(uint16_t entry_index, float latitude_deg, float longitude_deg)
+    {
+        int16_t lat_cell = GetLatCell(latitude_deg);
+        int16_t lon_cell = WrapLonCell(GetLonCell(longitude_deg));
+        Entry &entry = entries_[entry_index];
+        if (entry.lat_cell == lat_cell && entry.lon_cell == lon_cell)
+        {
+            return; // Still in the same cell, which is the usual case.
+        }
+        Remove(entry_index);
+        uint16_t &bucket_head = bucket_heads_[GetBucketIndex(lat_cell, lon_cell)];
+        entry = {.next = bucket_head, .lat_cell = lat_cell, .lon_cell = lon_cell};
+        bucket_head = entry_index;
+    }
+
+    /**
+     * Removes an entry from the index. Does nothing if the entry isn't in the index.
+     * @param[in] entry_index Index of the entry, from 0 to kCapacity - 1.
+     */
+    void Remove(uint16_t entry_index)
+    {
+        Entry &entry = entries_[entry_index];
+        if (entry.lat_cell == kNotIndexed)
+        {
+            return;
+        }
+        uint16_t *link = &bucket_heads_[GetBucketIndex(entry.lat_cell, entry.lon_cell)];
+        while (*link != entry_index)
+        {
+            link = &entries_[*link].next;
+        }
+        *link = entry.next;
+        entry.next = kNoEntry;
+        entry.lat_cell = kNotIndexed;
+    }
+
+    /**
+     * Calls a function on every entry in the cells that overlap a latitude/longitude box. Entries near the edge of
+     * the box may be outside of it, so the caller needs to do its own exact check. Only visits the cells that overlap
+     * the box.
+     * @param[in] min_latitude_deg Southern edge of the box, in degrees.
+     * @param[in] max_latitude_deg Northern edge of the box, in degrees.
+     * @param[in] min_longitude_deg Western edge of the box, in degrees. Can be below -180 to cross the antimeridian.
+     * @param[in] max_longitude_deg Eastern edge of the box, in degrees. Can be above 180 to cross the antimeridian.
+     * @param[in] visit Function that takes a uint16_t entry index.
+     */
+    template <class Visitor>
+    void ForEachInBox(float min_latitude_deg, float max_latitude_deg, float min_longitude_deg, float max_longitude_deg,
+                      Visitor visit) const
+    {
+        int16_t min_lat_cell = GetLatCell(min_latitude_deg);
+        int16_t max_lat_cell = GetLatCell(max_latitude_deg);
+        int16_t min_lon_cell = GetLonCell(min_longitude_deg);
+        int16_t max_lon_cell = GetLonCell(max_longitude_deg);
+        if (max_lon_cell - min_lon_cell >= kNumLonCells)
+        {
+            // Box goes all the way around, don't visit any cells twice.
+            min_lon_cell = 0;
+            max_lon_cell = kNumLonCells - 1;
+        }
+        for (int16_t lat_cell = min_lat_cell; lat_cell <= max_lat_cell; lat_cell++)
+        {
+            for (int16_t i = min_lon_cell; i <= max_lon_cell; i++)
+            {
+                int16_t lon_cell = WrapLonCell(i);
+                uint16_t entry_index = bucket_heads_[GetBucketIndex(lat_cell, lon_cell)];
+                while (entry_index != kNoEntry)
+                {
+                    const Entry &entry = entries_[entry_index];
+                    if (entry.lat_cell == lat_cell && entry.lon_cell == lon_cell)
+                    {
+                        visit(entry_index);
+                    }
+                    entry_index = entry.next;
+                }
+            }
+        }
+    }
+
+private:
+    static const uint16_t kNoEntry = UINT16_MAX;
+    static const int16_t kNotIndexed = INT16_MIN;
+
+    struct Entry
+    {
+        uint16_t next; // Next entry in the same bucket.
+        int16_t lat_cell;
+        int16_t lon_cell;
+    };
+
+    /**
+     * Returns the latitude cell for a latitude, clamped to the poles.
+     */
+    static int16_t GetLatCell(float latitude_deg)
+    {
+        int32_t lat_cell = floorf((latitude_deg + 90.0f) / kCellSizeDeg);
+        return lat_cell < 0 ? 0 : (lat_cell >= kNumLatCells ? kNumLatCells - 1 : lat_cell);
+    }
+
+    /**
+     * Returns the longitude cell for a longitude, without wrapping it around the antimeridian.
+     */
+    static int16_t GetLonCell(float longitude_deg)
+    {
+        float lon_cell = floorf((longitude_deg + 180.0f) / kCellSizeDeg);
+        // Stay within int16_t, anything more than once around is treated as all the way around.
+        return lon_cell < -kNumLonCells ? -kNumLonCells : (lon_cell > 2 * kNumLonCells ? 2 * kNumLonCells : lon_cell);
+    }
+
+    static int16_t WrapLonCell(int16_t lon_cell) { return (lon_cell % kNumLonCells + kNumLonCells) % kNumLonCells; }
+
+    static uint16_t GetBucketIndex(int16_t lat_cell, int16_t lon_cell)
+    {
+        // Neighboring cells cluster the same way nearby ICAO addresses do, so hash them the same way to spread them
+        // across buckets.
+        return icao_address_hash(lat_cell * kNumLonCells + lon_cell, __builtin_ctz(kNumBuckets));
+    }
+
+    uint16_t bucket_heads_[kNumBuckets];
+    Entry entries_[kCapacity];
+};
+
+#endif /* _GRID_INDEX_HH_ */
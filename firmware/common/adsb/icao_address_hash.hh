@@ -0,0 +1,22 @@
+#ifndef _ICAO_ADDRESS_HASH_HH_
+#define _ICAO_ADDRESS_HASH_HH_
+
+#include <cstdint>
+
+// ICAO addresses are 24 bits, so this can never match a real address. Marks empty slots in ICAO address hash tables.
+const uint32_t kInvalidICAOAddress = UINT32_MAX;
+
+/**
+ * Returns the home slot of an ICAO address in a hash table with a power of 2 number of slots. Multiplicative hash,
+ * since nearby ICAO addresses are often assigned to aircraft from the same registry and would otherwise land in
+ * neighboring slots. Works just as well for other keys that tend to cluster.
+ * @param[in] icao_address Address to hash.
+ * @param[in] log2_num_slots Log base 2 of the number of slots in the table, between 1 and 16.
+ * @retval Slot index, less than 2^log2_num_slots.
+ */
+inline uint16_t icao_address_hash(uint32_t icao_address, uint16_t log2_num_slots)
+{
+    return (icao_address * 2654435761u) >> (32 - log2_num_slots);
+}
+
+#endif /* _ICAO_ADDRESS_HASH_HH_ */
@@ -0,0 +1,77 @@
+#include "icao_confidence_set.hh"
+
+void ICAOConfidenceSet::Clear()
+{
+    for (uint16_t i = 0; i < kNumSlots; i++)
+    {
+        slots_[i] = {.icao_address = kEmptySlot, .last_seen_timestamp_ms = 0};
+    }
+}
+
+void ICAOConfidenceSet::Insert(uint32_t icao_address, uint32_t timestamp_ms)
+{
+    uint16_t home_index = GetHomeSlotIndex(icao_address);
+    Slot *expired_slot = nullptr; // First expired slot in the probe window, can be reused.
+    Slot *oldest_slot = nullptr;  // Least recently seen slot in the probe window, evicted if there's no room.
+    for (uint16_t i = 0; i < kMaxProbeLength; i++)
+    {
+        Slot &slot = slots_[(home_index + i) & (kNumSlots - 1)];
+        if (slot.icao_address == icao_address)
+        {
+            slot.last_seen_timestamp_ms = timestamp_ms; // Already in the set, refresh it.
+            return;
+        }
+        if (slot.icao_address == kEmptySlot)
+        {
+            // End of the probe chain, so the address isn't in the set. Prefer filling in an expired slot earlier in
+            // the chain to keep chains short.
+            if (expired_slot == nullptr)
+            {
+                expired_slot = &slot;
+            }
+            break;
+        }
+        if (expired_slot == nullptr && IsExpired(slot, timestamp_ms))
+        {
+            expired_slot = &slot;
+        }
+        if (oldest_slot == nullptr ||
+            timestamp_ms - slot.last_seen_timestamp_ms > timestamp_ms - oldest_slot->last_seen_timestamp_ms)
+        {
+            oldest_slot = &slot;
+        }
+    }
+    Slot *new_slot = expired_slot != nullptr ? expired_slot : oldest_slot;
+    *new_slot = {.icao_address = icao_address, .last_seen_timestamp_ms = timestamp_ms};
+}
+
+bool ICAOConfidenceSet::Contains(uint32_t icao_address, uint32_t timestamp_ms) const
+{
+    uint16_t home_index = GetHomeSlotIndex(icao_address);
+    for (uint16_t i = 0; i < kMaxProbeLength; i++)
+    {
+        const Slot &slot = slots_[(home_index + i) & (kNumSlots - 1)];
+        if (slot.icao_address == icao_address)
+        {
+            return !IsExpired(slot, timestamp_ms);
+        }
+        if (slot.icao_address == kEmptySlot)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+uint16_t ICAOConfidenceSet::GetNumActive(uint32_t timestamp_ms) const
+{
+    uint16_t num_active = 0;
+    for (uint16_t i = 0; i < kNumSlots; i++)
+    {
+        if (slots_[i].icao_address != kEmptySlot && !IsExpired(slots_[i], timestamp_ms))
+        {
+            num_active++;
+        }
+    }
+    return num_active;
+}
@@ -0,0 +1,88 @@
+#ifndef _ICAO_CONFIDENCE_SET_HH_
+#define _ICAO_CONFIDENCE_SET_HH_
+
+#include <cstdint>
+
+#include "icao_address_hash.hh"
+
+/**
+ * Set of ICAO addresses recently seen in packets with a clean CRC (DF11, DF17, DF18). Packets that overlay the CRC with
+ * the ICAO address (Address/Parity, e.g. DF0/4/5/16/20/21) can't be checked on their own, so the address recovered
+ * from them is only trusted if it's in this set. Open-addressed with linear probing over a fixed array, so inserts and
+ * lookups never allocate and touch at most kMaxProbeLength slots.
+ */
+class ICAOConfidenceSet
+{
+public:
+    static const uint16_t kNumSlots = 256; // Must be a power of 2.
+    static const uint16_t kMaxProbeLength = 16;
+    static const uint32_t kDefaultTTLMs = 60e3;
+
+    struct ICAOConfidenceSetConfig_t
+    {
+        uint32_t ttl_ms = kDefaultTTLMs; // How long an ICAO address stays trusted after its last clean packet.
+    };
+
+    /**
+     * Default constructor. Uses default config values.
+     */
+    ICAOConfidenceSet() { Clear(); };
+
+    /**
+     * Constructor with config values specified.
+     */
+    ICAOConfidenceSet(ICAOConfidenceSetConfig_t config_in) : config_(config_in) { Clear(); };
+
+    /**
+     * Removes all ICAO addresses from the set.
+     */
+    void Clear();
+
+    /**
+     * Adds an ICAO address to the set, or refreshes its timestamp if it's already in the set. If the probe window is
+     * full, replaces an expired entry, or the least recently seen one if none have expired.
+     * @param[in] icao_address 24-bit ICAO address from a packet with a clean CRC.
+     * @param[in] timestamp_ms Time that the packet was received.
+     */
+    void Insert(uint32_t icao_address, uint32_t timestamp_ms);
+
+    /**
+     * Checks whether an ICAO address was seen in a packet with a clean CRC within the last ttl_ms.
+     * @param[in] icao_address 24-bit ICAO address to look for.
+     * @param[in] timestamp_ms Current time.
+     * @retval True if the ICAO address is in the set and hasn't expired, false otherwise.
+     */
+    bool Contains(uint32_t icao_address, uint32_t timestamp_ms) const;
+
+    /**
+     * Returns the number of unexpired ICAO addresses in the set. Walks the whole table, so not meant for hot paths.
+     * @param[in] timestamp_ms Current time.
+     * @retval Number of ICAO addresses that would pass Contains().
+     */
+    uint16_t GetNumActive(uint32_t timestamp_ms) const;
+
+private:
+    static const uint32_t kEmptySlot = kInvalidICAOAddress;
+
+    struct Slot
+    {
+        uint32_t icao_address;
+        uint32_t last_seen_timestamp_ms;
+    };
+
+    // Returns the first slot to probe for a given ICAO address.
+    static uint16_t GetHomeSlotIndex(uint32_t icao_address) { return icao_address_hash(icao_address, kLog2NumSlots); }
+
+    bool IsExpired(const Slot &slot, uint32_t timestamp_ms) const
+    {
+        return timestamp_ms - slot.last_seen_timestamp_ms > config_.ttl_ms;
+    }
+
+    static const uint16_t kLog2NumSlots = 8;
+    static_assert(1 << kLog2NumSlots == kNumSlots, "kLog2NumSlots must match kNumSlots.");
+
+    ICAOConfidenceSetConfig_t config_;
+    Slot slots_[kNumSlots];
+};
+
+#endif /* _ICAO_CONFIDENCE_SET_HH_ */
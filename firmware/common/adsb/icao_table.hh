@@ -0,0 +1,310 @@
+#ifndef _ICAO_TABLE_HH_
+#define _ICAO_TABLE_HH_
+
+#include <cstdint>
+
+#include "icao_address_hash.hh"
+
+/**
+ * Fixed-capacity map from 24-bit ICAO address to an entry of type T, with no heap allocation. Entries live in a pool
+ * and never move once inserted, so pointers to them stay valid until they're removed. Lookups go through an
+ * open-addressed index with at least twice as many slots as the capacity, probed linearly from a multiplicative hash.
+ * Removals shift the rest of the probe run back instead of leaving tombstones, so probe runs don't grow from churn and
+ * the first empty slot always ends a search.
+ *
+ * Occupied entries are threaded onto a doubly linked recency list, ordered from most to least recently touched, so
+ * the least recently touched entry can be found for eviction in O(1). Free entries are kept on a singly linked list.
+ * Iteration walks the recency list, so it only touches occupied entries.
+ */
+template <class T, uint16_t kCapacity>
+class ICAOTable
+{
+public:
+    static_assert(kCapacity > 0 && kCapacity <= UINT16_MAX / 4, "ICAOTable index must fit in a uint16_t.");
+
+    // Smallest power of 2 that's at least twice the capacity.
+    static const uint16_t kNumIndexSlots = 1u << (32 - __builtin_clz(2u * kCapacity - 1));
+
+    class Iterator
+    {
+    public:
+        Iterator(ICAOTable *table, uint16_t entry_index) : table_(table), entry_index_(entry_index) {};
+        T &operator*() const { return table_->entries_[entry_index_]; }
+        T *operator->() const { return &(operator*()); }
+        Iterator &operator++()
+        {
+            entry_index_ = table_->links_[entry_index_].next;
+            return *this;
+        }
+        bool operator!=(const Iterator &other) const { return entry_index_ != other.entry_index_; }
+
+    private:
+        ICAOTable *table_;
+        uint16_t entry_index_;
+    };
+
+    ICAOTable() { Clear(); };
+
+    /**
+     * Removes all entries.
+     */
+    void Clear()
+    {
+        for (uint16_t i = 0; i < kNumIndexSlots; i++)
+        {
+            index_[i].icao_address = kEmptySlot;
+        }
+        for (uint16_t i = 0; i < kCapacity; i++)
+        {
+            links_[i].next = i + 1 < kCapacity ? i + 1 : kNoEntry;
+            entry_icao_addresses_[i] = kEmptySlot;
+        }
+        free_head_ = 0;
+        most_recent_ = kNoEntry;
+        least_recent_ = kNoEntry;
+        size_ = 0;
+    }
+
+    /**
+     * Looks up the entry for an ICAO address.
+     * @param[in] icao_address 24-bit ICAO address to look for.
+     * @retval Pointer to the entry, or nullptr if the ICAO address isn't in the table.
+     */
+    T *Find(uint32_t icao_address)
+    {
+        uint16_t slot_index = FindSlot(icao_address);
+        return index_[slot_index].icao_address == kEmptySlot ? nullptr : &entries_[index_[slot_index].entry_index];
+    }
+    const T *Find(uint32_t icao_address) const { return const_cast<ICAOTable *>(this)->Find(icao_address); }
+
+    /**
+     * Looks up the entry for an ICAO address, and adds an entry for it if there isn't one, in a single probe. New
+     * entries go on the most recent end of the recency list, and are left holding whatever was last stored in their
+     * spot in the pool, so they need to be initialized by the caller. Existing entries aren't touched.
+     * @param[in] icao_address 24-bit ICAO address to look for.
+     * @param[out] inserted Set to true if a new entry was added, false otherwise.
+     * @retval Pointer to the entry, or nullptr if the ICAO address wasn't in the table and the table is full.
+     */
+    T *FindOrInsert(uint32_t icao_address, bool &inserted)
+    {
+        inserted = false;
+        IndexSlot &slot = index_[FindSlot(icao_address)];
+        if (slot.icao_address != kEmptySlot)
+        {
+            return &entries_[slot.entry_index];
+        }
+        if (free_head_ == kNoEntry)
+        {
+            return nullptr;
+        }
+        uint16_t entry_index = free_head_;
+        free_head_ = links_[entry_index].next;
+        slot.icao_address = icao_address;
+        slot.entry_index = entry_index;
+        entry_icao_addresses_[entry_index] = icao_address;
+        LinkMostRecent(entry_index);
+        size_++;
+        inserted = true;
+        return &entries_[entry_index];
+    }
+
+    /**
+     * Removes the entry for an ICAO address.
+     * @param[in] icao_address 24-bit ICAO address of the entry to remove.
+     * @retval True if the entry was removed, false if it wasn't in the table.
+     */
+    bool Remove(uint32_t icao_address)
+    {
+        uint16_t slot_index = FindSlot(icao_address);
+        if (index_[slot_index].icao_address == kEmptySlot)
+        {
+            return false;
+        }
+        uint16_t entry_index = index_[slot_index].entry_index;
+        Unlink(entry_index);
+        entry_icao_addresses_[entry_index] = kEmptySlot;
+        links_[entry_index].next = free_head_;
+        free_head_ = entry_index;
+        size_--;
+
+        // Shift later entries in the probe run back into the hole, as long as that doesn't move them in front of their
+        // home slot.
+        uint16_t hole_index = slot_index;
+        uint16_t i = (hole_index + 1) & kIndexMask;
+        while (index_[i].icao_address != kEmptySlot)
+        {
+            uint16_t home_index = GetHomeSlotIndex(index_[i].icao_address);
+            if (((i - home_index) & kIndexMask) >= ((i - hole_index) & kIndexMask))
+            {
+                index_[hole_index] = index_[i];
+                hole_index = i;
+            }
+            i = (i + 1) & kIndexMask;
+        }
+        index_[hole_index].icao_address = kEmptySlot;
+        return true;
+    }
+
+    /**
+     * Moves an entry to the most recent end of the recency list.
+     * @param[in] entry Entry in this table.
+     */
+    void Touch(const T &entry)
+    {
+        uint16_t entry_index = &entry - entries_;
+        if (entry_index == most_recent_)
+        {
+            return;
+        }
+        Unlink(entry_index);
+        LinkMostRecent(entry_index);
+    }
+
+    /**
+     * Returns the least recently touched entry, or nullptr if the table is empty.
+     */
+    T *GetLeastRecent() { return least_recent_ == kNoEntry ? nullptr : &entries_[least_recent_]; }
+
+    /**
+     * Returns the entry touched next after a given entry, or nullptr if it's the most recent one. Safe to call before
+     * removing the given entry, for walking the table from least to most recent while removing entries.
+     * @param[in] entry Entry in this table.
+     */
+    T *GetMoreRecent(const T &entry)
+    {
+        uint16_t entry_index = links_[&entry - entries_].prev;
+        return entry_index == kNoEntry ? nullptr : &entries_[entry_index];
+    }
+
+    /**
+     * Returns the position of an entry in the pool, which stays the same until the entry is removed.
+     * @param[in] entry Entry in this table.
+     */
+    uint16_t GetPoolIndex(const T &entry) const { return &entry - entries_; }
+
+    /**
+     * Returns the ICAO address that an entry is stored under.
+     * @param[in] entry Entry in this table.
+     */
+    uint32_t GetICAOAddress(const T &entry) const { return entry_icao_addresses_[&entry - entries_]; }
+
+    /**
+     * Returns the entry stored at a position in the pool. Entries never move, so walking the pool by position visits
+     * every entry that stays in the table, even if other entries are added and removed along the way.
+     * @param[in] pool_index Position in the pool, from 0 to kCapacity - 1.
+     * @retval Pointer to the entry, or nullptr if that position is free.
+     */
+    T *GetAtPoolIndex(uint16_t pool_index)
+    {
+        return entry_icao_addresses_[pool_index] == kEmptySlot ? nullptr : &entries_[pool_index];
+    }
+
+    /**
+     * Returns the number of entries in the table.
+     */
+    uint16_t Size() const { return size_; }
+
+    // Iterates from the most to the least recently touched entry.
+    Iterator begin() { return Iterator(this, most_recent_); }
+    Iterator end() { return Iterator(this, kNoEntry); }
+
+private:
+    static const uint32_t kEmptySlot = kInvalidICAOAddress;
+    static const uint16_t kIndexMask = kNumIndexSlots - 1;
+    static const uint16_t kNoEntry = UINT16_MAX;
+
+    struct IndexSlot
+    {
+        uint32_t icao_address;
+        uint16_t entry_index;
+    };
+
+    struct EntryLinks
+    {
+        uint16_t next; // Towards the least recent entry, or the next free entry.
+        uint16_t prev; // Towards the most recent entry.
+    };
+
+    // Returns the first index slot to probe for a given ICAO address.
+    static uint16_t GetHomeSlotIndex(uint32_t icao_address)
+    {
+        return icao_address_hash(icao_address, __builtin_ctz(kNumIndexSlots));
+    }
+
+    /**
+     * Returns the index slot holding an ICAO address, or the empty slot that ends its probe run if it isn't in the
+     * table. The index is never more than half full, so there's always an empty slot to stop at.
+     */
+    uint16_t FindSlot(uint32_t icao_address) const
+    {
+        uint16_t i = GetHomeSlotIndex(icao_address);
+        while (index_[i].icao_address != icao_address && index_[i].icao_address != kEmptySlot)
+        {
+            i = (i + 1) & kIndexMask;
+        }
+        return i;
+    }
+
+    void LinkMostRecent(uint16_t entry_index)
+    {
+        links_[entry_index] = {.next = most_recent_, .prev = kNoEntry};
+        if (most_recent_ != kNoEntry)
+        {
+            links_[most_recent_].prev = entry_index;
+        }
+        most_recent_ = entry_index;
+        if (least_recent_ == kNoEntry)
+        {
+            least_recent_ = entry_index;
+        }
+    }
+
+    void Unlink(uint16_t entry_index)
+    {
+        EntryLinks &links = links_[entry_index];
+        if (links.prev != kNoEntry)
+        {
+            links_[links.prev].next = links.next;
+        }
+        else
+        {
+            most_recent_ = links.next;
+        }
+        if (links.next != kNoEntry)
+        {
+            links_[links.next].prev = links.prev;
+        }
+        else
+        {
+            least_recent_ = links.prev;
+        }
+    }
+
+    IndexSlot index_[kNumIndexSlots];
+    T entries_[kCapacity];
+    uint32_t entry_icao_addresses_[kCapacity];
+    EntryLinks links_[kCapacity];
+    uint16_t free_head_ = kNoEntry;
+    uint16_t most_recent_ = kNoEntry;
+    uint16_t least_recent_ = kNoEntry;
+    uint16_t size_ = 0;
+
+public:
+    // Upper bound on the memory used per entry, including the index, which can be up to 4x the capacity after rounding
+    // up to a power of 2.
+    static const uint32_t kMaxNumBytesPerEntry =
+        sizeof(T) + 4 * sizeof(IndexSlot) + sizeof(uint32_t) + sizeof(EntryLinks);
+};
+
+/**
+ * Returns the largest ICAOTable capacity for entries of type T that fits in a memory budget.
+ * @param[in] budget_num_bytes Memory budget, in bytes.
+ */
+template <class T>
+constexpr uint16_t icao_table_capacity_for_budget(uint32_t budget_num_bytes)
+{
+    uint32_t capacity = budget_num_bytes / ICAOTable<T, 1>::kMaxNumBytesPerEntry;
+    return capacity > UINT16_MAX / 4 ? UINT16_MAX / 4 : capacity;
+}
+
+#endif /* _ICAO_TABLE_HH_ */
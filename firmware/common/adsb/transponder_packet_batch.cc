@@ -0,0 +1,116 @@
+#include "transponder_packet_batch.hh"
+
+/**
+ * Fills in the CRCs for one lane group of packets. Packets are stepped through word by word together instead of one
+ * after the other so that the table lookups for different packets don't wait on each other.
+ */
+static void calculate_lane_crcs(const RawTransponderPacket raw_packets[], uint16_t num_lanes,
+                                uint32_t crcs[kTransponderPacketBatchNumLanes])
+{
+    for (uint16_t lane = 0; lane < num_lanes; lane++)
+    {
+        crcs[lane] = crc24_word(0, raw_packets[lane].buffer[0]);
+    }
+    for (uint16_t lane = 0; lane < num_lanes; lane++)
+    {
+        if (raw_packets[lane].buffer_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits)
+        {
+            crcs[lane] = crc24_word(crcs[lane], raw_packets[lane].buffer[1]);
+        }
+    }
+    for (uint16_t lane = 0; lane < num_lanes; lane++)
+    {
+        if (raw_packets[lane].buffer_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits)
+        {
+            // Only the first 3 bytes of the third word are data bits in a 112-bit message.
+            uint32_t word = raw_packets[lane].buffer[2];
+            crcs[lane] = crc24_byte(crc24_byte(crc24_byte(crcs[lane], word >> 24), word >> 16), word >> 8);
+        }
+    }
+    for (uint16_t lane = 0; lane < num_lanes; lane++)
+    {
+        if (raw_packets[lane].flags & RawTransponderPacket::kFlagCRCCalculated)
+        {
+            crcs[lane] = raw_packets[lane].crc; // Already done by the demodulator, don't second guess it.
+        }
+    }
+}
+
+uint16_t decode_transponder_packet_batch(const RawTransponderPacket raw_packets[], uint16_t num_packets,
+                                         TransponderPacketBatch &batch)
+{
+    uint16_t num_valid_packets = 0;
+    for (uint16_t base = 0; base < num_packets; base += kTransponderPacketBatchNumLanes)
+    {
+        uint16_t num_lanes = num_packets - base < kTransponderPacketBatchNumLanes ? num_packets - base
+                                                                                  : kTransponderPacketBatchNumLanes;
+        uint32_t crcs[kTransponderPacketBatchNumLanes];
+        calculate_lane_crcs(&raw_packets[base], num_lanes, crcs);
+
+        for (uint16_t lane = 0; lane < num_lanes; lane++)
+        {
+            const RawTransponderPacket &raw_packet = raw_packets[base + lane];
+            uint16_t i = base + lane;
+            uint16_t packet_len_bits = raw_packet.buffer_len_bits;
+            bool is_valid = false;
+            uint16_t downlink_format = static_cast<uint16_t>(TransponderPacket::kDownlinkFormatInvalid);
+            uint32_t icao_address = 0;
+            uint16_t typecode = ADSBPacket::kTypeCodeInvalid;
+
+            if (packet_len_bits == TransponderPacket::kSquitterPacketNumBits ||
+                packet_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits)
+            {
+                downlink_format = raw_packet.buffer[0] >> 27;
+                switch (TransponderPacket::CheckParity(raw_packet.buffer, packet_len_bits, crcs[lane], icao_address))
+                {
+                case TransponderPacket::kParityCheckPassed:
+                    is_valid = true;
+                    if (packet_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits &&
+                        (downlink_format == TransponderPacket::kDownlinkFormatExtendedSquitter ||
+                         downlink_format == TransponderPacket::kDownlinkFormatExtendedSquitterNonTransponder))
+                    {
+                        typecode = ADSBPacket(raw_packet.buffer, is_valid).GetTypeCode();
+                    }
+                    break;
+                case TransponderPacket::kParityCheckCorrectable:
+                {
+                    // Rare enough that it's not worth duplicating error correction here. Let TransponderPacket try to
+                    // repair the packet, and pull the fields from the repaired packet buffer.
+                    RawTransponderPacket raw_packet_with_crc = raw_packet;
+                    raw_packet_with_crc.crc = crcs[lane];
+                    raw_packet_with_crc.flags |= RawTransponderPacket::kFlagCRCCalculated;
+                    TransponderPacket packet = TransponderPacket(raw_packet_with_crc);
+                    is_valid = packet.IsValid();
+                    icao_address = packet.GetICAOAddress();
+                    if (is_valid)
+                    {
+                        typecode = ADSBPacket(packet).GetTypeCode();
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            if (batch.is_valid)
+            {
+                batch.is_valid[i] = is_valid;
+            }
+            if (batch.downlink_format)
+            {
+                batch.downlink_format[i] = downlink_format;
+            }
+            if (batch.icao_address)
+            {
+                batch.icao_address[i] = icao_address;
+            }
+            if (batch.typecode)
+            {
+                batch.typecode[i] = typecode;
+            }
+            num_valid_packets += is_valid;
+        }
+    }
+    return num_valid_packets;
+}
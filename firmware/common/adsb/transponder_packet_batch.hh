@@ -0,0 +1,36 @@
+#ifndef _TRANSPONDER_PACKET_BATCH_HH_
+#define _TRANSPONDER_PACKET_BATCH_HH_
+
+#include <cstdint>
+
+#include "adsb_packet.hh"
+
+/**
+ * Parallel output arrays for decode_transponder_packet_batch. Each array must have room for at least as many entries as
+ * there are packets in the batch. Arrays that aren't needed can be left as nullptr and won't be filled.
+ */
+struct TransponderPacketBatch
+{
+    bool *is_valid = nullptr;            // Same as TransponderPacket::IsValid().
+    uint16_t *downlink_format = nullptr; // Same as TransponderPacket::GetDownlinkFormat().
+    uint32_t *icao_address = nullptr;    // Same as TransponderPacket::GetICAOAddress().
+    uint16_t *typecode = nullptr;        // ADSBPacket::GetTypeCode() for valid DF17/18, kTypeCodeInvalid otherwise.
+};
+
+// Number of packets whose CRCs are calculated side by side. Each CRC is a chain of dependent table lookups, so
+// interleaving independent chains lets the CPU overlap their loads.
+const uint16_t kTransponderPacketBatchNumLanes = 4;
+
+/**
+ * Decodes the header fields of many raw packets at once, for bulk processing of recorded feeds. Gives the same results
+ * as constructing a TransponderPacket from each raw packet, including bit error correction, but only keeps the fields
+ * needed to sort and filter packets. Packets with kFlagCRCCalculated set reuse their precalculated CRC.
+ * @param[in] raw_packets Contiguous array of raw packets.
+ * @param[in] num_packets Number of packets in raw_packets.
+ * @param[out] batch Parallel arrays to fill with one entry per packet.
+ * @retval Number of valid packets in the batch.
+ */
+uint16_t decode_transponder_packet_batch(const RawTransponderPacket raw_packets[], uint16_t num_packets,
+                                         TransponderPacketBatch &batch);
+
+#endif /* _TRANSPONDER_PACKET_BATCH_HH_ */
@@ -0,0 +1,44 @@
+#ifndef PIPELINE_STATS_HH_
+#define PIPELINE_STATS_HH_
+
+#include <stdint.h>
+
+#include "settings.hh"
+
+/**
+ * Snapshot of the running totals kept at each stage of the receive pipeline, from preamble detection through to
+ * reporting. Comparing the totals of neighboring stages shows where frames are being lost. Totals wrap at 2^32, so
+ * rates should be taken from the difference between two snapshots.
+ */
+struct PipelineStats
+{
+    uint32_t timestamp_ms = 0; // Time that the snapshot was taken.
+
+    // Demodulation, counted by the DEMOD ISR on core0.
+    uint32_t num_preambles_matched = 0;
+    uint32_t num_demods_completed = 0; // Demodulated messages with a good end-of-frame word.
+    uint32_t num_demod_framing_errors = 0;
+
+    // Packet assembly, counted by the decode loop on core1.
+    uint32_t num_demod_ring_overruns = 0;
+    uint32_t num_demod_words_ingested = 0; // Words read out of the demod ring, across all 56 and 112-bit frames.
+    uint32_t num_frames_too_short = 0;
+    uint32_t num_frames_56_bit = 0;
+    uint32_t num_frames_112_bit = 0;
+
+    // Validation and ingestion, counted by the decode loop on core1.
+    uint32_t num_crc_passed = 0;    // Includes Address/Parity packets that matched a known ICAO address.
+    uint32_t num_crc_failed = 0;
+    uint32_t num_crc_corrected = 0; // Passed after bit error correction. Also counted in num_crc_passed.
+    uint32_t num_dictionary_evictions = 0;
+
+    // Packets dropped because a queue between stages was full.
+    uint32_t num_demod_marker_queue_drops = 0;
+    uint32_t num_transponder_packet_queue_drops = 0;
+    uint32_t num_reporting_queue_drops = 0;
+
+    // Reporting, counted by the reporting loop on core0.
+    uint32_t num_reported_bytes[SettingsManager::ReportingProtocol::kNumProtocols] = {0};
+};
+
+#endif /* PIPELINE_STATS_HH_ */
@@ -3,7 +3,7 @@
 
 #include <cstdint>
 
-static const uint32_t kSettingsVersionMagicWord = 0xBEEFBEEF; // Change this when settings format changes!
+static const uint32_t kSettingsVersionMagicWord = 0xBEEFBEF0; // Change this when settings format changes!
 
 class SettingsManager
 {
@@ -63,6 +63,7 @@ public:
         // ADSBee settings
         int tl_lo_mv = kDefaultTLLoMV;
         int tl_hi_mv = kDefaultTLHiMV;
+        bool tl_auto_tune_enabled = false; // Opt-in with AT+TL_AUTO=1.
         uint16_t rx_gain = kDefaultRxGain;
 
         // CommunicationsManager settings
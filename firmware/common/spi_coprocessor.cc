@@ -34,18 +34,19 @@ SPICoprocessor::AircraftListPacket::AircraftListPacket(uint16_t num_aicraft_in,
 {
     type = kSCPacketTypeAircraftList;
     num_aicraft = num_aicraft_in;
-    // Copy over the aircraft that we are tracking.
+    // Copy over the aircraft that we are tracking. The rest of the aircraft list is left off the end of the packet.
     for (uint16_t i = 0; i < num_aicraft; i++)
     {
         aircraft_list[i] = aircraft_list_in[i];
     }
-    // Set the rest of the aircraft list to 0's.
-    for (uint16_t i = num_aicraft; i < AircraftDictionary::kMaxNumAircraft; i++)
-    {
-        aircraft_list[i] = Aircraft();
-    }
-    // memset(&(aircraft_list[num_aicraft]), 0, sizeof(Aircraft) * (AircraftDictionary::kMaxNumAircraft - num_aicraft));
-    PopulateCRCAndLength(sizeof(AircraftListPacket) - sizeof(SCPacket));
+    PopulateCRCAndLength(GetLength(num_aicraft) - sizeof(SCPacket));
+}
+
+SPICoprocessor::PipelineStatsPacket::PipelineStatsPacket(const PipelineStats &stats_in)
+{
+    type = kSCPacketTypePipelineStats;
+    stats = stats_in;
+    PopulateCRCAndLength(sizeof(PipelineStatsPacket) - sizeof(SCPacket));
 }
 
 bool SPICoprocessor::Init()
@@ -3,6 +3,7 @@
 
 #include "adsb_packet.hh"
 #include "aircraft_dictionary.hh"
+#include "pipeline_stats.hh"
 #include "settings.hh"
 
 #ifdef ON_PICO
@@ -32,7 +33,8 @@ public:
         kSCPacketTypeInvalid = -1,
         kSCPacketTypeSettings,
         kSCPacketTypeNetworkMessage,
-        kSCPacketTypeAircraftList
+        kSCPacketTypeAircraftList,
+        kSCPacketTypePipelineStats
     };
 
     struct SCPacket
@@ -81,6 +83,29 @@ public:
          * @retval The constructed AircraftListPacket.
          */
         AircraftListPacket(uint16_t num_aicraft_in, const Aircraft aircraft_list_in[]);
+
+        /**
+         * Returns the number of bytes in an AircraftListPacket, which only includes the aircraft that are in the list.
+         * Lets a list of only the aircraft that have changed go out in a shorter packet.
+         * @param[in] num_aircraft Number of aircraft in the list.
+         */
+        static uint32_t GetLength(uint16_t num_aircraft)
+        {
+            return sizeof(AircraftListPacket) - (AircraftDictionary::kMaxNumAircraft - num_aircraft) * sizeof(Aircraft);
+        }
+    };
+
+    struct PipelineStatsPacket : public SCPacket
+    {
+        PipelineStats stats;
+
+        /**
+         * PipelineStatsPacket constructor. Populates the pipeline statistics and adds length, packet type, and CRC
+         * info to parent.
+         * @param[in] stats_in Reference to a PipelineStats snapshot to send over.
+         * @retval The constructed PipelineStatsPacket.
+         */
+        PipelineStatsPacket(const PipelineStats &stats_in);
     };
 
     // NOTE: Pico (leader) and ESP32 (follower) will have different behaviors for these functions.
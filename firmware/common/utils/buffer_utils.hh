@@ -9,6 +9,34 @@ uint32_t get_24_bit_word_from_buffer(uint32_t first_bit_index, const uint32_t bu
 uint32_t get_n_bit_word_from_buffer(uint16_t n, uint32_t first_bit_index, const uint32_t buffer[]);
 void set_n_bit_word_in_buffer(uint16_t n, uint32_t word, uint32_t first_bit_index, uint32_t buffer[]);
 
+/**
+ * Compile-time version of get_n_bit_word_from_buffer for fields at a fixed location, e.g. fields in a Mode S packet.
+ * Word length is checked at compile time and each call boils down to a fixed shift and mask (plus an OR if the field
+ * straddles two words). Does NOT guard against falling off the end of the buffer, so be careful!
+ * @param[in] FirstBitIndex Bit index to begin reading from. MSb of first word in buffer is bit 0.
+ * @param[in] N Bitlength of word to extract.
+ * @param[in] buffer Buffer to read from.
+ * @retval Right-aligned N-bit word that was read from the buffer.
+ */
+template <unsigned FirstBitIndex, unsigned N>
+constexpr uint32_t get_n_bit_word_from_buffer(const uint32_t buffer[])
+{
+    static_assert(N >= 1 && N <= 32, "Word bitlength must be between 1 and 32.");
+    constexpr unsigned kWordIndex = FirstBitIndex / 32;
+    constexpr unsigned kBitOffset = FirstBitIndex % 32;
+    constexpr uint32_t kMask = UINT32_MAX >> (32 - N);
+    if constexpr (kBitOffset + N <= 32)
+    {
+        return (buffer[kWordIndex] >> (32 - kBitOffset - N)) & kMask;
+    }
+    else
+    {
+        // Field straddles two words.
+        return ((buffer[kWordIndex] << (kBitOffset + N - 32)) | (buffer[kWordIndex + 1] >> (64 - kBitOffset - N))) &
+               kMask;
+    }
+}
+
 // CRC16 is used for inter-processor communication and reporting, not for ADS-B message decode.
 
 /**
@@ -3,144 +3,236 @@
 
 #include <stdint.h>
 
-#include <algorithm> // For std::copy.
+#include <atomic>
 
+/**
+ * Lock-free single-producer/single-consumer ring buffer. Safe to use between an ISR and the main loop, or between the
+ * two RP2040 cores, as long as only one context calls the producer functions (Push, ReservePushSpan, CommitPush) and
+ * only one context calls the consumer functions (Pop, Peek, PeekSpan, CommitPop, Clear). Head and tail are free running
+ * 16-bit counters that are masked into the buffer, so the capacity must be a power of 2 and every slot is usable.
+ */
 template <class T>
-class PFBQueue
+class SPSCQueue
 {
 public:
-    struct PFBQueueConfig
+    static const uint16_t kMaxCapacity = 1 << 15; // Head and tail counters need to be able to tell full from empty.
+
+    struct SPSCQueueConfig
     {
-        uint16_t buf_len_num_elements = 0;
+        uint16_t buf_len_num_elements = 0; // Must be a power of 2, rounded down if not.
         T *buffer = nullptr;
     };
 
     /**
      * Constructor.
-     * NOTE: Copy and move constructors are not implemented! Pass by reference only to avoid creating a "double free"
-     * error, which is caused by two PFBQueues sharing the same buffer, and both trying to free it when they are
-     * destroyed.
-     * @param[in] config_in Defines length of the buffer, and points to the buffer of size buf_len_num_elements+1 if
-     * PFBQueue should work with a pre-allocated buffer. If config_in.buffer is left as nullptr, a buffer will be
-     * dynamically allocated of size buf_len_num_elements * sizeof(T).
-     * @retval PFBQueue object.
-     */
-    PFBQueue(PFBQueueConfig config_in) : config_(config_in), buffer_length_(config_in.buf_len_num_elements)
+     * NOTE: Copy and move constructors are not implemented! Pass by reference only.
+     * @param[in] config_in Defines length of the buffer, and points to a buffer of buf_len_num_elements elements if
+     * SPSCQueue should work with a pre-allocated buffer. If config_in.buffer is left as nullptr, a buffer will be
+     * dynamically allocated.
+     * @retval SPSCQueue object.
+     */
+    SPSCQueue(SPSCQueueConfig config_in) : config_(config_in)
     {
+        capacity_ = 1;
+        while (capacity_ * 2 <= config_.buf_len_num_elements && capacity_ < kMaxCapacity)
+        {
+            capacity_ *= 2;
+        }
+        if (config_.buf_len_num_elements == 0)
+        {
+            capacity_ = 0;
+        }
         if (config_.buffer == nullptr)
         {
-            config_.buffer = (T *)malloc(sizeof(T) * buffer_length_);
+            config_.buffer = (T *)malloc(sizeof(T) * capacity_);
             buffer_was_dynamically_allocated_ = true;
         }
     }
 
     /**
-     * Destructor. Frees the buffer buffer if it was dynamically allocated.
+     * Destructor. Frees the buffer if it was dynamically allocated.
      */
-    ~PFBQueue()
+    ~SPSCQueue()
     {
         if (buffer_was_dynamically_allocated_ && config_.buffer != nullptr)
         {
             free(config_.buffer);
-            config_.buffer = nullptr; // Prevent double free in case of shallow copy.
+            config_.buffer = nullptr;
         }
     }
 
     /**
-     * Pushes an element onto the buffer.
-     * @param[in] element Object to push onto the back of the buffer.
-     * @retval True if succeeded, false if the buffer is full.
+     * Pushes an element onto the back of the queue. Producer only.
+     * @param[in] element Object to push.
+     * @retval True if succeeded, false if the queue is full (counted as an overflow).
      */
-    bool Push(T element)
+    bool Push(const T &element) { return Push(&element, 1) == 1; }
+
+    /**
+     * Pushes multiple elements onto the back of the queue. Producer only.
+     * @param[in] elements Array of objects to push, in order.
+     * @param[in] num_elements Number of elements in the array.
+     * @retval Number of elements pushed. Any that didn't fit are dropped and counted as overflows.
+     */
+    uint16_t Push(const T elements[], uint16_t num_elements)
     {
-        uint16_t next_tail = IncrementIndex(tail_);
-        if (next_tail == head_)
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        uint16_t num_free = capacity_ - static_cast<uint16_t>(tail - head_.load(std::memory_order_acquire));
+        uint16_t num_to_push = num_elements < num_free ? num_elements : num_free;
+        for (uint16_t i = 0; i < num_to_push; i++)
         {
-            return false;
+            config_.buffer[static_cast<uint16_t>(tail + i) & (capacity_ - 1)] = elements[i];
         }
-        config_.buffer[tail_] = element;
-        tail_ = next_tail;
-        return true;
+        if (num_to_push < num_elements)
+        {
+            num_overflows_.store(num_overflows_.load(std::memory_order_relaxed) + (num_elements - num_to_push),
+                                 std::memory_order_relaxed);
+        }
+        CommitPush(num_to_push);
+        return num_to_push;
     }
 
     /**
-     * Pops an element from the front of the buffer.
+     * Returns a contiguous run of free slots at the back of the queue that can be filled in place, then published with
+     * CommitPush. Producer only. The run stops at the end of the buffer, so it may be shorter than the free space.
+     * @param[out] span Pointer to the first free slot.
+     * @retval Number of free slots in the run.
+     */
+    uint16_t ReservePushSpan(T *&span)
+    {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        uint16_t num_free = capacity_ - static_cast<uint16_t>(tail - head_.load(std::memory_order_acquire));
+        uint16_t index = tail & (capacity_ - 1);
+        uint16_t num_to_end = capacity_ - index;
+        span = &config_.buffer[index];
+        return num_free < num_to_end ? num_free : num_to_end;
+    }
+
+    /**
+     * Publishes elements written in place after ReservePushSpan. Producer only.
+     * @param[in] num_elements Number of elements to publish, must not be more than were reserved.
+     */
+    void CommitPush(uint16_t num_elements)
+    {
+        uint16_t tail = tail_.load(std::memory_order_relaxed) + num_elements;
+        tail_.store(tail, std::memory_order_release); // Publish the elements only after they've been written.
+        uint16_t length = tail - head_.load(std::memory_order_relaxed);
+        if (length > high_water_mark_.load(std::memory_order_relaxed))
+        {
+            high_water_mark_.store(length, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Pops an element from the front of the queue. Consumer only.
      * @param[out] element Reference to an object that will be overwritten by the contents of the popped element.
-     * @retval True if successful, false if the buffer is empty.
+     * @retval True if successful, false if the queue is empty.
      */
-    bool Pop(T &element)
+    bool Pop(T &element) { return Pop(&element, 1) == 1; }
+
+    /**
+     * Pops multiple elements from the front of the queue. Consumer only.
+     * @param[out] elements Array to fill with popped elements, in order.
+     * @param[in] max_num_elements Size of the array.
+     * @retval Number of elements popped.
+     */
+    uint16_t Pop(T elements[], uint16_t max_num_elements)
     {
-        if (head_ == tail_)
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        uint16_t length = tail_.load(std::memory_order_acquire) - head;
+        uint16_t num_to_pop = max_num_elements < length ? max_num_elements : length;
+        for (uint16_t i = 0; i < num_to_pop; i++)
         {
-            return false;
+            elements[i] = config_.buffer[static_cast<uint16_t>(head + i) & (capacity_ - 1)];
         }
-        element = config_.buffer[head_];
-        head_ = IncrementIndex(head_);
-        return true;
+        CommitPop(num_to_pop);
+        return num_to_pop;
     }
 
     /**
-     * Returns the contents of an element in the buffer without removing it from the buffer.
+     * Returns the contents of an element in the queue without removing it. Consumer only.
      * @param[out] element Reference to an object that will be overwritten by the contents of the peeked element.
-     * @param[in] index Position in the buffer to peek. Defaults to 0 (the front of the buffer).
-     * @retval True if successful, false if the buffer is empty or index is out of bounds.
+     * @param[in] index Position in the queue to peek. Defaults to 0 (the front of the queue).
+     * @retval True if successful, false if index is out of bounds.
      */
     bool Peek(T &element, uint16_t index = 0)
     {
-        if (index >= Length())
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        if (index >= static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head))
         {
             return false;
         }
-        element = config_.buffer[IncrementIndex(head_, index)];
+        element = config_.buffer[static_cast<uint16_t>(head + index) & (capacity_ - 1)];
         return true;
     }
 
     /**
-     * Returns the number of elements currently in the buffer.
-     * @retval Number of elements in the buffer.
+     * Returns a contiguous run of elements at the front of the queue that can be read in place, then released with
+     * CommitPop. Consumer only. The run stops at the end of the buffer, so it may be shorter than Length().
+     * @param[out] span Pointer to the first element.
+     * @retval Number of elements in the run.
      */
-    uint16_t Length()
+    uint16_t PeekSpan(const T *&span)
     {
-        if (head_ == tail_)
-        {
-            return 0; // Empty.
-        }
-        else if (head_ > tail_)
-        {
-            return buffer_length_ - (head_ - tail_); // Wrapped.
-        }
-        else
-        {
-            return tail_ - head_; // Not wrapped.
-        }
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        uint16_t length = tail_.load(std::memory_order_acquire) - head;
+        uint16_t index = head & (capacity_ - 1);
+        uint16_t num_to_end = capacity_ - index;
+        span = &config_.buffer[index];
+        return length < num_to_end ? length : num_to_end;
     }
 
     /**
-     * Empty out the buffer by setting the head equal to the tail.
+     * Releases elements from the front of the queue after they've been read with PeekSpan. Consumer only.
+     * @param[in] num_elements Number of elements to release, must not be more than are in the queue.
      */
-    void Clear()
+    void CommitPop(uint16_t num_elements)
     {
-        head_ = tail_;
+        // Free the slots only after they've been read.
+        head_.store(head_.load(std::memory_order_relaxed) + num_elements, std::memory_order_release);
     }
 
-private:
     /**
-     * Increments and wraps a buffer index. Index must be < 2*(config_.buf_len_num_elements+1)!
-     * @param[in] index Value to increment and wrap.
-     * @param[in] increment Value to increment the index by. Defaults to 1.
-     * @retval Incremented and wrapped value.
+     * Returns the number of elements currently in the queue. Exact from either side, since the other side can only
+     * make the queue shorter (if called by the producer) or longer (if called by the consumer) in the meantime.
+     * @retval Number of elements in the queue.
      */
-    uint16_t IncrementIndex(uint16_t index, uint16_t increment = 1)
+    uint16_t Length() const
     {
-        index += increment;
-        return index >= buffer_length_ ? index - buffer_length_ : index;
+        return static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
     }
 
-    PFBQueueConfig config_;
+    /**
+     * Returns the maximum number of elements that the queue can hold.
+     */
+    uint16_t Capacity() const { return capacity_; }
+
+    /**
+     * Empties out the queue by moving the head up to the tail. Consumer only.
+     */
+    void Clear() { head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release); }
+
+    /**
+     * Returns the number of elements that were dropped because the queue was full.
+     */
+    uint32_t GetNumOverflows() const { return num_overflows_.load(std::memory_order_relaxed); }
+
+    /**
+     * Returns the most elements that have ever been in the queue at once.
+     */
+    uint16_t GetHighWaterMark() const { return high_water_mark_.load(std::memory_order_relaxed); }
+
+private:
+    SPSCQueueConfig config_;
     bool buffer_was_dynamically_allocated_ = false;
-    uint16_t buffer_length_;
-    uint16_t head_ = 0;
-    uint16_t tail_ = 0;
+    uint16_t capacity_ = 0;
+
+    std::atomic<uint16_t> head_ = 0; // Only written by the consumer.
+    std::atomic<uint16_t> tail_ = 0; // Only written by the producer.
+    // Statistics, only written by the producer. Plain loads and stores only, since the RP2040's Cortex-M0+ cores have
+    // no atomic read-modify-write instructions.
+    std::atomic<uint32_t> num_overflows_ = 0;
+    std::atomic<uint16_t> high_water_mark_ = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "load_counter.hh"
+
+void LoadCounter::RecordIteration(uint32_t start_us, uint32_t end_us, bool did_work)
+{
+    if (!window_started_)
+    {
+        window_start_us_ = start_us;
+        window_started_ = true;
+    }
+
+    uint32_t iteration_us = end_us - start_us;
+    if (did_work)
+    {
+        window_busy_us_ += iteration_us;
+    }
+    if (iteration_us > window_max_iteration_us_)
+    {
+        window_max_iteration_us_ = iteration_us;
+    }
+    window_num_iterations_++;
+
+    uint32_t window_elapsed_us = end_us - window_start_us_;
+    if (window_elapsed_us >= config_.window_us)
+    {
+        load_percent_ = static_cast<uint64_t>(window_busy_us_) * 100 / window_elapsed_us;
+        max_iteration_us_ = window_max_iteration_us_;
+        num_iterations_ = window_num_iterations_;
+
+        window_start_us_ = end_us;
+        window_busy_us_ = 0;
+        window_max_iteration_us_ = 0;
+        window_num_iterations_ = 0;
+    }
+}
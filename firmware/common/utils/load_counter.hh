@@ -0,0 +1,73 @@
+#ifndef LOAD_COUNTER_HH_
+#define LOAD_COUNTER_HH_
+
+#include <stdint.h>
+
+/**
+ * Measures how busy a polling loop is. Each pass through the loop is recorded along with whether it found any work to
+ * do, and passes that did work count as busy time. Statistics are latched at the end of each window so that they can
+ * be read from another core at any time.
+ */
+class LoadCounter
+{
+public:
+    static const uint32_t kDefaultWindowUs = 1e6;
+
+    struct LoadCounterConfig_t
+    {
+        uint32_t window_us = kDefaultWindowUs; // Length of the window that statistics are latched over.
+    };
+
+    /**
+     * Default constructor. Uses default config values.
+     */
+    LoadCounter() {};
+
+    /**
+     * Constructor with config values specified.
+     */
+    LoadCounter(LoadCounterConfig_t config_in) : config_(config_in) {};
+
+    /**
+     * Records one pass through the loop.
+     * @param[in] start_us Timestamp at the start of the pass, in microseconds.
+     * @param[in] end_us Timestamp at the end of the pass, in microseconds.
+     * @param[in] did_work True if the pass did useful work, false if it only polled for work and found none.
+     */
+    void RecordIteration(uint32_t start_us, uint32_t end_us, bool did_work);
+
+    /**
+     * Returns the percentage of time spent doing work during the last complete window.
+     * @retval Load from 0-100.
+     */
+    uint16_t GetLoadPercent() const { return load_percent_; }
+
+    /**
+     * Returns the longest single pass through the loop during the last complete window. Long passes show where the
+     * loop got stalled by something like a blocking write.
+     * @retval Duration of the longest pass in microseconds.
+     */
+    uint32_t GetMaxIterationUs() const { return max_iteration_us_; }
+
+    /**
+     * Returns the number of passes through the loop during the last complete window.
+     */
+    uint32_t GetNumIterations() const { return num_iterations_; }
+
+private:
+    LoadCounterConfig_t config_;
+
+    // Accumulators for the window in progress.
+    bool window_started_ = false;
+    uint32_t window_start_us_ = 0;
+    uint32_t window_busy_us_ = 0;
+    uint32_t window_max_iteration_us_ = 0;
+    uint32_t window_num_iterations_ = 0;
+
+    // Latched statistics from the last complete window.
+    volatile uint16_t load_percent_ = 0;
+    volatile uint32_t max_iteration_us_ = 0;
+    volatile uint32_t num_iterations_ = 0;
+};
+
+#endif /* LOAD_COUNTER_HH_ */
@@ -5,6 +5,7 @@ static const int kUsPerMs = 1000;
 static const int kBytesPerWord = 4;
 static const int kBitsPerByte = 8;
 static const int kBitsPerNibble = 4;
+static const int kBitsPerWord = 32;
 
 inline int FeetToMeters(int feet) { return feet * 1000 / 3280; }
 
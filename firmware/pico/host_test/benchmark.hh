@@ -0,0 +1,25 @@
+#ifndef BENCHMARK_HH_
+#define BENCHMARK_HH_
+
+#include <chrono>
+#include <cstdint>
+
+// Helpers for the DISABLED_*Benchmark tests. They only report timings, so they're kept out of the normal test run, see
+// README.md for how to run them.
+
+// Benchmarks fold their results into this so that the compiler can't throw the work being timed away.
+inline volatile uint32_t benchmark_sink = 0;
+
+/**
+ * Runs a function once and times it with a steady clock.
+ * @param[in] fn Function to time, usually a lambda wrapping the loop being benchmarked.
+ * @retval Elapsed time in nanoseconds.
+ */
+template <class Fn>
+float benchmark_ns(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif /* BENCHMARK_HH_ */
@@ -0,0 +1,457 @@
+#include "software_demodulator.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "demod_frame.hh"
+#include "macros.hh"
+
+// Preamble detectors run on state machines 0 and 2 of their PIO, same as on the receiver.
+static const uint16_t kPreambleDetectorSMs[SoftwareDemodulator::kNumPreambleDetectors] = {0, 2};
+static const int kRxGain = 1;  // Captures are taken after the rx gain stage.
+// GPIO inputs pass through a 2-flop synchronizer clocked by clk_sys before the PIO can see them.
+static const uint16_t kGPIOSynchronizerNumFlops = 2;
+
+// One entry per instruction of .program preamble_detector.
+enum PreambleDetectorInstruction : uint16_t {
+    kPDWaitForToken = 0,          // wait 1 irq 4 rel
+    kPDWaitingForFirstEdge,       // set x, 1
+    kPDWaitForFirstEdge,          // wait 1 pin, pulses_pin_index [3]
+    kPDCheckPulse1Hi,             // jmp pin check_pulse_1_lo [7]
+    kPDAbortPulse1Hi,             // jmp waiting_for_first_edge
+    kPDCheckPulse1Lo,             // jmp pin waiting_for_first_edge [7]
+    kPDCheckPulse2Hi,             // jmp pin check_pulse_2_lo [7]
+    kPDAbortPulse2Hi,             // jmp waiting_for_first_edge
+    kPDCheckPulse2Lo,             // jmp pin waiting_for_first_edge [7]
+    kPDCheckIdle1,                // jmp pin waiting_for_first_edge [7]
+    kPDCheckIdle2,                // jmp pin waiting_for_first_edge [7]
+    kPDCheckIdle3,                // jmp pin waiting_for_first_edge [6]
+    kPDLoopDoublePulse,           // jmp x-- check_pulse_1_hi
+    kPDPreambleTail,              // jmp pin waiting_for_first_edge [7]
+    kPDPreambleTailDelay,         // nop [5]
+    kPDPreambleMatched,           // set pins 1
+    kPDWaitForMessageEye,         // wait 1 pin, pulses_pin_index [3]
+    kPDWaitingForEndOfMessage,    // set x, 20
+    kPDIdleCountdown,             // jmp pin waiting_for_end_of_message [1]
+    kPDIdleCountdownLoop,         // jmp x-- idle_countdown
+    kPDRaiseDemodIRQ,             // irq set 0 rel side 0
+    kPDPassToken,                 // irq set 6 rel
+    kPDWaitForDemodComplete       // wait 0 irq 0 rel
+};
+
+// One entry per instruction of .program message_demodulator.
+enum MessageDemodulatorInstruction : uint16_t {
+    kMDJumpToInitialEntry = 0,  // jmp initial_entry
+    kMDCompleteDemod,           // push block
+    kMDLoadNumBits,             // mov isr, x
+    kMDPushEndOfFrame,          // push block
+    kMDResetBitCounter,         // mov x, ~null
+    kMDResetY,                  // set y, 1
+    kMDWaitForDemodLo,          // wait 0 pin demod_in_pin_index
+    kMDInitialEntry,            // wait 1 pin demod_in_pin_index side 0
+    kMDCheckFirstBit,           // jmp pin start_of_1 side 0
+    kMDFirstBitIs0,             // jmp start_of_0 side 0
+    kMDStartOf1,                // nop [1]
+    kMDWaitForFallingEdge1,     // wait 0 pin pulses_pin_index
+    kMDFallingEdge1,            // in y, 1 side 1
+    kMDCount1,                  // jmp x-- check_demod
+    kMDStartOf0,                // set y, 7 [1]
+    kMDWaitForRisingEdge0,      // jmp pin rising_edge_0
+    kMDRisingEdge0Timeout,      // jmp y-- wait_for_rising_edge_0
+    kMDEndOfMessage,            // jmp complete_demod
+    kMDRisingEdge0,             // in null, 1 side 1 [2]
+    kMDCount0,                  // jmp x-- check_demod
+    kMDCheckDemod,              // mov osr, pins
+    kMDDumpPulsesBit,           // out null, 1
+    kMDReadDemodBit,            // out y, 1
+    kMDDumpRemainingBits,       // out null, 30
+    kMDBailIfDemodLo,           // jmp !y complete_demod
+    kMDWaitForSlope,            // nop [1]
+    kMDCheckNextBit             // jmp pin start_of_1 side 0, then .wrap to start_of_0
+};
+
+/**
+ * Returns the IRQ flag that a relative IRQ index refers to for a state machine. Like the PIO, the state machine number
+ * is added to the lower 2 bits of the index.
+ */
+static inline uint16_t rel_irq(uint16_t irq_index, uint16_t sm) {
+    return (irq_index & 0b100) | ((irq_index + sm) & 0b11);
+}
+
+void SoftwareDemodulator::Reset() {
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        preamble_detectors_[i] = PIOStateMachine();
+    }
+    message_demodulator_ = PIOStateMachine();
+    // Same initial state as message_demodulator_program_init.
+    message_demodulator_.x = ~0u;
+    message_demodulator_.y = 1;
+    // Hand the first token to the first preamble detector, like ADSBee::Init.
+    irq_flags_ = 1 << rel_irq(4, kPreambleDetectorSMs[0]);
+    pulses_pin_ = false;
+    demod_pin_ = false;
+    next_demod_pin_ = false;
+    next_preamble_detector_index_ = 0;
+
+    memset(demod_ring_buffer_, 0, sizeof(demod_ring_buffer_));
+    demod_ring_num_words_written_ = 0;
+    demod_ring_last_message_end_word_count_ = 0;
+    mlat_latches_.clear();
+    demod_isr_pending_ = false;
+    demod_isr_pio_cycle_ = 0;
+    rssi_peak_adc_counts_ = 0;
+
+    num_pio_cycles_ = 0;
+    num_samples_ingested_ = 0;
+    num_frames_ = 0;
+    num_framing_errors_ = 0;
+    packets.clear();
+}
+
+void SoftwareDemodulator::Ingest(const bool pulses[], const uint16_t rssi_adc_counts[], uint32_t num_samples) {
+    // The PIO clock is divided down from clk_sys by a fractional divider, so each PIO cycle lands on a whole clk_sys
+    // cycle, and sees the inputs as they were when they entered the synchronizer a few clk_sys cycles before that.
+    // Hold each sample until then.
+    double clk_sys_cycles_per_pio_cycle = config_.clk_sys_hz / kPIOClockHz;
+    double samples_per_clk_sys_cycle = config_.sample_rate_hz / config_.clk_sys_hz;
+    uint64_t end_sample = num_samples_ingested_ + num_samples;
+    while (true) {
+        int64_t clk_sys_cycle =
+            static_cast<int64_t>(num_pio_cycles_ * clk_sys_cycles_per_pio_cycle) - kGPIOSynchronizerNumFlops;
+        uint64_t sample = static_cast<uint64_t>(MAX(clk_sys_cycle, 0) * samples_per_clk_sys_cycle);
+        if (sample >= end_sample) {
+            break;
+        }
+        uint32_t i = sample - num_samples_ingested_;
+        Step(pulses[i], rssi_adc_counts[i]);
+    }
+    num_samples_ingested_ = end_sample;
+}
+
+void SoftwareDemodulator::IngestMilliVolts(const float samples_mv[], uint32_t num_samples, int tl_mv) {
+    const uint32_t kBlockNumSamples = 1024;
+    bool pulses[kBlockNumSamples];
+    uint16_t rssi_adc_counts[kBlockNumSamples];
+    for (uint32_t block_start = 0; block_start < num_samples; block_start += kBlockNumSamples) {
+        uint32_t block_num_samples = MIN(kBlockNumSamples, num_samples - block_start);
+        for (uint32_t i = 0; i < block_num_samples; i++) {
+            float sample_mv = samples_mv[block_start + i];
+            pulses[i] = sample_mv > tl_mv;
+            float adc_counts = sample_mv * kRSSIADCMaxCounts / kRSSIADCReferenceMilliVolts;
+            rssi_adc_counts[i] =
+                static_cast<uint16_t>(MIN(MAX(adc_counts, 0.0f), static_cast<float>(kRSSIADCMaxCounts)));
+        }
+        Ingest(pulses, rssi_adc_counts, block_num_samples);
+    }
+}
+
+void SoftwareDemodulator::Step(bool pulses, uint16_t rssi_adc_counts) {
+    pulses_pin_ = pulses;
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        StepPreambleDetector(i);
+    }
+    StepMessageDemodulator();
+
+    // mlat_counter latches the count at the DEMOD rising edge.
+    if (next_demod_pin_ && !demod_pin_) {
+        mlat_latches_.push_back(num_pio_cycles_);
+    }
+    demod_pin_ = next_demod_pin_;
+    // The peak detector holds the highest RSSI until the DEMOD ISR clears it.
+    rssi_peak_adc_counts_ = MAX(rssi_peak_adc_counts_, rssi_adc_counts);
+    num_pio_cycles_++;
+
+    // The DEMOD IRQ stays raised until the ISR clears the flags, and the ISR gets to it some time after it goes up.
+    for (uint16_t i = 0; i < kNumPreambleDetectors && !demod_isr_pending_; i++) {
+        if (irq_flags_ & (1 << rel_irq(0, kPreambleDetectorSMs[i]))) {
+            demod_isr_pending_ = true;
+            demod_isr_pio_cycle_ =
+                num_pio_cycles_ + static_cast<uint64_t>(config_.demod_isr_latency_us * kPIOClockHz / 1e6);
+        }
+    }
+    if (demod_isr_pending_ && num_pio_cycles_ >= demod_isr_pio_cycle_) {
+        demod_isr_pending_ = false;
+        OnDemodComplete();
+    }
+}
+
+void SoftwareDemodulator::StepPreambleDetector(uint16_t index) {
+    PIOStateMachine &sm = preamble_detectors_[index];
+    if (sm.delay > 0) {
+        sm.delay--;
+        return;
+    }
+    uint16_t sm_num = kPreambleDetectorSMs[index];
+    switch (sm.pc) {
+        case kPDWaitForToken:
+            if (irq_flags_ & (1 << rel_irq(4, sm_num))) {
+                irq_flags_ &= ~(1 << rel_irq(4, sm_num));  // wait 1 irq clears the flag.
+                Advance(sm, kPDWaitingForFirstEdge);
+            }
+            break;
+        case kPDWaitingForFirstEdge:
+            sm.x = 1;
+            Advance(sm, kPDWaitForFirstEdge);
+            break;
+        case kPDWaitForFirstEdge:
+            if (pulses_pin_) {
+                Advance(sm, kPDCheckPulse1Hi, 3);
+            }
+            break;
+        case kPDCheckPulse1Hi:
+            Advance(sm, pulses_pin_ ? kPDCheckPulse1Lo : kPDAbortPulse1Hi, 7);
+            break;
+        case kPDAbortPulse1Hi:
+        case kPDAbortPulse2Hi:
+            Advance(sm, kPDWaitingForFirstEdge);
+            break;
+        case kPDCheckPulse1Lo:
+            Advance(sm, pulses_pin_ ? kPDWaitingForFirstEdge : kPDCheckPulse2Hi, 7);
+            break;
+        case kPDCheckPulse2Hi:
+            Advance(sm, pulses_pin_ ? kPDCheckPulse2Lo : kPDAbortPulse2Hi, 7);
+            break;
+        case kPDCheckPulse2Lo:
+        case kPDCheckIdle1:
+        case kPDCheckIdle2:
+            Advance(sm, pulses_pin_ ? kPDWaitingForFirstEdge : sm.pc + 1, 7);
+            break;
+        case kPDCheckIdle3:
+            Advance(sm, pulses_pin_ ? kPDWaitingForFirstEdge : kPDLoopDoublePulse, 6);
+            break;
+        case kPDLoopDoublePulse:
+            Advance(sm, sm.x-- ? kPDCheckPulse1Hi : kPDPreambleTail);
+            break;
+        case kPDPreambleTail:
+            Advance(sm, pulses_pin_ ? kPDWaitingForFirstEdge : kPDPreambleTailDelay, 7);
+            break;
+        case kPDPreambleTailDelay:
+            Advance(sm, kPDPreambleMatched, 5);
+            break;
+        case kPDPreambleMatched:
+            next_demod_pin_ = true;
+            Advance(sm, kPDWaitForMessageEye);
+            break;
+        case kPDWaitForMessageEye:
+            if (pulses_pin_) {
+                Advance(sm, kPDWaitingForEndOfMessage, 3);
+            }
+            break;
+        case kPDWaitingForEndOfMessage:
+            sm.x = 20;
+            Advance(sm, kPDIdleCountdown);
+            break;
+        case kPDIdleCountdown:
+            Advance(sm, pulses_pin_ ? kPDWaitingForEndOfMessage : kPDIdleCountdownLoop, 1);
+            break;
+        case kPDIdleCountdownLoop:
+            Advance(sm, sm.x-- ? kPDIdleCountdown : kPDRaiseDemodIRQ);
+            break;
+        case kPDRaiseDemodIRQ:
+            next_demod_pin_ = false;
+            irq_flags_ |= 1 << rel_irq(0, sm_num);
+            Advance(sm, kPDPassToken);
+            break;
+        case kPDPassToken:
+            irq_flags_ |= 1 << rel_irq(6, sm_num);
+            Advance(sm, kPDWaitForDemodComplete);
+            break;
+        case kPDWaitForDemodComplete:
+            if (!(irq_flags_ & (1 << rel_irq(0, sm_num)))) {
+                Advance(sm, kPDWaitForToken);  // .wrap
+            }
+            break;
+    }
+}
+
+void SoftwareDemodulator::StepMessageDemodulator() {
+    PIOStateMachine &sm = message_demodulator_;
+    if (sm.delay > 0) {
+        sm.delay--;
+        return;
+    }
+    // The demodulator's DEMOD input is wired to the preamble detectors' DEMOD output.
+    bool demod_in_pin = demod_pin_;
+    switch (sm.pc) {
+        case kMDJumpToInitialEntry:
+            Advance(sm, kMDInitialEntry);
+            break;
+        case kMDCompleteDemod:
+        case kMDPushEndOfFrame:
+            PushDemodWord(sm.isr);
+            Advance(sm, sm.pc + 1);
+            break;
+        case kMDLoadNumBits:
+            sm.isr = sm.x;
+            sm.isr_shift_count = 0;
+            Advance(sm, kMDPushEndOfFrame);
+            break;
+        case kMDResetBitCounter:
+            sm.x = ~0u;
+            Advance(sm, kMDResetY);
+            break;
+        case kMDResetY:
+            sm.y = 1;
+            Advance(sm, kMDWaitForDemodLo);
+            break;
+        case kMDWaitForDemodLo:
+            if (!demod_in_pin) {
+                Advance(sm, kMDInitialEntry);
+            }
+            break;
+        case kMDInitialEntry:
+            if (demod_in_pin) {
+                Advance(sm, kMDCheckFirstBit);
+            }
+            break;
+        case kMDCheckFirstBit:
+            Advance(sm, pulses_pin_ ? kMDStartOf1 : kMDFirstBitIs0);
+            break;
+        case kMDFirstBitIs0:
+            Advance(sm, kMDStartOf0);
+            break;
+        case kMDStartOf1:
+            Advance(sm, kMDWaitForFallingEdge1, 1);
+            break;
+        case kMDWaitForFallingEdge1:
+            if (!pulses_pin_) {
+                Advance(sm, kMDFallingEdge1);
+            }
+            break;
+        case kMDFallingEdge1:
+            ShiftInDemodBit(sm.y);
+            Advance(sm, kMDCount1);
+            break;
+        case kMDCount1:
+            Advance(sm, sm.x-- ? kMDCheckDemod : kMDStartOf0);
+            break;
+        case kMDStartOf0:
+            sm.y = 7;
+            Advance(sm, kMDWaitForRisingEdge0, 1);
+            break;
+        case kMDWaitForRisingEdge0:
+            Advance(sm, pulses_pin_ ? kMDRisingEdge0 : kMDRisingEdge0Timeout);
+            break;
+        case kMDRisingEdge0Timeout:
+            Advance(sm, sm.y-- ? kMDWaitForRisingEdge0 : kMDEndOfMessage);
+            break;
+        case kMDEndOfMessage:
+            Advance(sm, kMDCompleteDemod);
+            break;
+        case kMDRisingEdge0:
+            ShiftInDemodBit(0);
+            Advance(sm, kMDCount0, 2);
+            break;
+        case kMDCount0:
+            sm.x--;  // Falls through to check_demod either way.
+            Advance(sm, kMDCheckDemod);
+            break;
+        case kMDCheckDemod:
+            // IN pins start at the pulses pin, followed by the DEMOD input.
+            sm.osr = (pulses_pin_ ? 0b01 : 0) | (demod_in_pin ? 0b10 : 0);
+            Advance(sm, kMDDumpPulsesBit);
+            break;
+        case kMDDumpPulsesBit:
+            sm.osr >>= 1;
+            Advance(sm, kMDReadDemodBit);
+            break;
+        case kMDReadDemodBit:
+            sm.y = sm.osr & 0b1;
+            sm.osr >>= 1;
+            Advance(sm, kMDDumpRemainingBits);
+            break;
+        case kMDDumpRemainingBits:
+            sm.osr = 0;
+            Advance(sm, kMDBailIfDemodLo);
+            break;
+        case kMDBailIfDemodLo:
+            Advance(sm, sm.y ? kMDWaitForSlope : kMDCompleteDemod);
+            break;
+        case kMDWaitForSlope:
+            Advance(sm, kMDCheckNextBit, 1);
+            break;
+        case kMDCheckNextBit:
+            Advance(sm, pulses_pin_ ? kMDStartOf1 : kMDStartOf0);
+            break;
+    }
+}
+
+void SoftwareDemodulator::PushDemodWord(uint32_t word) {
+    demod_ring_buffer_[demod_ring_num_words_written_ & (kDemodRingBufferNumWords - 1)] = word;
+    demod_ring_num_words_written_++;
+    message_demodulator_.isr = 0;
+    message_demodulator_.isr_shift_count = 0;
+}
+
+void SoftwareDemodulator::ShiftInDemodBit(uint32_t bit) {
+    PIOStateMachine &sm = message_demodulator_;
+    sm.isr = (sm.isr << 1) | (bit & 0b1);
+    sm.isr_shift_count++;
+    if (sm.isr_shift_count >= kBitsPerWord) {
+        PushDemodWord(sm.isr);  // Autopush.
+    }
+}
+
+void SoftwareDemodulator::OnDemodComplete() {
+    uint16_t finished_preamble_detector_indices[kNumPreambleDetectors];
+    uint16_t num_messages = 0;
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        uint16_t index = (next_preamble_detector_index_ + i) % kNumPreambleDetectors;
+        if (!(irq_flags_ & (1 << rel_irq(0, kPreambleDetectorSMs[index])))) {
+            break;
+        }
+        finished_preamble_detector_indices[num_messages++] = index;
+    }
+
+    DemodFrame frames[kNumPreambleDetectors];
+    uint16_t num_frames =
+        demod_find_frames(demod_ring_buffer_, kDemodRingBufferNumWords, demod_ring_last_message_end_word_count_,
+                          demod_ring_num_words_written_, num_messages, frames);
+    num_framing_errors_ += num_messages - num_frames;
+
+    for (uint16_t i = 0; i < num_messages; i++) {
+        // MLAT counter counts at the PIO clock here instead of clk_sys.
+        uint64_t mlat_12mhz_counts = 0;
+        if (!mlat_latches_.empty()) {
+            mlat_12mhz_counts = mlat_latches_.front() * 12 / static_cast<uint64_t>(kPIOClockHz / 1e6);
+            mlat_latches_.pop_front();
+        }
+        if (i >= num_frames) {
+            continue;
+        }
+        num_frames_++;
+        RawTransponderPacket raw_packet;
+        if (demod_frame_to_raw_packet(demod_ring_buffer_, kDemodRingBufferNumWords, frames[i], raw_packet)) {
+            raw_packet.rssi_dbm = rssi_adc_counts_to_dbm(rssi_peak_adc_counts_, kRxGain);
+            raw_packet.mlat_12mhz_counts = mlat_12mhz_counts & RawTransponderPacket::kMLAT12MHzCountsMask;
+            packets.push_back(raw_packet);
+        }
+    }
+
+    rssi_peak_adc_counts_ = 0;
+    for (uint16_t i = 0; i < num_messages; i++) {
+        irq_flags_ &= ~(1 << rel_irq(0, kPreambleDetectorSMs[finished_preamble_detector_indices[i]]));
+    }
+    next_preamble_detector_index_ = (next_preamble_detector_index_ + num_messages) % kNumPreambleDetectors;
+}
+
+bool LoadRigolCSV(const char *path, std::vector<float> &samples_mv, float &sample_rate_hz) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    const uint16_t kLineMaxLen = 100;
+    char line[kLineMaxLen];
+    samples_mv.clear();
+    while (fgets(line, kLineMaxLen, file)) {
+        if (strncmp(line, "Sample Rate:", strlen("Sample Rate:")) == 0) {
+            sample_rate_hz = strtof(line + strlen("Sample Rate:"), nullptr);
+        } else if (line[0] == ',') {
+            // Sample lines have an empty x column, followed by the voltage.
+            samples_mv.push_back(strtof(line + 1, nullptr) * 1000.0f);
+        }
+    }
+    fclose(file);
+    return samples_mv.size() > 0;
+}
@@ -0,0 +1,156 @@
+#ifndef SOFTWARE_DEMODULATOR_HH_
+#define SOFTWARE_DEMODULATOR_HH_
+
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "adsb_packet.hh"
+
+/**
+ * Host model of the receiver's demodulation chain, for replaying sampled captures without hardware. Runs the
+ * preamble_detector (as a ping-pong pair) and message_demodulator programs from capture.pio one instruction at a time
+ * at the PIO clock rate, latches MLAT timestamps like the mlat_counter program, and stands in for the DEMOD ISR in
+ * ads_bee.cc. Each PIO instruction is one case of a switch, named after its label or comment in capture.pio, so changes
+ * to the PIO programs must be mirrored here.
+ */
+class SoftwareDemodulator {
+   public:
+    static constexpr float kPIOClockHz = 16e6;  // Preamble detector and message demodulator both run at 16MHz.
+    static constexpr uint16_t kNumPreambleDetectors = 2;
+    static constexpr uint16_t kDemodRingBufferNumWords = 1024;  // Same size as ADSBee's demod ring buffer.
+
+    struct SoftwareDemodulatorConfig {
+        float sample_rate_hz = kPIOClockHz;  // Rate of the sample streams. Resampled to the PIO clock.
+        float clk_sys_hz = 125e6;            // System clock that the PIO clock is divided down from.
+        // Time from a preamble detector raising its DEMOD IRQ flag until the DEMOD ISR runs, in microseconds.
+        float demod_isr_latency_us = 0;
+    };
+
+    /**
+     * Default constructor. Uses default config values.
+     */
+    SoftwareDemodulator() { Reset(); }
+
+    /**
+     * Constructor with config values specified.
+     */
+    SoftwareDemodulator(SoftwareDemodulatorConfig config_in) : config_(config_in) { Reset(); }
+
+    /**
+     * Puts the state machines back in their power on state and clears the output and statistics.
+     */
+    void Reset();
+
+    /**
+     * Runs the demodulation chain over a block of samples. Can be called repeatedly with consecutive blocks of one
+     * stream.
+     * @param[in] pulses Comparator output samples, true when the signal is above the trigger level.
+     * @param[in] rssi_adc_counts RSSI ADC samples taken at the same times as the comparator samples.
+     * @param[in] num_samples Number of samples in each of the streams.
+     */
+    void Ingest(const bool pulses[], const uint16_t rssi_adc_counts[], uint32_t num_samples);
+
+    /**
+     * Runs the demodulation chain over a block of samples of the RSSI voltage, like a capture from a scope. The
+     * comparator and ADC streams are made from the voltage the same way the receiver's hardware would.
+     * @param[in] samples_mv RSSI samples, in milliVolts.
+     * @param[in] num_samples Number of samples.
+     * @param[in] tl_mv Trigger level for the comparator, in milliVolts.
+     */
+    void IngestMilliVolts(const float samples_mv[], uint32_t num_samples, int tl_mv);
+
+    /**
+     * Returns the number of frames found in the demodulator output, including ones too short to be packets.
+     */
+    uint32_t GetNumFrames() { return num_frames_; }
+
+    /**
+     * Returns the number of frames dropped because their end-of-frame word didn't line up with the demodulator output.
+     */
+    uint32_t GetNumFramingErrors() { return num_framing_errors_; }
+
+    /**
+     * Returns the number of PIO clock cycles that have been run.
+     */
+    uint64_t GetNumPIOCycles() { return num_pio_cycles_; }
+
+    // Packets assembled from the demodulator output, in the order they were received. Left for the caller to clear.
+    std::vector<RawTransponderPacket> packets;
+
+   private:
+    // Mirrors the subset of a PIO state machine's registers that capture.pio uses.
+    struct PIOStateMachine {
+        uint16_t pc = 0;
+        uint16_t delay = 0;  // Delay cycles left before the next instruction.
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t isr = 0;
+        uint16_t isr_shift_count = 0;
+        uint32_t osr = 0;
+    };
+
+    /**
+     * Runs the state machines for one PIO clock cycle.
+     * @param[in] pulses Comparator output during this cycle.
+     * @param[in] rssi_adc_counts RSSI ADC reading during this cycle.
+     */
+    void Step(bool pulses, uint16_t rssi_adc_counts);
+    void StepPreambleDetector(uint16_t index);
+    void StepMessageDemodulator();
+
+    /**
+     * Moves a state machine to an instruction.
+     * @param[in] sm State machine to move.
+     * @param[in] pc Instruction to run next.
+     * @param[in] delay Delay cycles to wait before running it.
+     */
+    void Advance(PIOStateMachine &sm, uint16_t pc, uint16_t delay = 0) {
+        sm.pc = pc;
+        sm.delay = delay;
+    }
+    void PushDemodWord(uint32_t word);
+    void ShiftInDemodBit(uint32_t bit);
+
+    /**
+     * Equivalent of ADSBee::OnDemodComplete followed by ADSBee::AssembleDemodMessage, run demod_isr_latency_us after a
+     * preamble detector raises its DEMOD IRQ flag. Finds and assembles frames with the same functions as ADSBee.
+     */
+    void OnDemodComplete();
+
+    SoftwareDemodulatorConfig config_;
+
+    PIOStateMachine preamble_detectors_[kNumPreambleDetectors];
+    PIOStateMachine message_demodulator_;
+    uint8_t irq_flags_ = 0;  // PIO IRQ flags 0-7.
+    bool pulses_pin_ = false;
+    bool demod_pin_ = false;       // Driven by the preamble detectors.
+    bool next_demod_pin_ = false;  // Value of the DEMOD pin once all state machines have run this cycle.
+    uint16_t next_preamble_detector_index_ = 0;
+
+    uint32_t demod_ring_buffer_[kDemodRingBufferNumWords];
+    uint32_t demod_ring_num_words_written_ = 0;
+    uint32_t demod_ring_last_message_end_word_count_ = 0;
+
+    std::deque<uint64_t> mlat_latches_;  // PIO cycle counts latched at DEMOD rising edges.
+    bool demod_isr_pending_ = false;
+    uint64_t demod_isr_pio_cycle_ = 0;   // PIO cycle count at which the pending DEMOD ISR runs.
+    uint16_t rssi_peak_adc_counts_ = 0;  // Stands in for the RSSI peak detector.
+
+    uint64_t num_pio_cycles_ = 0;
+    uint64_t num_samples_ingested_ = 0;
+    uint32_t num_frames_ = 0;
+    uint32_t num_framing_errors_ = 0;
+};
+
+/**
+ * Loads the waveform from a CSV file saved by a Rigol arbitrary waveform generator, like the ones in captures/.
+ * @param[in] path Path to the CSV file.
+ * @param[out] samples_mv Filled with the samples, in milliVolts.
+ * @param[out] sample_rate_hz Filled with the sample rate from the file header.
+ * @retval True if the file was loaded, false if it couldn't be opened or had no samples.
+ */
+bool LoadRigolCSV(const char *path, std::vector<float> &samples_mv, float &sample_rate_hz);
+
+#endif /* SOFTWARE_DEMODULATOR_HH_ */
@@ -38,6 +38,23 @@ TEST(TransponderPacket, get_n_bit_word_from_buffer) {
     EXPECT_EQ(get_n_bit_word_from_buffer(16, 32 * 3 + 16, packet_buffer), 0x504Du);
 }
 
+TEST(TransponderPacket, get_n_bit_word_from_buffer_template) {
+    static constexpr uint32_t kPacketBuffer[TransponderPacket::kMaxPacketLenWords32] = {0x8D76CE88u, 0x204C9072u,
+                                                                                          0xCB48209Au, 0x504D0000u};
+    static_assert(get_n_bit_word_from_buffer<0, 5>(kPacketBuffer) == 17);            // DF
+    static_assert(get_n_bit_word_from_buffer<8, 24>(kPacketBuffer) == 0x76CE88u);    // ICAO
+    static_assert(get_n_bit_word_from_buffer<4, 32>(kPacketBuffer) == 0xD76CE882u);  // Straddles words 0 and 1.
+    static_assert(get_n_bit_word_from_buffer<96, 16>(kPacketBuffer) == 0x504Du);
+
+    // Spot check against the runtime version at a spread of offsets, including ones that straddle words.
+    EXPECT_EQ((get_n_bit_word_from_buffer<0, 32>(kPacketBuffer)), get_n_bit_word_from_buffer(32, 0, kPacketBuffer));
+    EXPECT_EQ((get_n_bit_word_from_buffer<31, 2>(kPacketBuffer)), get_n_bit_word_from_buffer(2, 31, kPacketBuffer));
+    EXPECT_EQ((get_n_bit_word_from_buffer<54, 17>(kPacketBuffer)), get_n_bit_word_from_buffer(17, 54, kPacketBuffer));
+    EXPECT_EQ((get_n_bit_word_from_buffer<71, 17>(kPacketBuffer)), get_n_bit_word_from_buffer(17, 71, kPacketBuffer));
+    EXPECT_EQ((get_n_bit_word_from_buffer<63, 1>(kPacketBuffer)), get_n_bit_word_from_buffer(1, 63, kPacketBuffer));
+    EXPECT_EQ((get_n_bit_word_from_buffer<80, 24>(kPacketBuffer)), get_n_bit_word_from_buffer(24, 80, kPacketBuffer));
+}
+
 TEST(TransponderPacket, set_n_bit_word_in_buffer) {
     uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
     packet_buffer[0] = 0x8D76CE88u;
@@ -204,6 +221,41 @@ TEST(ADSBPacket, ConstructFromTransponderPacket) {
     EXPECT_EQ(packet.GetTypeCode(), 4);
 }
 
+TEST(ADSBPacket, ViewOfRawPacketBuffer) {
+    static constexpr uint32_t kPacketBuffer[TransponderPacket::kMaxPacketLenWords32] = {0x8D76CE88u, 0x204C9072u,
+                                                                                          0xCB48209Au, 0x504D0000u};
+    constexpr ADSBPacket packet = ADSBPacket(kPacketBuffer, true);
+    static_assert(packet.GetDownlinkFormat() == TransponderPacket::kDownlinkFormatExtendedSquitter);
+    static_assert(packet.GetCapability() == 5);
+    static_assert(packet.GetICAOAddress() == 0x76CE88);
+    static_assert(packet.GetTypeCode() == 4);
+    static_assert(packet.GetTypeCodeEnum() == ADSBPacket::kTypeCodeAircraftID);
+    EXPECT_TRUE(packet.IsValid());
+
+    // ME field accessor should match the generic bit extractor for every width and offset.
+    for (uint16_t n = 1; n <= 32; n++) {
+        for (uint16_t first_bit_index = 0; first_bit_index + n <= ADSBPacket::kMENumBits; first_bit_index++) {
+            ASSERT_EQ(packet.GetNBitWordFromMessage(n, first_bit_index),
+                      get_n_bit_word_from_buffer(n, ADSBPacket::kMEFirstBitIndex + first_bit_index, kPacketBuffer));
+        }
+    }
+}
+
+TEST(ADSBPacket, ViewOfTransponderPacket) {
+    TransponderPacket tpacket = TransponderPacket((char *)"8D76CE88204C9072CB48209A504D");
+    ADSBPacket packet = ADSBPacket(tpacket);
+    EXPECT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+    EXPECT_LE(sizeof(packet), 2 * sizeof(void *));  // Pointer plus validity flag, no copy of the packet.
+
+    // View follows its parent packet.
+    tpacket = TransponderPacket((char *)"8D7C80AD2358F6B1E35C60FF1925");
+    EXPECT_EQ(packet.GetICAOAddress(), 0x7C80ADu);
+
+    // Short packets aren't valid ADS-B packets, even if they were confirmed some other way.
+    tpacket = TransponderPacket((char *)"00050319AB8C22");
+    EXPECT_FALSE(ADSBPacket(tpacket).IsValid());
+}
+
 TEST(TransponderPacket, ConstructValidShortFrame) {
     TransponderPacket packet = TransponderPacket((char *)"00050319AB8C22");
     EXPECT_FALSE(packet.IsValid());  // Automatically marked as invalid since not confirmable with CRC.
@@ -236,4 +288,128 @@ TEST(TransponderPacket, DumpPacketBufferBytes) {
         EXPECT_EQ((packet_buffer_words[i] >> 8) & 0xFF, check_buffer_bytes[i * kBytesPerWord + 2]);
         EXPECT_EQ(packet_buffer_words[i] & 0xFF, check_buffer_bytes[i * kBytesPerWord + 3]);
     }
-}
\ No newline at end of file
+}
+
+TEST(TransponderPacket, RawPacketRoundTrip) {
+    TransponderPacket packet = TransponderPacket((char *)"8D76CE88204C9072CB48209A504D", -75, 0xABCDEF0123456789);
+    RawTransponderPacket raw_packet = packet.GetRaw();
+    EXPECT_EQ(raw_packet.buffer[0], 0x8D76CE88u);
+    EXPECT_EQ(raw_packet.buffer[3], 0x504D0000u);
+    EXPECT_EQ(raw_packet.buffer_len_bits, 112u);
+    EXPECT_EQ(raw_packet.rssi_dbm, -75);
+    EXPECT_EQ(raw_packet.mlat_12mhz_counts, 0xEF0123456789u);  // Truncated to 48 bits.
+
+    TransponderPacket decoded_packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(decoded_packet.IsValid());
+    EXPECT_EQ(decoded_packet.GetICAOAddress(), 0x76CE88u);
+    EXPECT_EQ(decoded_packet.GetRSSIdBm(), -75);
+    EXPECT_EQ(decoded_packet.GetNumCorrectedBits(), 0);
+
+    // Packets fixed by error correction stay marked as corrected.
+    TransponderPacket corrected_packet = TransponderPacket((char *)"8D76CE8820CC9072CB48209A504D");
+    ASSERT_EQ(corrected_packet.GetNumCorrectedBits(), 1);
+    raw_packet = corrected_packet.GetRaw();
+    EXPECT_EQ(raw_packet.buffer[1], 0x204C9072u);
+    decoded_packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(decoded_packet.IsValid());
+    EXPECT_EQ(decoded_packet.GetNumCorrectedBits(), 1);
+
+    // Short frames keep unused bits zeroed.
+    raw_packet = TransponderPacket((char *)"00050319AB8C22").GetRaw();
+    EXPECT_EQ(raw_packet.buffer_len_bits, 56u);
+    EXPECT_EQ(raw_packet.buffer[1], 0xAB8C2200u);
+    EXPECT_EQ(raw_packet.buffer[2], 0u);
+    EXPECT_EQ(raw_packet.buffer[3], 0u);
+}
+
+TEST(TransponderPacket, DebugString) {
+    char debug_string[TransponderPacket::kDebugStrLen];
+    TransponderPacket packet = TransponderPacket((char *)"8D76CE88204C9072CB48209A504D");
+    EXPECT_EQ(packet.GetDebugString(debug_string), 0);
+    EXPECT_STREQ(debug_string, "");
+
+    // Corrupt the parity bits beyond repair.
+    packet = TransponderPacket((char *)"8D76CE88204C9072CB48209AAFB2");
+    ASSERT_FALSE(packet.IsValid());
+    EXPECT_GT(packet.GetDebugString(debug_string), 0);
+    EXPECT_STREQ(debug_string, "Invalid checksum, expected 9aafb2 but calculated 9a504d.\r\n");
+
+    packet = TransponderPacket((char *)"8D76CE88");
+    EXPECT_GT(packet.GetDebugString(debug_string), 0);
+    EXPECT_STREQ(debug_string, "Bit number mismatch while decoding packet. Expected 112 or 56 but got 32!\r\n");
+}
+
+TEST(TransponderPacket, CorrectSingleBitErrors) {
+    const uint32_t valid_packet_buffer[TransponderPacket::kMaxPacketLenWords32] = {0x8D76CE88u, 0x204C9072u,
+                                                                                   0xCB48209Au, 0x504D0000u};
+    // Flip each bit after the downlink format field, including the parity bits.
+    for (uint16_t bit_index = TransponderPacket::kDFNUmBits; bit_index < 112; bit_index++) {
+        uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
+        for (uint16_t i = 0; i < TransponderPacket::kMaxPacketLenWords32; i++) {
+            packet_buffer[i] = valid_packet_buffer[i];
+        }
+        packet_buffer[bit_index / 32] ^= 0x80000000u >> (bit_index % 32);
+
+        TransponderPacket packet = TransponderPacket(packet_buffer, 4);
+        ASSERT_TRUE(packet.IsValid());
+        EXPECT_EQ(packet.GetNumCorrectedBits(), 1);
+        EXPECT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+        uint32_t check_buffer[TransponderPacket::kMaxPacketLenWords32];
+        packet.DumpPacketBuffer(check_buffer);
+        for (uint16_t i = 0; i < TransponderPacket::kMaxPacketLenWords32; i++) {
+            EXPECT_EQ(check_buffer[i], valid_packet_buffer[i]);
+        }
+    }
+
+    // Clean packets don't get flagged as corrected.
+    TransponderPacket packet = TransponderPacket((char *)"8D76CE88204C9072CB48209A504D");
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+
+    // Errors in the downlink format field aren't corrected (DF17 -> DF19).
+    packet = TransponderPacket((char *)"9D76CE88204C9072CB48209A504D");
+    EXPECT_FALSE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+}
+
+TEST(TransponderPacket, CorrectTwoBitErrors) {
+    // 0x504D -> 0x504E flips two parity bits.
+    TransponderPacket packet = TransponderPacket((char *)"8D76CE88204C9072CB48209A504E");
+    EXPECT_FALSE(packet.IsValid());  // Only single bit errors are corrected by default.
+
+    TransponderPacket::max_num_corrected_bits = 2;
+    packet = TransponderPacket((char *)"8D76CE88204C9072CB48209A504E");
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 2);
+    // Two flipped bits in the downlink format field turn DF17 into DF18, but still can't be corrected.
+    packet = TransponderPacket((char *)"9576CE88204C9072CB48209A504D");
+    EXPECT_FALSE(packet.IsValid());
+    // Two flipped bits spread out across the message (CA field and ME field).
+    packet = TransponderPacket((char *)"8C76CE88204C9073CB48209A504D");
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 2);
+    EXPECT_EQ(ADSBPacket(packet).GetCapability(), 5u);
+    TransponderPacket::max_num_corrected_bits = 1;
+
+    // Extended squitters that aren't DF17/18 are never corrected.
+    packet = TransponderPacket((char *)"A076CE88204C9072CB48209A504D");
+    EXPECT_FALSE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+}
+
+TEST(TransponderPacket, ConstructAllCallReply) {
+    // DF11 with interrogator ID 0 (acquisition squitter).
+    TransponderPacket packet = TransponderPacket((char *)"5DDBBB5F18B46B");
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetDownlinkFormat(), static_cast<uint16_t>(TransponderPacket::kDownlinkFormatAllCallReply));
+    EXPECT_EQ(packet.GetICAOAddress(), 0xDBBB5Fu);
+
+    // Interrogator ID 0x12 overlaid on the parity field.
+    packet = TransponderPacket((char *)"5DDBBB5F18B479");
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetICAOAddress(), 0xDBBB5Fu);
+
+    // Bit error outside of the interrogator ID field.
+    packet = TransponderPacket((char *)"5DDBBB5F19B46B");
+    EXPECT_FALSE(packet.IsValid());
+}
@@ -1,5 +1,6 @@
 #include "adsb_packet.hh"
 #include "aircraft_dictionary.hh"
+#include "benchmark.hh"
 #include "decode_utils.hh"  // for location calculation utility functions
 #include "gtest/gtest.h"
 #include "hal_god_powers.hh"  // for changing timestamp
@@ -49,15 +50,26 @@ TEST(AircraftDictionary, InsertThenRemoveTooMany) {
     EXPECT_TRUE(dictionary.InsertAircraft(test_aircraft));
     EXPECT_TRUE(dictionary.GetAircraftPtr(test_aircraft.icao_address));
 
-    // Adding a new aircraft should fail.
+    // Adding a new aircraft should evict the least recently seen one.
+    EXPECT_EQ(dictionary.GetNumEvictions(), 0u);
     test_aircraft.icao_address = 0xBEEB;
-    EXPECT_FALSE(dictionary.InsertAircraft(test_aircraft));
-    EXPECT_FALSE(dictionary.GetAircraftPtr(test_aircraft.icao_address));
+    EXPECT_TRUE(dictionary.InsertAircraft(test_aircraft));
+    EXPECT_TRUE(dictionary.ContainsAircraft(0xBEEB));
+    EXPECT_FALSE(dictionary.ContainsAircraft(0));
+    EXPECT_EQ(dictionary.GetNumAircraft(), AircraftDictionary::kMaxNumAircraft);
+    EXPECT_EQ(dictionary.GetNumEvictions(), 1u);
+
+    // Aircraft 3 was seen more recently than aircraft 1, so aircraft 1 goes next.
+    EXPECT_TRUE(dictionary.GetAircraftPtr(0xBEEC));
+    EXPECT_FALSE(dictionary.ContainsAircraft(1 * 599));
+    EXPECT_TRUE(dictionary.ContainsAircraft(3 * 599));
+    EXPECT_EQ(dictionary.GetNumEvictions(), 2u);
 
     // Remove all aircraft.
-    for (uint16_t i = 0; i < AircraftDictionary::kMaxNumAircraft; i++) {
-        test_aircraft.icao_address = (AircraftDictionary::kMaxNumAircraft - 1 - i) * 599;
-        EXPECT_TRUE(dictionary.RemoveAircraft(test_aircraft.icao_address));
+    EXPECT_TRUE(dictionary.RemoveAircraft(0xBEEB));
+    EXPECT_TRUE(dictionary.RemoveAircraft(0xBEEC));
+    for (uint16_t i = 2; i < AircraftDictionary::kMaxNumAircraft; i++) {
+        EXPECT_TRUE(dictionary.RemoveAircraft(i * 599));
         EXPECT_EQ(dictionary.GetNumAircraft(), AircraftDictionary::kMaxNumAircraft - i - 1);
     }
 
@@ -66,6 +78,127 @@ TEST(AircraftDictionary, InsertThenRemoveTooMany) {
     EXPECT_FALSE(dictionary.RemoveAircraft(0));
 }
 
+TEST(AircraftDictionary, PruneStaleAircraft) {
+    AircraftDictionary dictionary = AircraftDictionary({.aircraft_prune_interval_ms = 10000});
+    // DF17 aircraft ID messages from three different aircraft.
+    TransponderPacket packets[] = {TransponderPacket((char *)"8D76CE88204C9072CB48209A504D"),
+                                   TransponderPacket((char *)"8D7C7181215D01A08208204D8BF1"),
+                                   TransponderPacket((char *)"8D7C7745226151A08208205CE9C2")};
+    for (uint16_t i = 0; i < 3; i++) {
+        set_time_since_boot_ms(1000 * (i + 1));
+        ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(packets[i])));
+    }
+    EXPECT_EQ(dictionary.GetNumAircraft(), 3);
+
+    // Hearing from the first aircraft again keeps it around after the second one goes stale.
+    set_time_since_boot_ms(5000);
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(packets[0])));
+    dictionary.Update(12001);
+    EXPECT_EQ(dictionary.GetNumAircraft(), 2);
+    EXPECT_FALSE(dictionary.ContainsAircraft(packets[1].GetICAOAddress()));
+
+    dictionary.Update(13001);
+    EXPECT_EQ(dictionary.GetNumAircraft(), 1);
+    EXPECT_TRUE(dictionary.ContainsAircraft(packets[0].GetICAOAddress()));
+
+    dictionary.Update(15001);
+    EXPECT_EQ(dictionary.GetNumAircraft(), 0);
+}
+
+TEST(AircraftDictionary, ChangeCursors) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    set_time_since_boot_ms(1000);
+    TransponderPacket id_message = TransponderPacket((char *)"8D76CE88204C9072CB48209A504D");
+    TransponderPacket velocity_message = TransponderPacket((char *)"8dae56bc99246508b8080b6c230f");
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(id_message)));
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(velocity_message)));
+
+    // New aircraft are reported in full to every consumer.
+    AircraftDictionary::ChangeCursor cursor_a = {.consumer_id = 0};
+    AircraftDictionary::ChangeCursor cursor_b = {.consumer_id = 1};
+    Aircraft aircraft;
+    uint8_t changed_fields;
+    uint16_t num_changed_aircraft = 0;
+    while (dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields)) {
+        EXPECT_EQ(changed_fields, Aircraft::kChangedFieldsAll);
+        num_changed_aircraft++;
+    }
+    EXPECT_EQ(num_changed_aircraft, 2);
+    EXPECT_FALSE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+
+    // Only the fields that a message touches are reported as changed.
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(velocity_message)));
+    ASSERT_TRUE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+    EXPECT_EQ(aircraft.icao_address, velocity_message.GetICAOAddress());
+    EXPECT_EQ(changed_fields, Aircraft::kChangedFieldsVelocity);
+    EXPECT_FALSE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+
+    // Each consumer tracks changes on its own.
+    num_changed_aircraft = 0;
+    while (dictionary.GetNextChangedAircraft(cursor_b, aircraft, changed_fields)) {
+        num_changed_aircraft++;
+    }
+    EXPECT_EQ(num_changed_aircraft, 2);
+
+    // Removing aircraft partway through a pass doesn't throw off the cursor.
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(id_message)));
+    ASSERT_TRUE(dictionary.IngestADSBPacket(ADSBPacket(velocity_message)));
+    ASSERT_TRUE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+    uint32_t first_icao_address = aircraft.icao_address;
+    EXPECT_TRUE(dictionary.RemoveAircraft(first_icao_address));
+    ASSERT_TRUE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+    EXPECT_NE(aircraft.icao_address, first_icao_address);
+    EXPECT_FALSE(dictionary.GetNextChangedAircraft(cursor_a, aircraft, changed_fields));
+}
+
+TEST(AircraftDictionary, FindAircraftInRange) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    // Aircraft around San Francisco, plus one near Seattle and one without a position.
+    struct {
+        uint32_t icao_address;
+        float latitude_deg;
+        float longitude_deg;
+        uint32_t baro_altitude_ft;
+        bool position_valid;
+    } test_aircraft[] = {{0x1, 37.62f, -122.38f, 3000, true},  {0x2, 37.80f, -122.40f, 12000, true},
+                         {0x3, 38.50f, -121.50f, 30000, true}, {0x4, 47.45f, -122.31f, 5000, true},
+                         {0x5, 37.62f, -122.38f, 3000, false}};
+    for (auto &itr : test_aircraft) {
+        Aircraft aircraft = Aircraft(itr.icao_address);
+        aircraft.latitude_deg = itr.latitude_deg;
+        aircraft.longitude_deg = itr.longitude_deg;
+        aircraft.baro_altitude_ft = itr.baro_altitude_ft;
+        aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeSourceBaro;
+        aircraft.position_valid = itr.position_valid;
+        ASSERT_TRUE(dictionary.InsertAircraft(aircraft));
+    }
+
+    uint32_t icao_addresses[AircraftDictionary::kMaxNumAircraft];
+    AircraftDictionary::AircraftRangeQuery query = {.latitude_deg = 37.62f, .longitude_deg = -122.38f, .radius_km = 50};
+    uint16_t num_aircraft = dictionary.FindAircraftInRange(query, icao_addresses, AircraftDictionary::kMaxNumAircraft);
+    std::sort(icao_addresses, icao_addresses + num_aircraft);
+    ASSERT_EQ(num_aircraft, 2);
+    EXPECT_EQ(icao_addresses[0], 0x1u);
+    EXPECT_EQ(icao_addresses[1], 0x2u);
+
+    // Sacramento is about 120km away.
+    query.radius_km = 150;
+    EXPECT_EQ(dictionary.FindAircraftInRange(query, icao_addresses, AircraftDictionary::kMaxNumAircraft), 3);
+    EXPECT_EQ(dictionary.FindAircraftInRange(query, icao_addresses, 1), 1);
+
+    // Altitude band.
+    query.min_altitude_ft = 10000;
+    query.max_altitude_ft = 20000;
+    ASSERT_EQ(dictionary.FindAircraftInRange(query, icao_addresses, AircraftDictionary::kMaxNumAircraft), 1);
+    EXPECT_EQ(icao_addresses[0], 0x2u);
+
+    // Removed aircraft leave the index.
+    query = {.latitude_deg = 47.45f, .longitude_deg = -122.31f, .radius_km = 10};
+    EXPECT_EQ(dictionary.FindAircraftInRange(query, icao_addresses, AircraftDictionary::kMaxNumAircraft), 1);
+    EXPECT_TRUE(dictionary.RemoveAircraft(0x4));
+    EXPECT_EQ(dictionary.FindAircraftInRange(query, icao_addresses, AircraftDictionary::kMaxNumAircraft), 0);
+}
+
 TEST(AircraftDictionary, UseAircraftPtr) {
     AircraftDictionary dictionary = AircraftDictionary();
     Aircraft *aircraft = dictionary.GetAircraftPtr(12345);
@@ -256,8 +389,7 @@ TEST(AircraftDictionary, IngestAirbornePositionMessage) {
     // Ingest even packet.
     ASSERT_TRUE(dictionary.IngestADSBPacket(even_packet));
     ASSERT_EQ(dictionary.GetNumAircraft(), 1);
-    auto itr = dictionary.dict.begin();
-    auto &aircraft = itr->second;
+    Aircraft &aircraft = *dictionary.dict.begin();
 
     // Aircraft should exist but not have its location filled out.
     ASSERT_EQ(aircraft.icao_address, (uint32_t)0xA6147F);
@@ -283,6 +415,12 @@ TEST(AircraftDictionary, IngestAirbornePositionMessage) {
     // Altitude should be filled out.
     EXPECT_EQ(aircraft.altitude_source, Aircraft::AltitudeSource::kAltitudeSourceBaro);
     EXPECT_EQ(aircraft.baro_altitude_ft, 17000);
+
+    // Decoded position should be indexed.
+    uint32_t icao_address;
+    AircraftDictionary::AircraftRangeQuery query = {.latitude_deg = 20.3f, .longitude_deg = -156.5f, .radius_km = 10};
+    ASSERT_EQ(dictionary.FindAircraftInRange(query, &icao_address, 1), 1);
+    EXPECT_EQ(icao_address, 0xA6147Fu);
 }
 
 TEST(AircraftDictionary, IngestAirborneVelocityMessage) {
@@ -295,8 +433,7 @@ TEST(AircraftDictionary, IngestAirborneVelocityMessage) {
     // Ingest the airborne velocities packet.
     ASSERT_TRUE(dictionary.IngestADSBPacket(packet));
     ASSERT_EQ(dictionary.GetNumAircraft(), 1);
-    auto itr = dictionary.dict.begin();
-    auto &aircraft = itr->second;  // NOTE: Aircraft is a mutable reference until we get to Message A!
+    Aircraft &aircraft = *dictionary.dict.begin();  // NOTE: Aircraft is a mutable reference until we get to Message A!
 
     // Aircraft should now have velocities populated.
     EXPECT_NEAR(aircraft.heading_deg, 304.2157021324374, kFloatCloseEnough);
@@ -346,4 +483,180 @@ TEST(AircraftDictionary, IngestAirborneVelocityMessage) {
     EXPECT_EQ(aircraft.velocity_source, Aircraft::VelocitySource::kVelocitySourceAirspeedTrue);
     EXPECT_NEAR(aircraft.heading_deg, 243.98f, 0.01);
     EXPECT_NEAR(aircraft.velocity_kts, 375.0f, 0.01);
-}
\ No newline at end of file
+}
+
+/**
+ * Reads every field used by the identification, airborne position, and airborne velocity decoders through the runtime
+ * bit extractor, the way the decoders did before the compile-time field table was added.
+ */
+uint32_t read_me_fields_runtime(const uint32_t packet_buffer[]) {
+    const uint16_t me = ADSBPacket::kMEFirstBitIndex;
+    const uint16_t kFields[][2] = {{3, 5},  {6, 8},  {6, 14}, {6, 20}, {6, 26}, {6, 32}, {6, 38}, {6, 44},
+                                   {6, 50}, {2, 5},  {1, 7},  {12, 8}, {1, 21}, {17, 22}, {17, 39}, {1, 13},
+                                   {10, 14}, {1, 24}, {10, 25}, {1, 35}, {1, 36}, {9, 37}, {1, 48}, {7, 49}};
+    uint32_t sum = 0;
+    for (const auto &field : kFields) {
+        sum += get_n_bit_word_from_buffer(field[0], me + field[1], packet_buffer);
+    }
+    return sum;
+}
+
+/**
+ * Reads the same fields as read_me_fields_runtime, using the compile-time field table.
+ */
+uint32_t read_me_fields_compile_time(ADSBPacket packet) {
+    using ID = ADSBPacket::AircraftIDFields;
+    using Pos = ADSBPacket::AirbornePositionFields;
+    using Vel = ADSBPacket::AirborneVelocitiesFields;
+    uint64_t callsign = (static_cast<uint64_t>(packet.GetMEField<ID::CallsignFirstHalf>()) << 24) |
+                        packet.GetMEField<ID::CallsignSecondHalf>();
+    uint32_t sum = packet.GetMEField<ID::Category>();
+    for (int16_t i = 7; i >= 0; i--) {
+        sum += (callsign >> (6 * i)) & 0b111111;
+    }
+    sum += packet.GetMEField<Pos::SurveillanceStatus>() + packet.GetMEField<Pos::SingleAntennaFlag>() +
+           packet.GetMEField<Pos::EncodedAltitude>() + packet.GetMEField<Pos::CPRFormat>() +
+           packet.GetMEField<Pos::CPRLat>() + packet.GetMEField<Pos::CPRLon>();
+    sum += packet.GetMEField<Vel::DirectionEW>() + packet.GetMEField<Vel::VelocityEW>() +
+           packet.GetMEField<Vel::DirectionNS>() + packet.GetMEField<Vel::VelocityNS>() +
+           packet.GetMEField<Vel::VerticalRateSource>() + packet.GetMEField<Vel::VerticalRateSign>() +
+           packet.GetMEField<Vel::VerticalRate>() + packet.GetMEField<Vel::GNSSBaroAltDifferenceSign>() +
+           packet.GetMEField<Vel::GNSSBaroAltDifference>();
+    return sum;
+}
+
+TEST(AircraftDictionary, DISABLED_DecodeBenchmark) {
+    const uint16_t kNumPasses = 10000;
+    TransponderPacket tpackets[] = {TransponderPacket((char *)"8D76CE88204C9072CB48209A504D"),   // Identification
+                                    TransponderPacket((char *)"8da6147f5859f18cdf4d244ac6fa"),   // Airborne position
+                                    TransponderPacket((char *)"8D485020994409940838175B284F")};  // Airborne velocity
+    const uint16_t kNumPackets = sizeof(tpackets) / sizeof(tpackets[0]);
+    for (uint16_t i = 0; i < kNumPackets; i++) {
+        ASSERT_TRUE(tpackets[i].IsValid());
+        ASSERT_EQ(read_me_fields_runtime(tpackets[i].GetPacketBuffer()),
+                  read_me_fields_compile_time(ADSBPacket(tpackets[i])));
+    }
+
+    float runtime_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                benchmark_sink += read_me_fields_runtime(tpackets[i].GetPacketBuffer());
+            }
+        }
+    });
+    float compile_time_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                benchmark_sink += read_me_fields_compile_time(ADSBPacket(tpackets[i]));
+            }
+        }
+    });
+    AircraftDictionary dictionary = AircraftDictionary();
+    float ingest_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                dictionary.IngestADSBPacket(ADSBPacket(tpackets[i]));
+            }
+        }
+    });
+
+    float num_messages = kNumPasses * kNumPackets;
+    printf("ME field reads: runtime extractor %.1f ns/message, compile-time extractor %.1f ns/message.\r\n",
+           runtime_ns / num_messages, compile_time_ns / num_messages);
+    printf("AircraftDictionary::IngestADSBPacket: %.1f ns/message.\r\n", ingest_ns / num_messages);
+}
+
+TEST(AircraftDictionary, IngestAltitudeReply) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    set_time_since_boot_ms(1000);
+
+    // DF4 with ICAO 0xDBBB5F overlaid on the parity field, altitude 38000ft.
+    TransponderPacket altitude_reply = TransponderPacket((char *)"20001838CA3804");
+    EXPECT_EQ(altitude_reply.GetICAOAddress(), 0xDBBB5Fu);
+    // ICAO address hasn't been seen in a CRC-clean packet yet, so the reply can't be trusted.
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(altitude_reply));
+    EXPECT_EQ(dictionary.GetNumAircraft(), 0);
+
+    // DF11 with a corrupted parity field doesn't vouch for anything.
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(TransponderPacket((char *)"5DDBBB5F18B56B")));
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(altitude_reply));
+
+    // Clean DF11 all-call reply from the same aircraft, with interrogator ID 0x12 overlaid on the parity field.
+    TransponderPacket all_call_reply = TransponderPacket((char *)"5DDBBB5F18B479");
+    EXPECT_TRUE(all_call_reply.IsValid());
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(all_call_reply));
+    EXPECT_EQ(dictionary.GetNumAircraft(), 1);
+
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(altitude_reply));
+    Aircraft aircraft;
+    ASSERT_TRUE(dictionary.GetAircraft(0xDBBB5F, aircraft));
+    EXPECT_EQ(aircraft.transponder_capability, 5);
+    EXPECT_EQ(aircraft.baro_altitude_ft, 38000);
+    EXPECT_EQ(aircraft.altitude_source, Aircraft::AltitudeSource::kAltitudeSourceBaro);
+    EXPECT_TRUE(aircraft.is_airborne);  // FS = 0.
+
+    // Trust expires along with the aircraft.
+    inc_time_since_boot_ms(60e3 + 1);  // Default aircraft_prune_interval_ms.
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(altitude_reply));
+}
+
+TEST(AircraftDictionary, OnlyCleanICAOAddressesBuildConfidence) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    set_time_since_boot_ms(1000);
+
+    // DF4 with ICAO 0x76CE88 overlaid on the parity field, altitude 38000ft.
+    TransponderPacket altitude_reply = TransponderPacket((char *)"20001838674DD3");
+    EXPECT_EQ(altitude_reply.GetICAOAddress(), 0x76CE88u);
+
+    // DF17 from the same aircraft with a bit error in the ME field is still ingested once corrected, but doesn't vouch
+    // for the ICAO address.
+    TransponderPacket corrected_extended_squitter = TransponderPacket((char *)"8D76CE8820CC9072CB48209A504D");
+    EXPECT_TRUE(corrected_extended_squitter.IsValid());
+    EXPECT_EQ(corrected_extended_squitter.GetNumCorrectedBits(), 1);
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(corrected_extended_squitter));
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(altitude_reply));
+
+    // Clean DF18 with CF = 1 carries a non-ICAO address, so it doesn't vouch either.
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(TransponderPacket((char *)"9176CE88204C9072CB4820BF2DC0")));
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(altitude_reply));
+
+    // Clean DF18 with CF = 0 does.
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(TransponderPacket((char *)"9076CE88204C9072CB4820E75CB8")));
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(altitude_reply));
+}
+
+TEST(AircraftDictionary, IngestIdentityReply) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    set_time_since_boot_ms(1000);
+
+    // DF5 with ICAO 0x510AF9 overlaid on the parity field, squawk 0356.
+    TransponderPacket identity_reply = TransponderPacket((char *)"2A00516D492B80");
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(identity_reply));
+
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(TransponderPacket((char *)"5D510AF9A8D8BC")));
+    Aircraft aircraft;
+    ASSERT_TRUE(dictionary.GetAircraft(0x510AF9, aircraft));
+    EXPECT_FALSE(aircraft.received_fields & Aircraft::kChangedFieldsSquawk);
+
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(identity_reply));
+    ASSERT_TRUE(dictionary.GetAircraft(0x510AF9, aircraft));
+    EXPECT_EQ(aircraft.squawk, 356);
+    EXPECT_TRUE(aircraft.received_fields & Aircraft::kChangedFieldsSquawk);
+    EXPECT_TRUE(aircraft.is_airborne);  // FS = 2 (alert, airborne).
+}
+
+TEST(AircraftDictionary, IngestCommBAltitudeReply) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    set_time_since_boot_ms(1000);
+
+    // 112-bit DF20 with ICAO 0x6BFC44 overlaid on the parity field, altitude 38000ft.
+    TransponderPacket comm_b_reply = TransponderPacket((char *)"A0001838CA3804000000000000AA");
+    EXPECT_EQ(comm_b_reply.GetICAOAddress(), 0x6BFC44u);
+    EXPECT_FALSE(dictionary.IngestTransponderPacket(comm_b_reply));
+
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(TransponderPacket((char *)"5D6BFC44C358CB")));
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(comm_b_reply));
+    Aircraft aircraft;
+    ASSERT_TRUE(dictionary.GetAircraft(0x6BFC44, aircraft));
+    EXPECT_EQ(aircraft.baro_altitude_ft, 38000);
+}
@@ -0,0 +1,170 @@
+#include <cstring>
+#include <string>
+
+#include "avr_parser.hh"
+#include "benchmark.hh"
+#include "gtest/gtest.h"
+
+TEST(AVRParser, ParseLineFormats) {
+    AVRParser parser;
+    RawTransponderPacket packet;
+
+    ASSERT_TRUE(parser.ParseLine("*8D4840D6202CC371C32CE0576098;", 30, packet));
+    EXPECT_EQ(packet.buffer_len_bits, 112u);
+    EXPECT_EQ(packet.buffer[0], 0x8D4840D6u);
+    EXPECT_EQ(packet.buffer[1], 0x202CC371u);
+    EXPECT_EQ(packet.buffer[2], 0xC32CE057u);
+    EXPECT_EQ(packet.buffer[3], 0x60980000u);
+    EXPECT_EQ(packet.mlat_12mhz_counts, 0u);
+    EXPECT_TRUE(TransponderPacket(packet).IsValid());
+
+    // Timestamped AVR, with a line ending.
+    ASSERT_TRUE(parser.ParseLine("@0000002B6C5A8d4840d6202cc371c32ce0576098;\r\n", 44, packet));
+    EXPECT_EQ(packet.buffer_len_bits, 112u);
+    EXPECT_EQ(packet.buffer[0], 0x8D4840D6u);
+    EXPECT_EQ(packet.mlat_12mhz_counts, 0x2B6C5Au);
+
+    // Bare hex, 56 bits.
+    ASSERT_TRUE(parser.ParseLine("5DDBBB5F18B46B", 14, packet));
+    EXPECT_EQ(packet.buffer_len_bits, 56u);
+    EXPECT_EQ(packet.buffer[0], 0x5DDBBB5Fu);
+    EXPECT_EQ(packet.buffer[1], 0x18B46B00u);
+    EXPECT_EQ(packet.buffer[2], 0u);
+    EXPECT_TRUE(TransponderPacket(packet).IsValid());
+
+    EXPECT_EQ(parser.GetNumPackets(), 3u);
+    EXPECT_EQ(parser.GetNumMalformedLines(), 0u);
+}
+
+TEST(AVRParser, MalformedLines) {
+    AVRParser parser;
+    RawTransponderPacket packet;
+
+    EXPECT_FALSE(parser.ParseLine("\r\n", 2, packet));  // Blank lines aren't malformed.
+    EXPECT_FALSE(parser.ParseLine("", 0, packet));
+    EXPECT_EQ(parser.GetNumMalformedLines(), 0u);
+
+    EXPECT_FALSE(parser.ParseLine("*8D4840D6202CC371C32CE057609;", 29, packet));    // Too short.
+    EXPECT_FALSE(parser.ParseLine("*8D4840D6202CC371C32CE05760988;", 31, packet));  // Too long.
+    EXPECT_FALSE(parser.ParseLine("*8D4840D6202CG371C32CE0576098;", 30, packet));   // Bad hex digit.
+    EXPECT_FALSE(parser.ParseLine("@0000002B6C5Z8D4840D6202CC371C32CE0576098;", 42, packet));  // Bad timestamp.
+    EXPECT_FALSE(parser.ParseLine("@0000002B", 9, packet));  // Truncated timestamp.
+    EXPECT_FALSE(parser.ParseLine("#8D4840D6202CC371C32CE0576098;", 30, packet));
+    EXPECT_EQ(parser.GetNumMalformedLines(), 6u);
+    EXPECT_EQ(parser.GetNumPackets(), 0u);
+
+    parser.ResetCounters();
+    EXPECT_EQ(parser.GetNumMalformedLines(), 0u);
+}
+
+TEST(AVRParser, ParseChunkedStream) {
+    const std::string kLog =
+        "*8D4840D6202CC371C32CE0576098;\r\n"
+        "garbage\n"
+        "\n"
+        "@0000002B6C5A5DDBBB5F18B46B;\n"
+        "8D76CE88204C9072CB48209A504D\n"
+        "*20001838CA3804;";  // No line ending on the last line.
+    const uint16_t kMaxNumPackets = 10;
+
+    // Parse the whole log at once for reference.
+    AVRParser reference_parser;
+    RawTransponderPacket reference_packets[kMaxNumPackets];
+    uint16_t num_reference_packets = 0;
+    EXPECT_EQ(reference_parser.Parse(kLog.c_str(), kLog.size(), reference_packets, kMaxNumPackets,
+                                     num_reference_packets, true),
+              kLog.size());
+    ASSERT_EQ(num_reference_packets, 4);
+    EXPECT_EQ(reference_parser.GetNumMalformedLines(), 1u);
+    EXPECT_EQ(reference_packets[1].mlat_12mhz_counts, 0x2B6C5Au);
+    EXPECT_EQ(reference_packets[3].buffer[0], 0x20001838u);
+
+    // Without end_of_stream, the last line is held back.
+    AVRParser parser;
+    RawTransponderPacket packets[kMaxNumPackets];
+    uint16_t num_packets = 0;
+    EXPECT_EQ(parser.Parse(kLog.c_str(), kLog.size(), packets, kMaxNumPackets, num_packets), kLog.size() - 16);
+    EXPECT_EQ(num_packets, 3);
+
+    // Feed the log in chunks of every size, carrying partial lines over like a caller reading from a file would.
+    for (uint16_t chunk_len = 1; chunk_len <= kLog.size(); chunk_len++) {
+        AVRParser chunk_parser;
+        std::string pending;
+        uint16_t num_chunk_packets = 0;
+        for (uint16_t offset = 0; offset < kLog.size(); offset += chunk_len) {
+            pending += kLog.substr(offset, chunk_len);
+            bool end_of_stream = offset + chunk_len >= kLog.size();
+            uint16_t num_new_packets = 0;
+            uint32_t num_consumed = chunk_parser.Parse(pending.c_str(), pending.size(), packets + num_chunk_packets,
+                                                       kMaxNumPackets - num_chunk_packets, num_new_packets,
+                                                       end_of_stream);
+            num_chunk_packets += num_new_packets;
+            pending.erase(0, num_consumed);
+        }
+        EXPECT_TRUE(pending.empty());
+        ASSERT_EQ(num_chunk_packets, num_reference_packets) << "chunk_len " << chunk_len;
+        EXPECT_EQ(chunk_parser.GetNumMalformedLines(), 1u);
+        for (uint16_t i = 0; i < num_chunk_packets; i++) {
+            EXPECT_EQ(memcmp(packets[i].buffer, reference_packets[i].buffer, sizeof(packets[i].buffer)), 0);
+            EXPECT_EQ(packets[i].buffer_len_bits, reference_packets[i].buffer_len_bits);
+            EXPECT_EQ(packets[i].mlat_12mhz_counts, reference_packets[i].mlat_12mhz_counts);
+        }
+    }
+}
+
+TEST(AVRParser, StopsWhenOutputFull) {
+    const std::string kLog = "*5DDBBB5F18B46B;\n*5DDBBB5F18B46B;\n*5DDBBB5F18B46B;\n";
+    AVRParser parser;
+    RawTransponderPacket packets[2];
+    uint16_t num_packets = 0;
+    uint32_t num_consumed = parser.Parse(kLog.c_str(), kLog.size(), packets, 2, num_packets);
+    EXPECT_EQ(num_packets, 2);
+    EXPECT_EQ(num_consumed, 34u);
+    EXPECT_EQ(parser.Parse(kLog.c_str() + num_consumed, kLog.size() - num_consumed, packets, 2, num_packets),
+              kLog.size() - num_consumed);
+    EXPECT_EQ(num_packets, 1);
+}
+
+TEST(AVRParser, LongLineWithoutLineEnding) {
+    // A run of junk longer than any valid line gets consumed and counted instead of being carried forever.
+    std::string junk(AVRParser::kMaxLineLenChars + 1, 'x');
+    AVRParser parser;
+    RawTransponderPacket packet;
+    uint16_t num_packets = 0;
+    EXPECT_EQ(parser.Parse(junk.c_str(), junk.size(), &packet, 1, num_packets), junk.size());
+    EXPECT_EQ(num_packets, 0);
+    EXPECT_EQ(parser.GetNumMalformedLines(), 1u);
+}
+
+TEST(AVRParser, DISABLED_Benchmark) {
+    const uint32_t kNumLines = 100000;
+    std::string log;
+    for (uint32_t i = 0; i < kNumLines; i++) {
+        log += i % 2 ? "*8D4840D6202CC371C32CE0576098;\n" : "@0000002B6C5A5DDBBB5F18B46B;\n";
+    }
+
+    const uint16_t kMaxNumPackets = 256;
+    RawTransponderPacket packets[kMaxNumPackets];
+    AVRParser parser;
+    float parser_ns = benchmark_ns([&]() {
+        uint32_t offset = 0;
+        while (offset < log.size()) {
+            uint16_t num_packets = 0;
+            offset +=
+                parser.Parse(log.c_str() + offset, log.size() - offset, packets, kMaxNumPackets, num_packets, true);
+        }
+    });
+    EXPECT_EQ(parser.GetNumPackets(), kNumLines);
+
+    // Old approach: split into lines and construct a TransponderPacket from each hex string.
+    char line[AVRParser::kMaxLineLenChars];
+    float string_ns = benchmark_ns([&]() {
+        for (uint32_t i = 0; i < kNumLines; i++) {
+            strcpy(line, i % 2 ? "8D4840D6202CC371C32CE0576098" : "5DDBBB5F18B46B");
+            benchmark_sink ^= TransponderPacket(line).GetPacketBuffer()[0];
+        }
+    });
+
+    printf("AVR parsing: AVRParser %.1f MB/s, TransponderPacket string constructor %.1f MB/s.\r\n",
+           log.size() * 1e3f / parser_ns, log.size() * 1e3f / string_ns);
+}
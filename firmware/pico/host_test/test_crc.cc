@@ -0,0 +1,158 @@
+#include <cstdlib>
+
+#include "adsb_packet.hh"
+#include "benchmark.hh"
+#include "buffer_utils.hh"
+#include "crc.hh"
+#include "gtest/gtest.h"
+
+/**
+ * Bit-serial CRC-24 that TransponderPacket::CalculateCRC24 used before the table-driven engine. Kept here as a
+ * reference implementation for checking and benchmarking crc24().
+ */
+uint32_t crc24_bit_serial(const uint32_t buffer[TransponderPacket::kMaxPacketLenWords32], uint16_t packet_len_bits) {
+    uint32_t crc_buffer[TransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t i = 0; i < TransponderPacket::kMaxPacketLenWords32; i++) {
+        crc_buffer[i] = buffer[i];
+    }
+    set_n_bit_word_in_buffer(24, 0x0, packet_len_bits - 24, crc_buffer);
+    for (uint16_t i = 0; i < packet_len_bits - 24; i++) {
+        uint32_t word = get_n_bit_word_from_buffer(kCRC24GeneratorNumBits, i, crc_buffer);
+        if (word & (0b1 << 24)) {
+            set_n_bit_word_in_buffer(kCRC24GeneratorNumBits, word ^ kCRC24Generator, i, crc_buffer);
+        }
+    }
+    return get_n_bit_word_from_buffer(24, packet_len_bits - 24, crc_buffer);
+}
+
+void fill_random_packet_buffer(uint32_t buffer[TransponderPacket::kMaxPacketLenWords32], uint16_t packet_len_bits) {
+    for (uint16_t i = 0; i < TransponderPacket::kMaxPacketLenWords32; i++) {
+        buffer[i] = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+    }
+    // Left-align the packet and zero out anything past the last bit.
+    uint16_t last_word_index = (packet_len_bits - 1) / 32;
+    buffer[last_word_index] &= UINT32_MAX << (32 * (last_word_index + 1) - packet_len_bits);
+    for (uint16_t i = last_word_index + 1; i < TransponderPacket::kMaxPacketLenWords32; i++) {
+        buffer[i] = 0;
+    }
+}
+
+TEST(CRC24, KnownChecksums) {
+    // Test packet from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
+    uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32] = {0x8D406B90u, 0x2015A678u, 0xD4D22000u,
+                                                                       0x00000000u};
+    EXPECT_EQ(crc24(packet_buffer, 88), 0xAA4BDAu);
+
+    uint8_t packet_bytes[] = {0x8D, 0x40, 0x6B, 0x90, 0x20, 0x15, 0xA6, 0x78, 0xD4, 0xD2, 0x20};
+    EXPECT_EQ(crc24(packet_bytes, sizeof(packet_bytes)), 0xAA4BDAu);
+
+    // Running the CRC over a full valid message (including parity) leaves no remainder.
+    uint32_t valid_packet_buffer[TransponderPacket::kMaxPacketLenWords32] = {0x8D76CE88u, 0x204C9072u, 0xCB48209Au,
+                                                                             0x504D0000u};
+    EXPECT_EQ(crc24(valid_packet_buffer, 112), 0u);
+}
+
+TEST(CRC24, MatchesBitSerial) {
+    srand(0);
+    uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t i = 0; i < 1000; i++) {
+        fill_random_packet_buffer(packet_buffer, TransponderPacket::kExtendedSquitterPacketLenBits);
+        ASSERT_EQ(crc24(packet_buffer, TransponderPacket::kExtendedSquitterPacketLenBits - 24),
+                  crc24_bit_serial(packet_buffer, TransponderPacket::kExtendedSquitterPacketLenBits));
+        fill_random_packet_buffer(packet_buffer, TransponderPacket::kSquitterPacketNumBits);
+        ASSERT_EQ(crc24(packet_buffer, TransponderPacket::kSquitterPacketNumBits - 24),
+                  crc24_bit_serial(packet_buffer, TransponderPacket::kSquitterPacketNumBits));
+    }
+}
+
+TEST(CRC24, DISABLED_Benchmark) {
+    const uint16_t kNumPackets = 1000;
+    const uint16_t kNumPasses = 20;
+    static uint32_t packet_buffers[kNumPackets][TransponderPacket::kMaxPacketLenWords32];
+    srand(0);
+    for (uint16_t i = 0; i < kNumPackets; i++) {
+        fill_random_packet_buffer(packet_buffers[i], TransponderPacket::kExtendedSquitterPacketLenBits);
+    }
+
+    float bit_serial_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                benchmark_sink ^=
+                    crc24_bit_serial(packet_buffers[i], TransponderPacket::kExtendedSquitterPacketLenBits);
+            }
+        }
+    });
+    float table_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                benchmark_sink ^= crc24(packet_buffers[i], TransponderPacket::kExtendedSquitterPacketLenBits - 24);
+            }
+        }
+    });
+
+    float num_crcs = kNumPackets * kNumPasses;
+    printf("CRC24 112-bit frame: bit-serial %.1f ns/frame, table-driven %.1f ns/frame.\r\n", bit_serial_ns / num_crcs,
+           table_ns / num_crcs);
+}
+
+TEST(StreamingCRC24, MatchesBufferCRC) {
+    srand(1);
+    uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t i = 0; i < 1000; i++) {
+        StreamingCRC24 rx_crc;
+        uint32_t crc = 0;
+        EXPECT_FALSE(rx_crc.GetCRC(TransponderPacket::kSquitterPacketNumBits, crc));
+
+        fill_random_packet_buffer(packet_buffer, TransponderPacket::kExtendedSquitterPacketLenBits);
+        for (uint16_t j = 0; j < StreamingCRC24::kExtendedSquitterDataNumWords; j++) {
+            rx_crc.IngestWord(packet_buffer[j]);
+            if (j == StreamingCRC24::kSquitterDataNumWords - 1) {
+                // 56-bit CRC is available as soon as the first word is in.
+                ASSERT_TRUE(rx_crc.GetCRC(TransponderPacket::kSquitterPacketNumBits, crc));
+                ASSERT_EQ(crc, crc24(packet_buffer, TransponderPacket::kSquitterPacketNumBits - 24));
+                EXPECT_FALSE(rx_crc.GetCRC(TransponderPacket::kExtendedSquitterPacketLenBits, crc));
+            }
+        }
+        ASSERT_TRUE(rx_crc.GetCRC(TransponderPacket::kExtendedSquitterPacketLenBits, crc));
+        ASSERT_EQ(crc, crc24(packet_buffer, TransponderPacket::kExtendedSquitterPacketLenBits - 24));
+
+        rx_crc.Reset();
+        EXPECT_EQ(rx_crc.GetNumWordsIngested(), 0);
+        EXPECT_FALSE(rx_crc.GetCRC(TransponderPacket::kExtendedSquitterPacketLenBits, crc));
+    }
+}
+
+TEST(StreamingCRC24, ConstructTransponderPacket) {
+    // Words as they come out of the demodulator, after the last word has been left-aligned.
+    RawTransponderPacket raw_packet = {.buffer = {0x8D76CE88u, 0x204C9072u, 0xCB48209Au, 0x504D0000u},
+                                       .buffer_len_bits = TransponderPacket::kExtendedSquitterPacketLenBits};
+    StreamingCRC24 rx_crc;
+    for (uint16_t i = 0; i < TransponderPacket::kExtendedSquitterPacketNumWords32 - 1; i++) {
+        rx_crc.IngestWord(raw_packet.buffer[i]);
+    }
+    uint32_t crc;
+    ASSERT_TRUE(rx_crc.GetCRC(raw_packet.buffer_len_bits, crc));
+    raw_packet.crc = crc;
+    raw_packet.flags = RawTransponderPacket::kFlagCRCCalculated;
+    TransponderPacket packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+
+    // Parity bits aren't part of the streaming CRC, so errors in them are still caught at construction time.
+    raw_packet.buffer[3] ^= 0x00010000u;
+    packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(packet.IsValid());  // Single-bit error in the parity field is corrected.
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 1);
+
+    // A CRC that was handed over by the demodulator is trusted as-is.
+    raw_packet.buffer[3] ^= 0x00010000u;
+    raw_packet.crc ^= 0x1;
+    packet = TransponderPacket(raw_packet);
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 1);
+
+    // Without the flag the CRC is recalculated from the packet buffer.
+    raw_packet.flags = RawTransponderPacket::kFlagNone;
+    packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+}
@@ -1,8 +1,10 @@
+#include <thread>
+
 #include "data_structures.hh"
 #include "gtest/gtest.h"
 
 template <class T>
-void FillAndEmptyQueue(PFBQueue<T> &queue, uint16_t queue_max_length) {
+void FillAndEmptyQueue(SPSCQueue<T> &queue, uint16_t queue_max_length) {
     ASSERT_EQ(queue.Length(), 0);
     // Fill up the queue.
     for (uint16_t i = 0; i < queue_max_length; i++) {
@@ -29,49 +31,220 @@ void FillAndEmptyQueue(PFBQueue<T> &queue, uint16_t queue_max_length) {
     }
 }
 
-TEST(PFBQueue, BasicConstruction) {
-    // Dynamically allocate buffer.
-    uint16_t buf_len_num_elements = 5;
-    PFBQueue<uint32_t> queue = PFBQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = nullptr});
-    FillAndEmptyQueue(queue, buf_len_num_elements - 1);
+TEST(SPSCQueue, BasicConstruction) {
+    // Dynamically allocate buffer. Every slot is usable.
+    uint16_t buf_len_num_elements = 8;
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = nullptr});
+    EXPECT_EQ(queue.Capacity(), buf_len_num_elements);
+    FillAndEmptyQueue(queue, buf_len_num_elements);
 
-    // Statically allocate buffer.
+    // Use a statically allocated buffer.
     uint32_t buffer[buf_len_num_elements];
-    PFBQueue<uint32_t> static_queue =
-        PFBQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = buffer});
-    FillAndEmptyQueue(static_queue, buf_len_num_elements - 1);
+    SPSCQueue<uint32_t> static_queue =
+        SPSCQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = buffer});
+    FillAndEmptyQueue(static_queue, buf_len_num_elements);
+}
+
+TEST(SPSCQueue, NonPowerOfTwoCapacityRoundsDown) {
+    uint32_t buffer[30];
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 30, .buffer = buffer});
+    EXPECT_EQ(queue.Capacity(), 16);
+    FillAndEmptyQueue(queue, 16);
+}
+
+TEST(SPSCQueue, Peek) {
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 8, .buffer = nullptr});
+    uint32_t element;
+    EXPECT_FALSE(queue.Peek(element));
+    for (uint16_t i = 0; i < 5; i++) {
+        ASSERT_TRUE(queue.Push(i * 2));
+    }
+    for (uint16_t i = 0; i < 5; i++) {
+        ASSERT_TRUE(queue.Peek(element, i));
+        EXPECT_EQ(element, i * 2u);
+    }
+    EXPECT_FALSE(queue.Peek(element, 5));
+    EXPECT_EQ(queue.Length(), 5);
+}
+
+TEST(SPSCQueue, Clear) {
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 8, .buffer = nullptr});
+    for (uint16_t i = 0; i < 6; i++) {
+        ASSERT_TRUE(queue.Push(i));
+    }
+    queue.Clear();
+    EXPECT_EQ(queue.Length(), 0);
+    uint32_t element;
+    EXPECT_FALSE(queue.Pop(element));
+    FillAndEmptyQueue(queue, 8);
+}
+
+TEST(SPSCQueue, BatchPushPop) {
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 8, .buffer = nullptr});
+    uint32_t in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    uint32_t out[10] = {0};
+
+    // Only as many elements as there is room for get pushed, the rest are counted as overflows.
+    EXPECT_EQ(queue.Push(in, 10), 8);
+    EXPECT_EQ(queue.GetNumOverflows(), 2u);
+    EXPECT_EQ(queue.GetHighWaterMark(), 8);
+
+    EXPECT_EQ(queue.Pop(out, 5), 5);
+    for (uint16_t i = 0; i < 5; i++) {
+        EXPECT_EQ(out[i], i);
+    }
+    // Wrap around the end of the buffer.
+    EXPECT_EQ(queue.Push(in, 4), 4);
+    EXPECT_EQ(queue.Length(), 7);
+    EXPECT_EQ(queue.Pop(out, 10), 7);
+    uint32_t expected[7] = {5, 6, 7, 0, 1, 2, 3};
+    for (uint16_t i = 0; i < 7; i++) {
+        EXPECT_EQ(out[i], expected[i]);
+    }
+    EXPECT_EQ(queue.Pop(out, 10), 0);
+    EXPECT_EQ(queue.GetHighWaterMark(), 8);
 }
 
-TEST(PFBQueue, Peek) {
-    uint16_t buf_len_num_elements = 30;
-    PFBQueue<uint32_t> queue = PFBQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = nullptr});
-    uint32_t peek_buffer;
-    ASSERT_FALSE(queue.Peek(peek_buffer));
-
-    // One push and pop to force a wraparound while testing peek.
-    queue.Push(0);
-    queue.Pop(peek_buffer);
-
-    for (uint16_t i = 0; i < buf_len_num_elements - 1; i++) {
-        queue.Push(i);
-        ASSERT_TRUE(queue.Peek(peek_buffer));
-        ASSERT_EQ(peek_buffer, 0u);
-        ASSERT_TRUE(queue.Peek(peek_buffer, i));
-        ASSERT_EQ(peek_buffer, i);
+TEST(SPSCQueue, SpanPeekCommit) {
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 8, .buffer = nullptr});
+    const uint32_t *read_span;
+    EXPECT_EQ(queue.PeekSpan(read_span), 0);
+
+    // Fill in place from the producer side.
+    uint32_t *write_span;
+    ASSERT_EQ(queue.ReservePushSpan(write_span), 8);
+    for (uint16_t i = 0; i < 6; i++) {
+        write_span[i] = i;
     }
+    EXPECT_EQ(queue.Length(), 0);  // Nothing is visible until committed.
+    queue.CommitPush(6);
+    EXPECT_EQ(queue.Length(), 6);
+
+    ASSERT_EQ(queue.PeekSpan(read_span), 6);
+    EXPECT_EQ(read_span[0], 0u);
+    EXPECT_EQ(read_span[5], 5u);
+    queue.CommitPop(4);
+    EXPECT_EQ(queue.Length(), 2);
+
+    // Free space wraps around the end of the buffer, so the first span only runs to the end.
+    ASSERT_EQ(queue.ReservePushSpan(write_span), 2);
+    write_span[0] = 6;
+    write_span[1] = 7;
+    queue.CommitPush(2);
+    ASSERT_EQ(queue.ReservePushSpan(write_span), 4);
+    write_span[0] = 8;
+    queue.CommitPush(1);
+
+    // Readable elements also wrap, so they come out in two spans.
+    ASSERT_EQ(queue.PeekSpan(read_span), 4);
+    EXPECT_EQ(read_span[0], 4u);
+    EXPECT_EQ(read_span[3], 7u);
+    queue.CommitPop(4);
+    ASSERT_EQ(queue.PeekSpan(read_span), 1);
+    EXPECT_EQ(read_span[0], 8u);
+    queue.CommitPop(1);
+    EXPECT_EQ(queue.Length(), 0);
 }
 
-TEST(PFBQueue, Clear) {
-    uint16_t buf_len_num_elements = 30;
-    PFBQueue<uint32_t> queue = PFBQueue<uint32_t>({.buf_len_num_elements = buf_len_num_elements, .buffer = nullptr});
+TEST(SPSCQueue, IndexWrapAround) {
+    // Run the free running head and tail counters past 2^16 a few times.
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 4, .buffer = nullptr});
+    for (uint32_t i = 0; i < 3 * UINT16_MAX; i++) {
+        ASSERT_TRUE(queue.Push(i));
+        ASSERT_TRUE(queue.Push(i + 1));
+        ASSERT_EQ(queue.Length(), 2);
+        uint32_t element;
+        ASSERT_TRUE(queue.Pop(element));
+        ASSERT_EQ(element, i);
+        ASSERT_TRUE(queue.Pop(element));
+        ASSERT_EQ(element, i + 1);
+    }
+    EXPECT_EQ(queue.GetNumOverflows(), 0u);
+}
+
+TEST(SPSCQueue, ThreadedStress) {
+    // One producer and one consumer hammer a small queue, mixing the single, batch, and span APIs on both sides. Every
+    // element has to come out exactly once and in order.
+    const uint32_t kNumElements = 200000;
+    SPSCQueue<uint32_t> queue = SPSCQueue<uint32_t>({.buf_len_num_elements = 64, .buffer = nullptr});
+
+    std::thread producer([&queue, kNumElements]() {
+        uint32_t next = 0;
+        while (next < kNumElements) {
+            if (queue.Length() == queue.Capacity()) {
+                std::this_thread::yield();  // Let the consumer catch up if both threads are on the same CPU.
+            }
+            switch (next % 3) {
+                case 0:
+                    // Only push if there's room, since a failed push counts as an overflow.
+                    if (queue.Length() < queue.Capacity() && queue.Push(next)) {
+                        next++;
+                    }
+                    break;
+                case 1: {
+                    uint32_t batch[7];
+                    uint16_t batch_len = std::min(7u, kNumElements - next);
+                    // Only push as many as fit so that nothing gets dropped.
+                    batch_len = std::min<uint16_t>(batch_len, queue.Capacity() - queue.Length());
+                    for (uint16_t i = 0; i < batch_len; i++) {
+                        batch[i] = next + i;
+                    }
+                    next += queue.Push(batch, batch_len);
+                    break;
+                }
+                case 2: {
+                    uint32_t *span;
+                    uint16_t span_len = std::min<uint32_t>(queue.ReservePushSpan(span), kNumElements - next);
+                    for (uint16_t i = 0; i < span_len; i++) {
+                        span[i] = next + i;
+                    }
+                    queue.CommitPush(span_len);
+                    next += span_len;
+                    break;
+                }
+            }
+        }
+    });
 
-    uint16_t num_pushes_each_time = 10;
-    for (uint16_t i = 0; i < buf_len_num_elements; i++) {
-        ASSERT_EQ(queue.Length(), 0);
-        for (uint16_t j = 0; j < num_pushes_each_time; j++) {
-            queue.Push(i);
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < kNumElements) {  // Keep draining on failure so that the producer can finish.
+        if (queue.Length() == 0) {
+            std::this_thread::yield();
+        }
+        switch (expected % 3) {
+            case 0: {
+                uint32_t element;
+                if (queue.Pop(element)) {
+                    in_order &= element == expected;
+                    expected++;
+                }
+                break;
+            }
+            case 1: {
+                uint32_t batch[5];
+                uint16_t num_popped = queue.Pop(batch, 5);
+                for (uint16_t i = 0; i < num_popped; i++) {
+                    in_order &= batch[i] == expected++;
+                }
+                break;
+            }
+            case 2: {
+                const uint32_t *span;
+                uint16_t span_len = queue.PeekSpan(span);
+                for (uint16_t i = 0; i < span_len; i++) {
+                    in_order &= span[i] == expected++;
+                }
+                queue.CommitPop(span_len);
+                break;
+            }
         }
-        ASSERT_EQ(queue.Length(), num_pushes_each_time);
-        queue.Clear();
     }
-}
\ No newline at end of file
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(expected, kNumElements);
+    EXPECT_EQ(queue.Length(), 0);
+    EXPECT_EQ(queue.GetNumOverflows(), 0u);
+    EXPECT_LE(queue.GetHighWaterMark(), 64);
+}
@@ -0,0 +1,157 @@
+#include "demod_frame.hh"
+#include "gtest/gtest.h"
+
+static const uint16_t kRingNumWords = 16;
+// DF17 airborne velocity message from ICAO address 0xA9586E.
+static const uint32_t kPacketBuffer[] = {0x8DA9586E, 0x99092D9D, 0x404C189D, 0xE7500000};
+
+/**
+ * Writes a message to a ring buffer the same way as the message_demodulator PIO program.
+ * @param[in] ring Ring buffer with kRingNumWords words.
+ * @param[inout] num_words_written Number of words written to the ring so far.
+ * @param[in] buffer Message bits, MSb of the first word first.
+ * @param[in] num_bits Number of bits in the message.
+ * @param[in] write_end_of_frame False to stop after the message's full words, as if it were still coming in.
+ */
+void write_demod_frame(uint32_t ring[], uint32_t &num_words_written, const uint32_t buffer[], uint32_t num_bits,
+                       bool write_end_of_frame = true) {
+    uint16_t num_full_words = num_bits / kBitsPerWord;
+    for (uint16_t i = 0; i < num_full_words; i++) {
+        ring[num_words_written++ % kRingNumWords] = buffer[i];
+    }
+    if (!write_end_of_frame) {
+        return;
+    }
+    uint16_t num_partial_word_bits = num_bits % kBitsPerWord;
+    ring[num_words_written++ % kRingNumWords] =
+        num_partial_word_bits > 0 ? buffer[num_full_words] >> (kBitsPerWord - num_partial_word_bits) : 0;
+    ring[num_words_written++ % kRingNumWords] = ~num_bits;
+}
+
+TEST(DemodFrame, FindFrames) {
+    uint32_t ring[kRingNumWords] = {0};
+    uint32_t num_words_written = 0;
+    uint32_t last_message_end_word_count = 0;
+    DemodFrame frames[2];
+
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 0u);
+    EXPECT_EQ(frames[0].num_bits, 112u);
+    EXPECT_EQ(last_message_end_word_count, 5u);
+
+    // Two messages at once, wrapping around the end of the ring.
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 56);
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 2, frames), 2u);
+    EXPECT_EQ(frames[0].start_word_count, 5u);
+    EXPECT_EQ(frames[0].num_bits, 56u);
+    EXPECT_EQ(frames[1].start_word_count, 8u);
+    EXPECT_EQ(frames[1].num_bits, 112u);
+    EXPECT_EQ(last_message_end_word_count, 13u);
+    EXPECT_EQ(num_words_written, kRingNumWords - 3u);
+
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 13u);
+    EXPECT_EQ(frames[0].num_bits, 112u);
+    EXPECT_EQ(last_message_end_word_count, 18u);
+}
+
+TEST(DemodFrame, FindFramesWithNextMessageStarted) {
+    uint32_t ring[kRingNumWords] = {0};
+    uint32_t num_words_written = 0;
+    uint32_t last_message_end_word_count = 0;
+    DemodFrame frames[2];
+
+    // The DEMOD ISR runs late for the first message, after the other preamble detector has matched a preamble and
+    // the demodulator has pushed the full words of the next message.
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112, false);
+    EXPECT_EQ(num_words_written, 8u);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 0u);
+    EXPECT_EQ(frames[0].num_bits, 112u);
+    EXPECT_EQ(last_message_end_word_count, 5u);
+
+    // The next message is still found once it finishes.
+    ring[num_words_written++ % kRingNumWords] = kPacketBuffer[3] >> 16;
+    ring[num_words_written++ % kRingNumWords] = ~112u;
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 5u);
+    EXPECT_EQ(frames[0].num_bits, 112u);
+    EXPECT_EQ(last_message_end_word_count, 10u);
+}
+
+TEST(DemodFrame, FindFramesPartialWordLooksLikeBitCount) {
+    uint32_t ring[kRingNumWords] = {0};
+    uint32_t num_words_written = 0;
+    uint32_t last_message_end_word_count = 0;
+    DemodFrame frames[1];
+
+    // Last 16 bits of the message would read as a bit count that ends the frame one word early.
+    const uint32_t kBuffer[] = {0x8DA9586E, 0x99092D9D, 0x404C189D, 0x00500000};
+    write_demod_frame(ring, num_words_written, kBuffer, 112);
+    EXPECT_EQ(ring[3], 80u);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 0u);
+    EXPECT_EQ(frames[0].num_bits, 112u);
+}
+
+TEST(DemodFrame, FindFramesFramingError) {
+    uint32_t ring[kRingNumWords] = {0};
+    uint32_t num_words_written = 0;
+    uint32_t last_message_end_word_count = 0;
+    DemodFrame frames[2];
+
+    // Second message's end-of-frame word is garbled, so it's dropped and the search starts over after it.
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+    ring[(num_words_written - 1) % kRingNumWords] = ~200u;
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 2, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 0u);
+    EXPECT_EQ(last_message_end_word_count, num_words_written);
+
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 56);
+    EXPECT_EQ(demod_find_frames(ring, kRingNumWords, last_message_end_word_count, num_words_written, 1, frames), 1u);
+    EXPECT_EQ(frames[0].start_word_count, 10u);
+    EXPECT_EQ(frames[0].num_bits, 56u);
+}
+
+TEST(DemodFrame, FrameToRawPacket) {
+    uint32_t ring[kRingNumWords] = {0};
+    uint32_t num_words_written = 14;  // Wrap around the end of the ring.
+    DemodFrame frame = {.start_word_count = num_words_written, .num_bits = 112};
+    write_demod_frame(ring, num_words_written, kPacketBuffer, 112);
+
+    RawTransponderPacket raw_packet;
+    ASSERT_TRUE(demod_frame_to_raw_packet(ring, kRingNumWords, frame, raw_packet));
+    EXPECT_EQ(raw_packet.buffer_len_bits, 112u);
+    for (uint16_t i = 0; i < TransponderPacket::kExtendedSquitterPacketNumWords32; i++) {
+        EXPECT_EQ(raw_packet.buffer[i], kPacketBuffer[i]);
+    }
+    EXPECT_TRUE(raw_packet.flags & RawTransponderPacket::kFlagCRCCalculated);
+    EXPECT_TRUE(TransponderPacket(raw_packet).IsValid());
+
+    // Extra bits past the end of the longest packet are thrown away.
+    frame.num_bits = 115;
+    ring[(frame.start_word_count + 3) % kRingNumWords] = kPacketBuffer[3] >> 13;
+    ASSERT_TRUE(demod_frame_to_raw_packet(ring, kRingNumWords, frame, raw_packet));
+    EXPECT_EQ(raw_packet.buffer_len_bits, 112u);
+    EXPECT_EQ(raw_packet.buffer[3], kPacketBuffer[3]);
+
+    // Rounded down to a 56-bit packet.
+    frame.num_bits = 60;
+    ASSERT_TRUE(demod_frame_to_raw_packet(ring, kRingNumWords, frame, raw_packet));
+    EXPECT_EQ(raw_packet.buffer_len_bits, 56u);
+
+    frame.num_bits = 55;
+    EXPECT_FALSE(demod_frame_to_raw_packet(ring, kRingNumWords, frame, raw_packet));
+}
+
+TEST(DemodFrame, RSSIADCCountsTodBm) {
+    EXPECT_EQ(rssi_adc_counts_to_dbm(1986, 1), 0);  // 1.6V is the 0dBm intercept.
+    EXPECT_EQ(rssi_adc_counts_to_dbm(0, 1), -96);
+    EXPECT_EQ(rssi_adc_counts_to_dbm(1986 * 2, 2), 0);
+    EXPECT_EQ(rssi_adc_counts_to_dbm(1986, 0), 0);  // No divide by 0.
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <vector>
+
+#include "grid_index.hh"
+#include "gtest/gtest.h"
+
+std::vector<uint16_t> get_entries_in_box(const GridIndex<16> &index, float min_latitude_deg, float max_latitude_deg,
+                                         float min_longitude_deg, float max_longitude_deg) {
+    std::vector<uint16_t> entries;
+    index.ForEachInBox(min_latitude_deg, max_latitude_deg, min_longitude_deg, max_longitude_deg,
+                       [&](uint16_t entry_index) { entries.push_back(entry_index); });
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+TEST(GridIndex, UpdateAndRemove) {
+    GridIndex<16> index;
+    EXPECT_TRUE(get_entries_in_box(index, -90.0f, 90.0f, -180.0f, 180.0f).empty());
+
+    index.Update(3, 37.6f, -122.4f);
+    index.Update(5, 37.7f, -122.2f);
+    index.Update(7, 47.4f, -122.3f);
+    EXPECT_EQ(get_entries_in_box(index, 37.0f, 38.0f, -123.0f, -122.0f), std::vector<uint16_t>({3, 5}));
+    EXPECT_EQ(get_entries_in_box(index, 47.0f, 48.0f, -123.0f, -122.0f), std::vector<uint16_t>({7}));
+    EXPECT_EQ(get_entries_in_box(index, -90.0f, 90.0f, -180.0f, 180.0f), std::vector<uint16_t>({3, 5, 7}));
+
+    // Moving an entry takes it out of its old cell.
+    index.Update(5, 47.5f, -122.3f);
+    EXPECT_EQ(get_entries_in_box(index, 37.0f, 38.0f, -123.0f, -122.0f), std::vector<uint16_t>({3}));
+    EXPECT_EQ(get_entries_in_box(index, 47.0f, 48.0f, -123.0f, -122.0f), std::vector<uint16_t>({5, 7}));
+
+    index.Remove(7);
+    index.Remove(7);  // Removing an entry that isn't in the index does nothing.
+    EXPECT_EQ(get_entries_in_box(index, 47.0f, 48.0f, -123.0f, -122.0f), std::vector<uint16_t>({5}));
+
+    index.Clear();
+    EXPECT_TRUE(get_entries_in_box(index, -90.0f, 90.0f, -180.0f, 180.0f).empty());
+}
+
+TEST(GridIndex, WrapsAroundAntimeridian) {
+    GridIndex<16> index;
+    index.Update(0, -17.8f, 179.9f);
+    index.Update(1, -17.8f, -179.9f);
+    index.Update(2, -17.8f, 170.0f);
+    EXPECT_EQ(get_entries_in_box(index, -18.0f, -17.0f, 179.0f, 181.0f), std::vector<uint16_t>({0, 1}));
+    EXPECT_EQ(get_entries_in_box(index, -18.0f, -17.0f, -181.0f, -179.0f), std::vector<uint16_t>({0, 1}));
+    // Boxes wider than the whole world visit each cell once.
+    EXPECT_EQ(get_entries_in_box(index, -18.0f, -17.0f, -300.0f, 300.0f), std::vector<uint16_t>({0, 1, 2}));
+}
+
+TEST(GridIndex, MatchesBruteForce) {
+    // Small index so that lots of cells share buckets.
+    GridIndex<16> index;
+    float latitudes_deg[16], longitudes_deg[16];
+    bool indexed[16] = {false};
+    srand(3);
+    for (uint32_t i = 0; i < 20000; i++) {
+        uint16_t entry_index = rand() % 16;
+        if (rand() % 4) {
+            // Cluster entries so that queries have something to find.
+            latitudes_deg[entry_index] = 40.0f + (rand() % 1000) / 100.0f;
+            longitudes_deg[entry_index] = -120.0f + (rand() % 1000) / 100.0f;
+            indexed[entry_index] = true;
+            index.Update(entry_index, latitudes_deg[entry_index], longitudes_deg[entry_index]);
+        } else {
+            indexed[entry_index] = false;
+            index.Remove(entry_index);
+        }
+
+        float min_latitude_deg = 40.0f + (rand() % 1000) / 100.0f;
+        float min_longitude_deg = -120.0f + (rand() % 1000) / 100.0f;
+        float max_latitude_deg = min_latitude_deg + (rand() % 300) / 100.0f;
+        float max_longitude_deg = min_longitude_deg + (rand() % 300) / 100.0f;
+        std::vector<uint16_t> entries =
+            get_entries_in_box(index, min_latitude_deg, max_latitude_deg, min_longitude_deg, max_longitude_deg);
+        // Every entry inside the box is found, and entries outside it can only come from cells on its edge.
+        for (uint16_t j = 0; j < 16; j++) {
+            bool found = std::find(entries.begin(), entries.end(), j) != entries.end();
+            if (!indexed[j]) {
+                ASSERT_FALSE(found);
+            } else if (latitudes_deg[j] >= min_latitude_deg && latitudes_deg[j] <= max_latitude_deg &&
+                       longitudes_deg[j] >= min_longitude_deg && longitudes_deg[j] <= max_longitude_deg) {
+                ASSERT_TRUE(found);
+            } else if (found) {
+                ASSERT_GT(latitudes_deg[j], min_latitude_deg - GridIndex<16>::kCellSizeDeg);
+                ASSERT_LT(latitudes_deg[j], max_latitude_deg + GridIndex<16>::kCellSizeDeg);
+                ASSERT_GT(longitudes_deg[j], min_longitude_deg - GridIndex<16>::kCellSizeDeg);
+                ASSERT_LT(longitudes_deg[j], max_longitude_deg + GridIndex<16>::kCellSizeDeg);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "gtest/gtest.h"
+#include "icao_confidence_set.hh"
+
+// Local copy, since gtest macros take their arguments by reference.
+const uint16_t kNumSlots = ICAOConfidenceSet::kNumSlots;
+
+TEST(ICAOConfidenceSet, InsertContains) {
+    ICAOConfidenceSet set = ICAOConfidenceSet();
+    EXPECT_EQ(set.GetNumActive(0), 0);
+    EXPECT_FALSE(set.Contains(0xDBBB5F, 0));
+
+    set.Insert(0xDBBB5F, 100);
+    EXPECT_TRUE(set.Contains(0xDBBB5F, 100));
+    EXPECT_FALSE(set.Contains(0xDBBB5E, 100));
+    EXPECT_EQ(set.GetNumActive(100), 1);
+
+    // Inserting the same address again refreshes it instead of adding a duplicate.
+    set.Insert(0xDBBB5F, 200);
+    EXPECT_EQ(set.GetNumActive(200), 1);
+
+    set.Clear();
+    EXPECT_FALSE(set.Contains(0xDBBB5F, 200));
+    EXPECT_EQ(set.GetNumActive(200), 0);
+}
+
+TEST(ICAOConfidenceSet, Expiry) {
+    ICAOConfidenceSet set = ICAOConfidenceSet({.ttl_ms = 1000});
+    set.Insert(0x123456, 0);
+    EXPECT_TRUE(set.Contains(0x123456, 1000));
+    EXPECT_FALSE(set.Contains(0x123456, 1001));
+
+    // Refreshing the address pushes out its expiry.
+    set.Insert(0x123456, 1001);
+    EXPECT_TRUE(set.Contains(0x123456, 2000));
+    EXPECT_FALSE(set.Contains(0x123456, 2002));
+    EXPECT_EQ(set.GetNumActive(2002), 0);
+}
+
+TEST(ICAOConfidenceSet, TimestampWraparound) {
+    ICAOConfidenceSet set = ICAOConfidenceSet({.ttl_ms = 1000});
+    set.Insert(0x123456, UINT32_MAX - 100);
+    EXPECT_TRUE(set.Contains(0x123456, 500));  // 601ms later, after the timestamp wrapped.
+    EXPECT_FALSE(set.Contains(0x123456, 1000));
+}
+
+TEST(ICAOConfidenceSet, FillAllSlots) {
+    ICAOConfidenceSet set = ICAOConfidenceSet();
+    // Sequential addresses land all over the table, but still collide with each other once it starts filling up.
+    for (uint32_t i = 0; i < kNumSlots; i++) {
+        set.Insert(0x400000 + i, 0);
+    }
+    uint16_t num_found = 0;
+    for (uint32_t i = 0; i < kNumSlots; i++) {
+        if (set.Contains(0x400000 + i, 0)) {
+            num_found++;
+        }
+    }
+    EXPECT_EQ(num_found, set.GetNumActive(0));
+    EXPECT_GT(num_found, kNumSlots * 3 / 4);
+    EXPECT_LE(num_found, kNumSlots);
+}
+
+TEST(ICAOConfidenceSet, EvictOldestWhenFull) {
+    ICAOConfidenceSet set = ICAOConfidenceSet();
+    // Overfill the table so that every probe window is full, with older addresses inserted first.
+    const uint32_t kNumAddresses = kNumSlots * 4;
+    for (uint32_t i = 0; i < kNumAddresses; i++) {
+        set.Insert(0x100000 + i * 7, i);
+    }
+    EXPECT_LE(set.GetNumActive(kNumAddresses), kNumSlots);
+    // The most recent address always makes it in, and the very first one was evicted to make room.
+    EXPECT_TRUE(set.Contains(0x100000 + (kNumAddresses - 1) * 7, kNumAddresses));
+    EXPECT_FALSE(set.Contains(0x100000, kNumAddresses));
+}
+
+TEST(ICAOConfidenceSet, ReuseExpiredSlot) {
+    ICAOConfidenceSet set = ICAOConfidenceSet({.ttl_ms = 10});
+    for (uint32_t i = 0; i < kNumSlots; i++) {
+        set.Insert(0x400000 + i, 0);
+    }
+    // All of the old addresses have expired, so new addresses can take over their slots without evicting each other.
+    for (uint32_t i = 0; i < kNumSlots / 2; i++) {
+        set.Insert(0x800000 + i, 100);
+    }
+    for (uint32_t i = 0; i < kNumSlots / 2; i++) {
+        EXPECT_TRUE(set.Contains(0x800000 + i, 100));
+    }
+    EXPECT_EQ(set.GetNumActive(100), kNumSlots / 2);
+}
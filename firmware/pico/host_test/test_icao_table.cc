@@ -0,0 +1,262 @@
+#include <memory>
+#include <unordered_map>
+
+#include "aircraft_dictionary.hh"
+#include "benchmark.hh"
+#include "gtest/gtest.h"
+#include "icao_table.hh"
+
+TEST(ICAOTable, InsertFindRemove) {
+    ICAOTable<uint32_t, 8> table;
+    EXPECT_EQ(table.Size(), 0);
+    EXPECT_EQ(table.Find(0xDBBB5F), nullptr);
+
+    bool inserted;
+    uint32_t *entry = table.FindOrInsert(0xDBBB5F, inserted);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(inserted);
+    *entry = 1234;
+    EXPECT_EQ(table.Size(), 1);
+    ASSERT_NE(table.Find(0xDBBB5F), nullptr);
+    EXPECT_EQ(*table.Find(0xDBBB5F), 1234u);
+
+    // Finding an existing entry doesn't insert a duplicate.
+    EXPECT_EQ(table.FindOrInsert(0xDBBB5F, inserted), entry);
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(table.Size(), 1);
+
+    EXPECT_TRUE(table.Remove(0xDBBB5F));
+    EXPECT_FALSE(table.Remove(0xDBBB5F));
+    EXPECT_EQ(table.Find(0xDBBB5F), nullptr);
+    EXPECT_EQ(table.Size(), 0);
+}
+
+TEST(ICAOTable, Full) {
+    ICAOTable<uint32_t, 8> table;
+    bool inserted;
+    for (uint32_t i = 0; i < 8; i++) {
+        ASSERT_NE(table.FindOrInsert(i, inserted), nullptr);
+    }
+    EXPECT_EQ(table.FindOrInsert(8, inserted), nullptr);
+    EXPECT_FALSE(inserted);
+    // Existing entries can still be found.
+    EXPECT_NE(table.FindOrInsert(7, inserted), nullptr);
+    EXPECT_FALSE(inserted);
+
+    // Removing one makes room for another.
+    EXPECT_TRUE(table.Remove(3));
+    EXPECT_NE(table.FindOrInsert(8, inserted), nullptr);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(table.Size(), 8);
+}
+
+TEST(ICAOTable, EntriesDontMove) {
+    ICAOTable<uint32_t, 16> table;
+    bool inserted;
+    uint32_t *entries[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        entries[i] = table.FindOrInsert(i * 599, inserted);
+        *entries[i] = i;
+    }
+    for (uint32_t i = 0; i < 16; i += 2) {
+        table.Remove(i * 599);
+    }
+    for (uint32_t i = 1; i < 16; i += 2) {
+        EXPECT_EQ(table.Find(i * 599), entries[i]);
+        EXPECT_EQ(*entries[i], i);
+    }
+}
+
+TEST(ICAOTable, IterateAndRemove) {
+    ICAOTable<uint32_t, 32> table;
+    bool inserted;
+    for (uint32_t i = 0; i < 20; i++) {
+        *table.FindOrInsert(0x100000 + i, inserted) = 0x100000 + i;
+    }
+    uint32_t num_entries = 0;
+    for (uint32_t &entry : table) {
+        EXPECT_EQ(table.Find(entry), &entry);
+        num_entries++;
+    }
+    EXPECT_EQ(num_entries, 20u);
+
+    // Remove odd entries while walking from the least recent entry.
+    uint32_t *entry = table.GetLeastRecent();
+    while (entry != nullptr) {
+        uint32_t *next_entry = table.GetMoreRecent(*entry);
+        if (*entry % 2) {
+            EXPECT_EQ(table.GetICAOAddress(*entry), *entry);
+            table.Remove(*entry);
+        }
+        entry = next_entry;
+    }
+    EXPECT_EQ(table.Size(), 10);
+    for (uint32_t &entry : table) {
+        EXPECT_EQ(entry % 2, 0u);
+    }
+}
+
+TEST(ICAOTable, RecencyOrder) {
+    ICAOTable<uint32_t, 8> table;
+    bool inserted;
+    EXPECT_EQ(table.GetLeastRecent(), nullptr);
+    for (uint32_t i = 0; i < 8; i++) {
+        *table.FindOrInsert(i, inserted) = i;
+    }
+    EXPECT_EQ(*table.GetLeastRecent(), 0u);
+
+    // Finding an entry doesn't count as touching it.
+    table.FindOrInsert(0, inserted);
+    EXPECT_EQ(*table.GetLeastRecent(), 0u);
+
+    table.Touch(*table.Find(0));
+    table.Touch(*table.Find(5));
+    table.Touch(*table.Find(1));
+    table.Touch(*table.Find(1));  // Touching the most recent entry again does nothing.
+    table.Remove(2);
+    uint32_t expected_order[] = {1, 5, 0, 7, 6, 4, 3};
+    uint16_t i = 0;
+    for (uint32_t &entry : table) {
+        ASSERT_LT(i, 7);
+        EXPECT_EQ(entry, expected_order[i++]);
+    }
+    EXPECT_EQ(i, 7);
+
+    // Walking from the least recent entry visits entries in the opposite order.
+    for (uint32_t *entry = table.GetLeastRecent(); entry != nullptr; entry = table.GetMoreRecent(*entry)) {
+        EXPECT_EQ(*entry, expected_order[--i]);
+    }
+    EXPECT_EQ(i, 0);
+
+    // Evict least recent entries until the table is empty.
+    while (table.GetLeastRecent() != nullptr) {
+        table.Remove(table.GetICAOAddress(*table.GetLeastRecent()));
+    }
+    EXPECT_EQ(table.Size(), 0);
+    EXPECT_FALSE(table.begin() != table.end());
+}
+
+TEST(ICAOTable, CapacityForBudget) {
+    EXPECT_EQ(icao_table_capacity_for_budget<Aircraft>(0), 0);
+    EXPECT_GE(AircraftDictionary::kMaxNumAircraft, 100);
+    EXPECT_LE(sizeof(ICAOTable<Aircraft, AircraftDictionary::kMaxNumAircraft>),
+              AIRCRAFT_DICTIONARY_MEMORY_BUDGET_BYTES);
+}
+
+TEST(ICAOTable, MatchesReference) {
+    // Small table so that probe runs overlap, and removals have to shift entries back.
+    ICAOTable<uint32_t, 16> table;
+    std::unordered_map<uint32_t, uint32_t> reference;
+    srand(2);
+    for (uint32_t i = 0; i < 100000; i++) {
+        uint32_t icao_address = rand() % 40;  // Few enough addresses that there are lots of repeats.
+        if (rand() % 2) {
+            bool inserted;
+            uint32_t *entry = table.FindOrInsert(icao_address, inserted);
+            if (reference.count(icao_address)) {
+                ASSERT_NE(entry, nullptr);
+                ASSERT_FALSE(inserted);
+                ASSERT_EQ(*entry, reference[icao_address]);
+            } else if (reference.size() < 16) {
+                ASSERT_NE(entry, nullptr);
+                ASSERT_TRUE(inserted);
+                *entry = i;
+                reference[icao_address] = i;
+            } else {
+                ASSERT_EQ(entry, nullptr);
+            }
+        } else {
+            ASSERT_EQ(table.Remove(icao_address), reference.erase(icao_address) > 0);
+        }
+        ASSERT_EQ(table.Size(), reference.size());
+    }
+    for (auto &itr : reference) {
+        ASSERT_NE(table.Find(itr.first), nullptr);
+        EXPECT_EQ(*table.Find(itr.first), itr.second);
+    }
+}
+
+/**
+ * Times inserting, looking up, iterating over, and removing num_aircraft aircraft, in nanoseconds per aircraft.
+ */
+template <class InsertFn, class FindFn, class IterateFn, class RemoveFn>
+void benchmark_aircraft_table(const char *name, uint16_t num_aircraft, InsertFn insert, FindFn find,
+                              IterateFn iterate, RemoveFn remove) {
+    const uint16_t kNumPasses = 20;
+    std::vector<uint32_t> icao_addresses;
+    srand(num_aircraft);
+    for (uint16_t i = 0; i < num_aircraft; i++) {
+        icao_addresses.push_back(rand() & 0xFFFFFF);
+    }
+
+    float insert_ns = 0, find_ns = 0, iterate_ns = 0, remove_ns = 0;
+    for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+        insert_ns += benchmark_ns([&]() {
+            for (uint32_t icao_address : icao_addresses) {
+                insert(icao_address);
+            }
+        });
+        find_ns += benchmark_ns([&]() {
+            for (uint32_t icao_address : icao_addresses) {
+                benchmark_sink += find(icao_address)->icao_address;
+            }
+        });
+        iterate_ns += benchmark_ns([&]() { benchmark_sink += iterate(); });
+        remove_ns += benchmark_ns([&]() {
+            for (uint32_t icao_address : icao_addresses) {
+                remove(icao_address);
+            }
+        });
+    }
+    float num_ops = kNumPasses * num_aircraft;
+    printf("%s, %u aircraft: insert %.1f ns, find %.1f ns, iterate %.1f ns, remove %.1f ns per aircraft.\r\n", name,
+           num_aircraft, insert_ns / num_ops, find_ns / num_ops, iterate_ns / num_ops, remove_ns / num_ops);
+}
+
+template <uint16_t kNumAircraft>
+void benchmark_icao_table_vs_unordered_map() {
+    auto table = std::make_unique<ICAOTable<Aircraft, kNumAircraft>>();
+    benchmark_aircraft_table(
+        "ICAOTable", kNumAircraft,
+        [&](uint32_t icao_address) {
+            bool inserted;
+            Aircraft *aircraft = table->FindOrInsert(icao_address, inserted);
+            if (inserted) {
+                *aircraft = Aircraft(icao_address);
+            }
+        },
+        [&](uint32_t icao_address) { return table->Find(icao_address); },
+        [&]() {
+            uint32_t sum = 0;
+            for (Aircraft &aircraft : *table) {
+                sum += aircraft.last_seen_timestamp_ms;
+            }
+            return sum;
+        },
+        [&](uint32_t icao_address) { table->Remove(icao_address); });
+
+    std::unordered_map<uint32_t, Aircraft> map;
+    benchmark_aircraft_table(
+        "std::unordered_map", kNumAircraft,
+        [&](uint32_t icao_address) {
+            // Same pattern as the old AircraftDictionary::GetAircraftPtr.
+            if (map.find(icao_address) == map.end()) {
+                map[icao_address] = Aircraft(icao_address);
+            }
+        },
+        [&](uint32_t icao_address) { return &map.find(icao_address)->second; },
+        [&]() {
+            uint32_t sum = 0;
+            for (auto &itr : map) {
+                sum += itr.second.last_seen_timestamp_ms;
+            }
+            return sum;
+        },
+        [&](uint32_t icao_address) { map.erase(icao_address); });
+}
+
+TEST(ICAOTable, DISABLED_Benchmark) {
+    benchmark_icao_table_vs_unordered_map<100>();
+    benchmark_icao_table_vs_unordered_map<500>();
+    benchmark_icao_table_vs_unordered_map<2000>();
+}
@@ -0,0 +1,37 @@
+#include "gtest/gtest.h"
+#include "load_counter.hh"
+
+TEST(LoadCounter, LatchesOncePerWindow) {
+    LoadCounter counter = LoadCounter({.window_us = 1000});
+    EXPECT_EQ(counter.GetLoadPercent(), 0);
+    EXPECT_EQ(counter.GetNumIterations(), 0u);
+
+    // 250us busy, 250us idle, window not over yet.
+    counter.RecordIteration(0, 250, true);
+    counter.RecordIteration(250, 500, false);
+    EXPECT_EQ(counter.GetNumIterations(), 0u);
+
+    // 100us busy then a 400us stall, which ends the window.
+    counter.RecordIteration(500, 600, true);
+    counter.RecordIteration(600, 1000, true);
+    EXPECT_EQ(counter.GetLoadPercent(), 75);
+    EXPECT_EQ(counter.GetMaxIterationUs(), 400u);
+    EXPECT_EQ(counter.GetNumIterations(), 4u);
+
+    // Next window is all idle polling.
+    for (uint32_t t = 1000; t < 2000; t += 10) {
+        counter.RecordIteration(t, t + 10, false);
+    }
+    EXPECT_EQ(counter.GetLoadPercent(), 0);
+    EXPECT_EQ(counter.GetMaxIterationUs(), 10u);
+    EXPECT_EQ(counter.GetNumIterations(), 100u);
+}
+
+TEST(LoadCounter, TimestampWraparound) {
+    LoadCounter counter = LoadCounter({.window_us = 1000});
+    uint32_t start_us = UINT32_MAX - 499;
+    counter.RecordIteration(start_us, start_us + 500, true);  // Ends at 0 after wrapping.
+    counter.RecordIteration(0, 500, false);
+    EXPECT_EQ(counter.GetLoadPercent(), 50);
+    EXPECT_EQ(counter.GetNumIterations(), 2u);
+}
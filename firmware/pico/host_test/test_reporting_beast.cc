@@ -9,7 +9,7 @@ TEST(BeastUtils, TransponderPacketToBeastFrame) {
 
     uint8_t beast_frame_buf[kBeastFrameMaxLenBytes];
     // 1 (frame) + 6 (mlat) + 2 (mlat escape) + 1 (rssi) + 14 (data) + 1 (data escape) = 25 Bytes.
-    EXPECT_EQ(TransponderPacketToBeastFrame(tpacket, beast_frame_buf), 25);
+    EXPECT_EQ(TransponderPacketToBeastFrame(tpacket.GetRaw(), beast_frame_buf), 25);
     EXPECT_EQ(beast_frame_buf[0], 0x33);  // Packet type is Mode S long frame.
     EXPECT_EQ(beast_frame_buf[1], 0xFF);  // MLAT Counter Begin
     EXPECT_EQ(beast_frame_buf[2], 0x1A);
@@ -0,0 +1,190 @@
+#include "adsb_packet.hh"
+#include "aircraft_dictionary.hh"
+#include "benchmark.hh"
+#include "gtest/gtest.h"
+#include "macros.hh"
+#include "software_demodulator.hh"
+
+// DF17 airborne velocity message from ICAO address 0xA9586E, generated at 15.6Msps for the arbitrary waveform
+// generator.
+static const char *kCapturePath = CAPTURES_DIR "/good/adsb_packet.csv";
+static const char *kInvertedCapturePath = CAPTURES_DIR "/good/adsb_packet_inv.csv";
+static const uint32_t kCapturePacketBuffer[] = {0x8DA9586E, 0x99092D9D, 0x404C189D, 0xE7500000};
+static const uint32_t kCaptureICAOAddress = 0xA9586E;
+// Mid-scale trigger level. Pulses in the capture peak at about 3000mV, and are about 0.6us wide at half height.
+static const int kCaptureTLMilliVolts = 1500;
+
+void ExpectCapturePacket(const RawTransponderPacket &raw_packet) {
+    EXPECT_EQ(raw_packet.buffer_len_bits, 112u);
+    for (uint16_t i = 0; i < TransponderPacket::kExtendedSquitterPacketNumWords32; i++) {
+        EXPECT_EQ(raw_packet.buffer[i], kCapturePacketBuffer[i]);
+    }
+    TransponderPacket packet = TransponderPacket(raw_packet);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetICAOAddress(), kCaptureICAOAddress);
+}
+
+TEST(SoftwareDemodulator, LoadRigolCSV) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz = 0;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+    EXPECT_EQ(samples_mv.size(), 3750u);
+    EXPECT_FLOAT_EQ(sample_rate_hz, 15.6e6f);
+    EXPECT_NEAR(samples_mv[0], -61.1719f, 0.001f);
+
+    EXPECT_FALSE(LoadRigolCSV(CAPTURES_DIR "/not_a_capture.csv", samples_mv, sample_rate_hz));
+}
+
+TEST(SoftwareDemodulator, ReplayCapture) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    SoftwareDemodulator demodulator = SoftwareDemodulator({.sample_rate_hz = sample_rate_hz});
+    demodulator.IngestMilliVolts(samples_mv.data(), samples_mv.size(), kCaptureTLMilliVolts);
+    EXPECT_EQ(demodulator.GetNumFrames(), 1u);
+    EXPECT_EQ(demodulator.GetNumFramingErrors(), 0u);
+    ASSERT_EQ(demodulator.packets.size(), 1u);
+    ExpectCapturePacket(demodulator.packets[0]);
+
+    AircraftDictionary dictionary = AircraftDictionary();
+    EXPECT_TRUE(dictionary.IngestTransponderPacket(TransponderPacket(demodulator.packets[0])));
+    EXPECT_TRUE(dictionary.ContainsAircraft(kCaptureICAOAddress));
+}
+
+TEST(SoftwareDemodulator, ReplayInvertedCapture) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kInvertedCapturePath, samples_mv, sample_rate_hz));
+    for (float &sample_mv : samples_mv) {
+        sample_mv = -sample_mv;
+    }
+
+    SoftwareDemodulator demodulator = SoftwareDemodulator({.sample_rate_hz = sample_rate_hz});
+    demodulator.IngestMilliVolts(samples_mv.data(), samples_mv.size(), kCaptureTLMilliVolts);
+    ASSERT_EQ(demodulator.packets.size(), 1u);
+    ExpectCapturePacket(demodulator.packets[0]);
+}
+
+TEST(SoftwareDemodulator, ReplayCaptureTLSweep) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    // Pulses are wider than half a bit, and the tail of a 0 used to read as the start of a 1 at lower trigger levels
+    // for some sampling phases. Slide the capture through a full bit period of phases at each trigger level.
+    const uint16_t kNumPhases = 16;  // Capture samples per bit.
+    for (int tl_mv = 750; tl_mv <= 2750; tl_mv += 250) {
+        for (uint16_t phase = 0; phase < kNumPhases; phase++) {
+            SoftwareDemodulator demodulator = SoftwareDemodulator({.sample_rate_hz = sample_rate_hz});
+            std::vector<float> quiet_mv(phase, samples_mv[0]);
+            demodulator.IngestMilliVolts(quiet_mv.data(), quiet_mv.size(), tl_mv);
+            demodulator.IngestMilliVolts(samples_mv.data(), samples_mv.size(), tl_mv);
+            SCOPED_TRACE(testing::Message() << "tl_mv=" << tl_mv << " phase=" << phase);
+            ASSERT_EQ(demodulator.packets.size(), 1u);
+            ExpectCapturePacket(demodulator.packets[0]);
+        }
+    }
+}
+
+TEST(SoftwareDemodulator, ReplayCaptureBackToBack) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    // Feed the capture in small blocks to make sure messages can straddle calls to Ingest.
+    const uint16_t kNumRepeats = 10;
+    const uint16_t kBlockNumSamples = 100;
+    SoftwareDemodulator demodulator = SoftwareDemodulator({.sample_rate_hz = sample_rate_hz});
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        for (uint32_t j = 0; j < samples_mv.size(); j += kBlockNumSamples) {
+            uint32_t num_samples = MIN(kBlockNumSamples, samples_mv.size() - j);
+            demodulator.IngestMilliVolts(samples_mv.data() + j, num_samples, kCaptureTLMilliVolts);
+        }
+    }
+    EXPECT_EQ(demodulator.GetNumFramingErrors(), 0u);
+    ASSERT_EQ(demodulator.packets.size(), kNumRepeats);
+    // MLAT timestamps should be one capture length apart.
+    uint64_t capture_len_12mhz_counts = samples_mv.size() * 12e6 / sample_rate_hz;
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        ExpectCapturePacket(demodulator.packets[i]);
+        if (i > 0) {
+            uint64_t interval_12mhz_counts =
+                demodulator.packets[i].mlat_12mhz_counts - demodulator.packets[i - 1].mlat_12mhz_counts;
+            EXPECT_NEAR(interval_12mhz_counts, capture_len_12mhz_counts, 12);
+        }
+    }
+}
+
+TEST(SoftwareDemodulator, ReplayCaptureLateDemodISR) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    // ISR runs well after the message ends, but before the next one starts.
+    const uint16_t kNumRepeats = 10;
+    SoftwareDemodulator demodulator =
+        SoftwareDemodulator({.sample_rate_hz = sample_rate_hz, .demod_isr_latency_us = 40});
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        demodulator.IngestMilliVolts(samples_mv.data(), samples_mv.size(), kCaptureTLMilliVolts);
+    }
+    EXPECT_EQ(demodulator.GetNumFramingErrors(), 0u);
+    ASSERT_EQ(demodulator.packets.size(), kNumRepeats);
+    // MLAT timestamps are latched at preamble match, so they shouldn't pick up the ISR latency.
+    uint64_t capture_len_12mhz_counts = samples_mv.size() * 12e6 / sample_rate_hz;
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        ExpectCapturePacket(demodulator.packets[i]);
+        if (i > 0) {
+            uint64_t interval_12mhz_counts =
+                demodulator.packets[i].mlat_12mhz_counts - demodulator.packets[i - 1].mlat_12mhz_counts;
+            EXPECT_NEAR(interval_12mhz_counts, capture_len_12mhz_counts, 12);
+        }
+    }
+}
+
+TEST(SoftwareDemodulator, ReplayCaptureDemodISRAfterNextMessageStarts) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    // ISR for each message runs after the other preamble detector has picked up the next message and the demodulator
+    // has started pushing its words.
+    const uint16_t kNumRepeats = 10;
+    const float kDemodISRLatencyUs = 180;
+    SoftwareDemodulator demodulator =
+        SoftwareDemodulator({.sample_rate_hz = sample_rate_hz, .demod_isr_latency_us = kDemodISRLatencyUs});
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        demodulator.IngestMilliVolts(samples_mv.data(), samples_mv.size(), kCaptureTLMilliVolts);
+    }
+    // Give the ISR for the last message time to run.
+    std::vector<float> quiet_mv(kDemodISRLatencyUs * sample_rate_hz / 1e6f, samples_mv[0]);
+    demodulator.IngestMilliVolts(quiet_mv.data(), quiet_mv.size(), kCaptureTLMilliVolts);
+
+    EXPECT_EQ(demodulator.GetNumFramingErrors(), 0u);
+    ASSERT_EQ(demodulator.packets.size(), kNumRepeats);
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        ExpectCapturePacket(demodulator.packets[i]);
+    }
+}
+
+TEST(SoftwareDemodulator, DISABLED_Benchmark) {
+    std::vector<float> samples_mv;
+    float sample_rate_hz;
+    ASSERT_TRUE(LoadRigolCSV(kCapturePath, samples_mv, sample_rate_hz));
+
+    const uint16_t kNumRepeats = 500;
+    std::vector<float> stream_mv;
+    for (uint16_t i = 0; i < kNumRepeats; i++) {
+        stream_mv.insert(stream_mv.end(), samples_mv.begin(), samples_mv.end());
+    }
+
+    SoftwareDemodulator demodulator = SoftwareDemodulator({.sample_rate_hz = sample_rate_hz});
+    float elapsed_ns = benchmark_ns(
+        [&]() { demodulator.IngestMilliVolts(stream_mv.data(), stream_mv.size(), kCaptureTLMilliVolts); });
+
+    EXPECT_EQ(demodulator.packets.size(), kNumRepeats);
+    float elapsed_s = elapsed_ns / 1e9f;
+    printf("Software demodulator: %.1f Msamples/s, %.0f frames/s (%.1fx real time).\r\n",
+           stream_mv.size() / elapsed_s / 1e6f, demodulator.GetNumFrames() / elapsed_s,
+           stream_mv.size() / sample_rate_hz / elapsed_s);
+}
@@ -32,7 +32,9 @@ TEST(SPICoprocessor, CreateAircraftListPacket) {
     aircraft_list[99].icao_address = 0xBEEF;
     uint16_t num_aircraft = 100;
     SPICoprocessor::AircraftListPacket packet = SPICoprocessor::AircraftListPacket(num_aircraft, aircraft_list);
-    EXPECT_TRUE(packet.IsValid(sizeof(SPICoprocessor::AircraftListPacket)));
+    EXPECT_EQ(packet.length, sizeof(SPICoprocessor::AircraftListPacket) -
+                                 (AircraftDictionary::kMaxNumAircraft - num_aircraft) * sizeof(Aircraft));
+    EXPECT_TRUE(packet.IsValid(SPICoprocessor::AircraftListPacket::GetLength(num_aircraft)));
     EXPECT_EQ(aircraft_list[0].icao_address, packet.aircraft_list[0].icao_address);
     EXPECT_EQ(aircraft_list[1].heading_deg, packet.aircraft_list[1].heading_deg);
     EXPECT_EQ(aircraft_list[99].icao_address, packet.aircraft_list[99].icao_address);
@@ -40,5 +42,21 @@ TEST(SPICoprocessor, CreateAircraftListPacket) {
     EXPECT_EQ(packet.type, SPICoprocessor::kSCPacketTypeAircraftList);
 
     packet.aircraft_list[0].icao_address = 0;  // Corrupt the packet.
-    EXPECT_FALSE(packet.IsValid(sizeof(SPICoprocessor::AircraftListPacket)));
-}
\ No newline at end of file
+    EXPECT_FALSE(packet.IsValid(SPICoprocessor::AircraftListPacket::GetLength(num_aircraft)));
+}
+
+TEST(SPICoprocessor, CreatePipelineStatsPacket) {
+    PipelineStats stats = {.timestamp_ms = 1000, .num_preambles_matched = 500, .num_crc_passed = 200};
+    stats.num_reported_bytes[SettingsManager::kBeast] = 12345;
+
+    SPICoprocessor::PipelineStatsPacket packet = SPICoprocessor::PipelineStatsPacket(stats);
+    EXPECT_TRUE(packet.IsValid(sizeof(SPICoprocessor::PipelineStatsPacket)));
+    EXPECT_EQ(packet.stats.timestamp_ms, 1000u);
+    EXPECT_EQ(packet.stats.num_preambles_matched, 500u);
+    EXPECT_EQ(packet.stats.num_crc_passed, 200u);
+    EXPECT_EQ(packet.stats.num_reported_bytes[SettingsManager::kBeast], 12345u);
+    EXPECT_EQ(packet.type, SPICoprocessor::kSCPacketTypePipelineStats);
+
+    packet.stats.num_crc_failed = 1;  // Corrupt the packet.
+    EXPECT_FALSE(packet.IsValid(sizeof(SPICoprocessor::PipelineStatsPacket)));
+}
@@ -0,0 +1,206 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "macros.hh"
+#include "tl_auto_tuner.hh"
+
+/**
+ * Stand-in for a receiver site. Valid packets per second peak at an optimal TL and fall off on either side: too high
+ * and weak aircraft drop out, too low and noise swamps the preamble detector. Noise preambles climb exponentially as
+ * the TL approaches the noise floor.
+ */
+struct SimulatedSite {
+    int optimal_tl_mv = 600;
+    int tl_tolerance_mv = 300;  // Distance from the optimal TL at which valid packets drop to zero.
+    int noise_floor_tl_mv = 400;
+    float peak_valid_packets_per_second = 100.0f;
+    float traffic_jitter_percent = 0.0f;  // Random variation in traffic from window to window.
+
+    uint32_t num_preambles = 0;
+    uint32_t num_valid_packets = 0;
+
+    float ValidPacketsPerSecond(int tl_lo_mv) {
+        float offset = static_cast<float>(tl_lo_mv - optimal_tl_mv) / tl_tolerance_mv;
+        float valid_packets_per_second = MAX(peak_valid_packets_per_second * (1.0f - offset * offset), 0.0f);
+        if (tl_lo_mv < noise_floor_tl_mv) {
+            valid_packets_per_second *= MAX(1.0f - (noise_floor_tl_mv - tl_lo_mv) / 100.0f, 0.0f);
+        }
+        return valid_packets_per_second;
+    }
+
+    void Run(int tl_lo_mv, uint32_t duration_ms) {
+        float valid_packets_per_second = ValidPacketsPerSecond(tl_lo_mv);
+        if (traffic_jitter_percent > 0) {
+            float jitter = (rand() % 2001 - 1000) / 1000.0f * traffic_jitter_percent / 100.0f;
+            valid_packets_per_second *= 1.0f + jitter;
+        }
+        float noise_preambles_per_second = 1000.0f * expf((noise_floor_tl_mv - tl_lo_mv) / 25.0f);
+        num_valid_packets += valid_packets_per_second * duration_ms / 1000;
+        num_preambles += (valid_packets_per_second * 1.2f + noise_preambles_per_second) * duration_ms / 1000;
+    }
+};
+
+const uint32_t kWindowMs = 5000;
+const uint32_t kUpdateIntervalMs = 100;
+
+/**
+ * Runs the tuner against a simulated site.
+ * @param[in] tuner Tuner to run.
+ * @param[in] site Site to run against.
+ * @param[in] timestamp_ms Time to start at, updated to the time that the run finished.
+ * @param[in] num_windows Number of tuning windows to run for.
+ * @param[out] max_step_mv Largest TL step taken.
+ * @retval Number of TL changes.
+ */
+uint16_t run_tuner(TLAutoTuner &tuner, SimulatedSite &site, uint32_t &timestamp_ms, uint16_t num_windows,
+                   int &max_step_mv) {
+    uint16_t num_changes = 0;
+    for (uint32_t i = 0; i < num_windows * kWindowMs / kUpdateIntervalMs; i++) {
+        int tl_lo_mv = tuner.GetTLLoMilliVolts();
+        site.Run(tl_lo_mv, kUpdateIntervalMs);
+        timestamp_ms += kUpdateIntervalMs;
+        if (tuner.Update(timestamp_ms, site.num_preambles, site.num_valid_packets)) {
+            num_changes++;
+            max_step_mv = MAX(max_step_mv, abs(tuner.GetTLLoMilliVolts() - tl_lo_mv));
+        }
+    }
+    return num_changes;
+}
+
+TEST(TLAutoTuner, ConvergesToBestTL) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    uint32_t timestamp_ms = 0;
+    tuner.Reset(timestamp_ms, 200, 400, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 100, max_step_mv);
+    // Close enough to the best TL that the slope is lost in the hysteresis band.
+    EXPECT_GE(site.ValidPacketsPerSecond(tuner.GetTLLoMilliVolts()), 0.85f * site.peak_valid_packets_per_second);
+    // Spacing between LO and HI TLs is kept.
+    EXPECT_EQ(tuner.GetTLHiMilliVolts() - tuner.GetTLLoMilliVolts(), 200);
+    EXPECT_LE(max_step_mv, 40);
+}
+
+TEST(TLAutoTuner, ConvergesFromAbove) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    uint32_t timestamp_ms = 0;
+    // Too high to hear anything at all.
+    tuner.Reset(timestamp_ms, 1500, 1700, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 100, max_step_mv);
+    EXPECT_GE(site.ValidPacketsPerSecond(tuner.GetTLLoMilliVolts()), 0.85f * site.peak_valid_packets_per_second);
+    EXPECT_LE(max_step_mv, 40);
+}
+
+TEST(TLAutoTuner, FollowsDrift) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    uint32_t timestamp_ms = 0;
+    tuner.Reset(timestamp_ms, 600, 800, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 20, max_step_mv);
+    // Noise floor and best TL creep up, like a site warming up in the afternoon.
+    for (uint16_t i = 0; i < 10; i++) {
+        site.optimal_tl_mv += 30;
+        site.noise_floor_tl_mv += 30;
+        run_tuner(tuner, site, timestamp_ms, 20, max_step_mv);
+    }
+    EXPECT_GE(site.ValidPacketsPerSecond(tuner.GetTLLoMilliVolts()), 0.85f * site.peak_valid_packets_per_second);
+}
+
+TEST(TLAutoTuner, HysteresisHoldsStill) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs, .probe_interval_windows = 12});
+    SimulatedSite site;
+    site.traffic_jitter_percent = 5;  // Well inside the hysteresis band.
+    srand(1);
+    uint32_t timestamp_ms = 0;
+    tuner.Reset(timestamp_ms, 600, 800, site.num_preambles, site.num_valid_packets);
+
+    // Let the tuner settle, then count how often it moves.
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 50, max_step_mv);
+    max_step_mv = 0;
+    uint16_t num_changes = run_tuner(tuner, site, timestamp_ms, 120, max_step_mv);
+    // Only the occasional probe and a step back, no dithering every window.
+    EXPECT_LE(num_changes, 120 / 12 * 2 + 2);
+    EXPECT_GE(site.ValidPacketsPerSecond(tuner.GetTLLoMilliVolts()), 0.85f * site.peak_valid_packets_per_second);
+}
+
+TEST(TLAutoTuner, BacksOffFromNoise) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs, .max_step_mv = 40});
+    SimulatedSite site;
+    site.peak_valid_packets_per_second = 5.0f;  // Quiet site, so the noise rule kicks in before the valid rate rule.
+    uint32_t timestamp_ms = 0;
+    tuner.Reset(timestamp_ms, 100, 300, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 1, max_step_mv);
+    EXPECT_EQ(tuner.GetTLLoMilliVolts(), 140);
+    run_tuner(tuner, site, timestamp_ms, 10, max_step_mv);
+    EXPECT_GE(tuner.GetTLLoMilliVolts(), site.noise_floor_tl_mv - 40);
+    EXPECT_LE(max_step_mv, 40);
+}
+
+TEST(TLAutoTuner, HoldsWithoutTraffic) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    site.peak_valid_packets_per_second = 0.0f;
+    uint32_t timestamp_ms = 0;
+    // Close enough to the noise floor to hear a few noise preambles.
+    tuner.Reset(timestamp_ms, 500, 700, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    EXPECT_EQ(run_tuner(tuner, site, timestamp_ms, 20, max_step_mv), 0);
+    EXPECT_EQ(tuner.GetTLLoMilliVolts(), 500);
+}
+
+TEST(TLAutoTuner, SettlesAboveNoiseWhenDeaf) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    site.peak_valid_packets_per_second = 0.0f;
+    uint32_t timestamp_ms = 0;
+    // Too high to hear any preambles, even noise.
+    tuner.Reset(timestamp_ms, 1000, 1200, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 50, max_step_mv);
+    EXPECT_GT(tuner.GetTLLoMilliVolts(), site.noise_floor_tl_mv);
+    EXPECT_LT(tuner.GetTLLoMilliVolts(), site.noise_floor_tl_mv + 150);
+    // Stays put once it can hear the noise.
+    EXPECT_EQ(run_tuner(tuner, site, timestamp_ms, 20, max_step_mv), 0);
+}
+
+TEST(TLAutoTuner, StaysInBounds) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs, .min_tl_mv = 500, .max_tl_mv = 900});
+    SimulatedSite site;
+    site.optimal_tl_mv = 1100;  // Best TL is out of bounds.
+    site.tl_tolerance_mv = 600;
+    uint32_t timestamp_ms = 0;
+    tuner.Reset(timestamp_ms, 600, 700, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    for (uint16_t i = 0; i < 50; i++) {
+        run_tuner(tuner, site, timestamp_ms, 1, max_step_mv);
+        EXPECT_GE(tuner.GetTLLoMilliVolts(), 500);
+        EXPECT_LE(tuner.GetTLHiMilliVolts(), 900);
+    }
+    EXPECT_GE(tuner.GetTLHiMilliVolts(), 850);
+}
+
+TEST(TLAutoTuner, CountersWrap) {
+    TLAutoTuner tuner = TLAutoTuner({.window_ms = kWindowMs});
+    SimulatedSite site;
+    site.num_preambles = UINT32_MAX - 100;
+    site.num_valid_packets = UINT32_MAX - 100;
+    uint32_t timestamp_ms = UINT32_MAX - kWindowMs / 2;
+    tuner.Reset(timestamp_ms, 200, 400, site.num_preambles, site.num_valid_packets);
+
+    int max_step_mv = 0;
+    run_tuner(tuner, site, timestamp_ms, 100, max_step_mv);
+    EXPECT_GE(site.ValidPacketsPerSecond(tuner.GetTLLoMilliVolts()), 0.85f * site.peak_valid_packets_per_second);
+}
@@ -0,0 +1,147 @@
+#include "benchmark.hh"
+#include "gtest/gtest.h"
+#include "transponder_packet_batch.hh"
+
+/**
+ * Builds a raw packet with random contents, a given downlink format, and a correct parity field (before any overlaid
+ * ICAO address or interrogator ID).
+ */
+static RawTransponderPacket make_random_raw_packet(uint16_t downlink_format, uint16_t packet_len_bits) {
+    RawTransponderPacket raw_packet;
+    raw_packet.buffer_len_bits = packet_len_bits;
+    for (uint16_t i = 0; i < RawTransponderPacket::kMaxPacketLenWords32; i++) {
+        raw_packet.buffer[i] = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+    }
+    raw_packet.buffer[0] = (raw_packet.buffer[0] & 0x07FFFFFF) | (downlink_format << 27);
+    uint32_t crc = crc24(raw_packet.buffer, packet_len_bits - 24);
+    if (packet_len_bits == 112) {
+        raw_packet.buffer[2] = (raw_packet.buffer[2] & 0xFFFFFF00) | (crc >> 16);
+        raw_packet.buffer[3] = (crc & 0xFFFF) << 16;
+    } else {
+        raw_packet.buffer[1] = crc << 8;
+        raw_packet.buffer[2] = 0;
+        raw_packet.buffer[3] = 0;
+    }
+    return raw_packet;
+}
+
+/**
+ * Fills a batch of raw packets covering every downlink format, both lengths, bit errors, overlaid addresses, and
+ * precalculated CRCs.
+ */
+static void fill_mixed_raw_packets(RawTransponderPacket raw_packets[], uint16_t num_packets) {
+    const uint16_t kDownlinkFormats[] = {0, 4, 5, 11, 16, 17, 18, 19, 20, 21, 24, 3};
+    const uint16_t kNumDownlinkFormats = sizeof(kDownlinkFormats) / sizeof(kDownlinkFormats[0]);
+    for (uint16_t i = 0; i < num_packets; i++) {
+        uint16_t downlink_format = kDownlinkFormats[rand() % kNumDownlinkFormats];
+        uint16_t packet_len_bits = (downlink_format >= 16 || rand() % 4 == 0) ? 112 : 56;
+        raw_packets[i] = make_random_raw_packet(downlink_format, packet_len_bits);
+        switch (rand() % 6) {
+            case 0:
+                // Flip a random bit after the downlink format.
+                raw_packets[i].buffer[0] ^= 1 << (rand() % 27);
+                break;
+            case 1:
+                // Overlay a random ICAO address or interrogator ID on the parity field.
+                raw_packets[i].buffer[packet_len_bits == 112 ? 3 : 1] ^= (rand() & 0xFF) << 16;
+                break;
+            case 2:
+                raw_packets[i].crc = crc24(raw_packets[i].buffer, packet_len_bits - 24);
+                raw_packets[i].flags |= RawTransponderPacket::kFlagCRCCalculated;
+                break;
+            case 3:
+                raw_packets[i].buffer_len_bits = rand() % 2 ? 32 : 0;  // Truncated packet.
+                break;
+            default:
+                break;  // Leave the packet clean.
+        }
+    }
+}
+
+TEST(TransponderPacketBatch, MatchesTransponderPacket) {
+    const uint16_t kNumPackets = 1003;  // Not a multiple of the number of lanes.
+    static RawTransponderPacket raw_packets[kNumPackets];
+    srand(0);
+    fill_mixed_raw_packets(raw_packets, kNumPackets);
+
+    static bool is_valid[kNumPackets];
+    static uint16_t downlink_format[kNumPackets];
+    static uint32_t icao_address[kNumPackets];
+    static uint16_t typecode[kNumPackets];
+    TransponderPacketBatch batch = {
+        .is_valid = is_valid, .downlink_format = downlink_format, .icao_address = icao_address, .typecode = typecode};
+    uint16_t num_valid_packets = decode_transponder_packet_batch(raw_packets, kNumPackets, batch);
+
+    uint16_t expected_num_valid_packets = 0;
+    uint16_t num_corrected_packets = 0;
+    for (uint16_t i = 0; i < kNumPackets; i++) {
+        TransponderPacket packet = TransponderPacket(raw_packets[i]);
+        EXPECT_EQ(is_valid[i], packet.IsValid()) << "packet " << i;
+        EXPECT_EQ(downlink_format[i], packet.GetDownlinkFormat()) << "packet " << i;
+        EXPECT_EQ(icao_address[i], packet.GetICAOAddress()) << "packet " << i;
+        ADSBPacket adsb_packet = ADSBPacket(packet);
+        bool is_adsb = adsb_packet.IsValid() && (packet.GetDownlinkFormat() == 17 || packet.GetDownlinkFormat() == 18);
+        EXPECT_EQ(typecode[i], is_adsb ? adsb_packet.GetTypeCode() : 0) << "packet " << i;
+        expected_num_valid_packets += packet.IsValid();
+        num_corrected_packets += packet.GetNumCorrectedBits() > 0;
+    }
+    EXPECT_EQ(num_valid_packets, expected_num_valid_packets);
+    EXPECT_GT(num_corrected_packets, 0);  // Make sure the error correction path got exercised.
+}
+
+TEST(TransponderPacketBatch, OptionalOutputs) {
+    RawTransponderPacket raw_packets[2];
+    srand(1);
+    raw_packets[0] = make_random_raw_packet(17, 112);
+    raw_packets[1] = make_random_raw_packet(11, 56);
+
+    // Only ask for ICAO addresses.
+    uint32_t icao_address[2] = {0};
+    TransponderPacketBatch batch = {.icao_address = icao_address};
+    EXPECT_EQ(decode_transponder_packet_batch(raw_packets, 2, batch), 2);
+    EXPECT_EQ(icao_address[0], raw_packets[0].buffer[0] & 0xFFFFFF);
+    EXPECT_EQ(icao_address[1], raw_packets[1].buffer[0] & 0xFFFFFF);
+
+    EXPECT_EQ(decode_transponder_packet_batch(raw_packets, 0, batch), 0);
+}
+
+TEST(TransponderPacketBatch, DISABLED_Benchmark) {
+    const uint16_t kNumPackets = 1000;
+    const uint16_t kNumPasses = 20;
+    static RawTransponderPacket raw_packets[kNumPackets];
+    srand(2);
+    for (uint16_t i = 0; i < kNumPackets; i++) {
+        raw_packets[i] = make_random_raw_packet(17, 112);
+    }
+
+    static bool is_valid[kNumPackets];
+    static uint16_t downlink_format[kNumPackets];
+    static uint32_t icao_address[kNumPackets];
+    static uint16_t typecode[kNumPackets];
+
+    float single_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            for (uint16_t i = 0; i < kNumPackets; i++) {
+                TransponderPacket packet = TransponderPacket(raw_packets[i]);
+                is_valid[i] = packet.IsValid();
+                downlink_format[i] = packet.GetDownlinkFormat();
+                icao_address[i] = packet.GetICAOAddress();
+                typecode[i] = ADSBPacket(packet).GetTypeCode();
+            }
+        }
+    });
+
+    TransponderPacketBatch batch = {
+        .is_valid = is_valid, .downlink_format = downlink_format, .icao_address = icao_address, .typecode = typecode};
+    uint32_t num_valid_packets = 0;
+    float batch_ns = benchmark_ns([&]() {
+        for (uint16_t pass = 0; pass < kNumPasses; pass++) {
+            num_valid_packets += decode_transponder_packet_batch(raw_packets, kNumPackets, batch);
+        }
+    });
+
+    EXPECT_EQ(num_valid_packets, kNumPackets * kNumPasses);
+    float num_decodes = kNumPackets * kNumPasses;
+    printf("Packet header decode: one at a time %.1f ns/packet, batched %.1f ns/packet.\r\n", single_ns / num_decodes,
+           batch_ns / num_decodes);
+}
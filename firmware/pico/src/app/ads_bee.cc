@@ -1,17 +1,15 @@
 #include "ads_bee.hh"
 
-#include <hardware/structs/systick.h>
 #include <stdio.h>  // for printing
 
 #include "hardware/adc.h"
 #include "hardware/clocks.h"
-#include "hardware/exception.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
 #include "hardware/pwm.h"
 #include "pico/stdlib.h"
 #include "pico/time.h"
-// #include "hardware/dma.h"
+#include "hardware/dma.h"
 #include "capture.pio.h"
 #include "hal.hh"
 #include "hardware/irq.h"
@@ -29,23 +27,49 @@ const float kPreambleDetectorFreq = 16e6;  // Running at 16MHz (8 clock cycles p
 const uint8_t kRxGainDigipotI2CAddr = 0b0101111;  // MCP4017-104e
 const uint32_t kRxgainDigipotOhmsPerCount = 100e3 / 127;
 
+// Transfer count for the demod FIFO drain DMA channel. Lives in memory so that the control channel can copy it into the
+// drain channel's trigger register to restart it.
+const uint32_t kDemodDMATransferCount = UINT32_MAX;
+// Words that may have landed in the demod ring buffer since the last DEMOD ISR without being counted yet.
+const uint16_t kDemodRingOverrunMarginWords = 2 * TransponderPacket::kMaxPacketLenWords32;
+// Transfer count for the ADC FIFO drain DMA channel, restarted by its control channel the same way as the demod drain.
+const uint32_t kADCDMATransferCount = UINT32_MAX;
+// The on-chip temperature sensor pads the ADC round robin out to a power of 2 inputs so that frames line up with the
+// ring buffer wrap.
+const uint16_t kADCTempSensorInput = 4;
+// Number of round robin frames to look back through for the RSSI peak from the end of a message. Each frame is 8us, so
+// this covers the tail end of the shortest message even if the peak detector starts to clear as soon as it ends.
+const uint16_t kRSSINumFramesToCheck = 4;
+const uint16_t kADCFramePeriodUs = 8;  // 4 inputs at 500ksps.
+const uint16_t kPreambleLenUs = 8;
+// Preamble detector state machines. Must be 2 apart, since they pass a token using relative IRQ flags.
+const uint kPreambleDetectorSMs[ADSBee::kNumPreambleDetectors] = {0, 2};
+// Shortest time from a preamble match until the preamble detector gives up the DEMOD pin: 8us preamble, 56us message,
+// 2.5us of idle.
+const uint32_t kMinDemodIntervalUs = 67;
+
 ADSBee *isr_access = nullptr;
 
 void on_demod_complete() { isr_access->OnDemodComplete(); }
 
-void on_systick_exception() { isr_access->OnSysTickWrap(); }
-
-void gpio_irq_isr(uint gpio, uint32_t event_mask) { isr_access->GPIOIRQISR(gpio, event_mask); }
-
 ADSBee::ADSBee(ADSBeeConfig config_in) {
     config_ = config_in;
+    tl_auto_tuner_ = TLAutoTuner(config_.tl_auto_tuner_config);
 
-    preamble_detector_sm_ = pio_claim_unused_sm(config_.preamble_detector_pio, true);
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        preamble_detector_sms_[i] = kPreambleDetectorSMs[i];
+        pio_sm_claim(config_.preamble_detector_pio, preamble_detector_sms_[i]);
+    }
     preamble_detector_offset_ = pio_add_program(config_.preamble_detector_pio, &preamble_detector_program);
 
+    mlat_counter_sm_ = pio_claim_unused_sm(config_.preamble_detector_pio, true);
+    mlat_counter_offset_ = pio_add_program(config_.preamble_detector_pio, &mlat_counter_program);
+
     message_demodulator_sm_ = pio_claim_unused_sm(config_.message_demodulator_pio, true);
     message_demodulator_offset_ = pio_add_program(config_.message_demodulator_pio, &message_demodulator_program);
 
+    mutex_init(&aircraft_dictionary_mutex);
+
     // Put IRQ parameters into the global scope for the on_demod_complete ISR.
     isr_access = this;
 
@@ -73,6 +97,53 @@ bool ADSBee::Init() {
     adc_gpio_init(config_.tl_lo_adc_pin);
     adc_gpio_init(config_.tl_hi_adc_pin);
     adc_gpio_init(config_.rssi_hold_adc_pin);
+    adc_set_temp_sensor_enabled(true);
+
+    /** ADC DMA **/
+    // Run the ADC free running in round robin across the TL and RSSI inputs, with DMA draining every sample into a ring
+    // buffer. Nothing ever waits on a conversion: readers just grab the most recent sample of the input they want.
+    uint16_t adc_round_robin_mask = (1 << config_.tl_hi_adc_input) | (1 << config_.tl_lo_adc_input) |
+                                    (1 << config_.rssi_hold_adc_input) | (1 << kADCTempSensorInput);
+    if (__builtin_popcount(adc_round_robin_mask) != kADCNumRoundRobinInputs) {
+        CONSOLE_ERROR("ADSBee::Init: ADC inputs must be distinct, got mask 0x%x.", adc_round_robin_mask);
+        return false;
+    }
+    // Round robin walks the mask from the lowest input up, so an input's slot in each frame is the number of inputs
+    // below it.
+    tl_hi_adc_slot_ = __builtin_popcount(adc_round_robin_mask & ((1 << config_.tl_hi_adc_input) - 1));
+    tl_lo_adc_slot_ = __builtin_popcount(adc_round_robin_mask & ((1 << config_.tl_lo_adc_input) - 1));
+    rssi_adc_slot_ = __builtin_popcount(adc_round_robin_mask & ((1 << config_.rssi_hold_adc_input) - 1));
+    adc_select_input(__builtin_ctz(adc_round_robin_mask));  // Start the first frame on the lowest input.
+    adc_set_round_robin(adc_round_robin_mask);
+    adc_fifo_setup(true,    // Write each conversion to the FIFO.
+                   true,    // Assert DREQ when there's a sample in the FIFO.
+                   1,       // DREQ threshold.
+                   false,   // No error bit, so samples are plain 12-bit values.
+                   false);  // Keep full 16-bit samples.
+    adc_set_clkdiv(0);      // Convert back to back (500ksps, 125ksps per input).
+
+    adc_dma_chan_ = dma_claim_unused_channel(true);
+    adc_dma_ctrl_chan_ = dma_claim_unused_channel(true);
+
+    dma_channel_config adc_dma_config = dma_channel_get_default_config(adc_dma_chan_);
+    channel_config_set_transfer_data_size(&adc_dma_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&adc_dma_config, false);
+    channel_config_set_write_increment(&adc_dma_config, true);
+    channel_config_set_ring(&adc_dma_config, true, kADCRingBufferSizeBits);  // Wrap the write address.
+    channel_config_set_dreq(&adc_dma_config, DREQ_ADC);
+    channel_config_set_chain_to(&adc_dma_config, adc_dma_ctrl_chan_);
+    dma_channel_configure(adc_dma_chan_, &adc_dma_config, adc_ring_buffer_, &adc_hw->fifo, kADCDMATransferCount,
+                          false);
+
+    dma_channel_config adc_dma_ctrl_config = dma_channel_get_default_config(adc_dma_ctrl_chan_);
+    channel_config_set_transfer_data_size(&adc_dma_ctrl_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&adc_dma_ctrl_config, false);
+    channel_config_set_write_increment(&adc_dma_ctrl_config, false);
+    dma_channel_configure(adc_dma_ctrl_chan_, &adc_dma_ctrl_config, &dma_hw->ch[adc_dma_chan_].al1_transfer_count_trig,
+                          &kADCDMATransferCount, 1, false);
+
+    dma_channel_start(adc_dma_chan_);
+    adc_run(true);
 
     // Initialize RSSI peak detector clear pin.
     gpio_init(config_.rssi_clear_pin);
@@ -90,35 +161,31 @@ bool ADSBee::Init() {
         return false;
     }
 
-    // Enable the MLAT timer using the 24-bit SysTick timer connected to the 12MHz external oscillator.
-    // SysTick Control and Status Register
-    systick_hw->csr = 0b010;  // Source = External Reference Clock, TickInt = Enabled, Counter = Disabled.
-    // SysTick Reload Value Register
-    systick_hw->rvr = 0xFFFFFF;  // Use the full 24 bit span of the timer value register.
-    // 0xFFFFFF = 16777215 counts @ 16MHz = approx. 1.398 seconds.
-    // Call the OnSysTickWrap function every time the SysTick timer hits 0.
-    exception_set_exclusive_handler(SYSTICK_EXCEPTION, on_systick_exception);
-    // Let the games begin!
-    systick_hw->csr |= 0b1;  // Enable the counter.
-
     // Calculate the PIO clock divider.
     float preamble_detector_div = (float)clock_get_hz(clk_sys) / kPreambleDetectorFreq;
 
-    // Initialize the program using the .pio file helper function
-    preamble_detector_program_init(config_.preamble_detector_pio, preamble_detector_sm_, preamble_detector_offset_,
-                                   config_.pulses_pin, config_.demod_out_pin, preamble_detector_div);
-
-    // Enable the DEMOD interrupt on PIO0_IRQ_0.
-    pio_set_irq0_source_enabled(config_.preamble_detector_pio, pis_interrupt0, true);  // state machine 0 IRQ 0
-
-    uint demod_in_irq = IO_IRQ_BANK0;
-
-    // Set GPIO interrupts to be higher priority than the DEMOD interrupt to allow RSSI measurement.
-    irq_set_priority(config_.preamble_detector_demod_irq, 1);
-    irq_set_priority(demod_in_irq, 0);
+    // Initialize the program using the .pio file helper function. Both preamble detectors share the DEMOD pin and take
+    // turns looking for preambles.
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        preamble_detector_program_init(config_.preamble_detector_pio, preamble_detector_sms_[i],
+                                       preamble_detector_offset_, config_.pulses_pin, config_.demod_out_pin,
+                                       preamble_detector_div);
+        // Enable the DEMOD interrupt on PIO0_IRQ_0. Each preamble detector raises the IRQ flag matching its state
+        // machine number.
+        pio_set_irq0_source_enabled(config_.preamble_detector_pio,
+                                    static_cast<pio_interrupt_source>(pis_interrupt0 + preamble_detector_sms_[i]),
+                                    true);
+    }
+    // Hand the first token to the first preamble detector (flag 4 rel is its own token).
+    pio_sm_exec(config_.preamble_detector_pio, preamble_detector_sms_[0], pio_encode_irq_set(true, 4));
+    next_preamble_detector_index_ = 0;
 
-    // Handle GPIO interrupts.
-    gpio_set_irq_enabled_with_callback(config_.demod_in_pin, GPIO_IRQ_EDGE_RISE, true, gpio_irq_isr);
+    /** MLAT COUNTER PIO **/
+    // Latches a free running counter into its RX FIFO when the preamble detector raises DEMOD, so that the timestamp
+    // is taken in hardware at preamble match instead of in an ISR.
+    mlat_counter_program_init(config_.preamble_detector_pio, mlat_counter_sm_, mlat_counter_offset_,
+                              config_.demod_in_pin);
+    mlat_counter_clk_sys_mhz_ = clock_get_hz(clk_sys) / 1e6;
 
     // Handle PIO0 IRQ0.
     irq_set_exclusive_handler(config_.preamble_detector_demod_irq, on_demod_complete);
@@ -131,13 +198,46 @@ bool ADSBee::Init() {
                                      message_demodulator_offset_, config_.pulses_pin, config_.recovered_clk_pin,
                                      message_demodulator_div);
 
+    /** MESSAGE DEMODULATOR DMA **/
+    // Drain the message demodulator RX FIFO into a ring buffer as soon as each word is pushed, so that the FIFO can't
+    // overflow and the DEMOD ISR doesn't need to touch it.
+    demod_dma_chan_ = dma_claim_unused_channel(true);
+    demod_dma_ctrl_chan_ = dma_claim_unused_channel(true);
+
+    dma_channel_config demod_dma_config = dma_channel_get_default_config(demod_dma_chan_);
+    channel_config_set_transfer_data_size(&demod_dma_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&demod_dma_config, false);
+    channel_config_set_write_increment(&demod_dma_config, true);
+    channel_config_set_ring(&demod_dma_config, true, kDemodRingBufferSizeBits);  // Wrap the write address.
+    channel_config_set_dreq(&demod_dma_config,
+                            pio_get_dreq(config_.message_demodulator_pio, message_demodulator_sm_, false));
+    channel_config_set_chain_to(&demod_dma_config, demod_dma_ctrl_chan_);
+    dma_channel_configure(demod_dma_chan_, &demod_dma_config, demod_ring_buffer_,
+                          &config_.message_demodulator_pio->rxf[message_demodulator_sm_], kDemodDMATransferCount,
+                          false);
+
+    // Restart the drain channel with a fresh transfer count when it finishes. Its write address carries on from where
+    // it left off in the ring.
+    dma_channel_config demod_dma_ctrl_config = dma_channel_get_default_config(demod_dma_ctrl_chan_);
+    channel_config_set_transfer_data_size(&demod_dma_ctrl_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&demod_dma_ctrl_config, false);
+    channel_config_set_write_increment(&demod_dma_ctrl_config, false);
+    dma_channel_configure(demod_dma_ctrl_chan_, &demod_dma_ctrl_config,
+                          &dma_hw->ch[demod_dma_chan_].al1_transfer_count_trig, &kDemodDMATransferCount, 1, false);
+
+    dma_channel_start(demod_dma_chan_);
+
     CONSOLE_INFO("ADSBee::Init: PIOs initialized.");
 
     gpio_init(config_.status_led_pin);
     gpio_set_dir(config_.status_led_pin, GPIO_OUT);
 
     // Enable the state machines
-    pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sm_, true);
+    mlat_counter_start_timestamp_us_ = time_us_64();
+    pio_sm_set_enabled(config_.preamble_detector_pio, mlat_counter_sm_, true);
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sms_[i], true);
+    }
     pio_sm_set_enabled(config_.message_demodulator_pio, message_demodulator_sm_, true);
 
     // Set the last dictionary update timestamp.
@@ -160,92 +260,149 @@ bool ADSBee::Update() {
         gpio_put(config_.status_led_pin, 0);
     }
 
+    // Walk the TLs towards the best valid packet rate.
+    if (tl_auto_tune_enabled_ && tl_auto_tuner_.Update(timestamp_ms, num_preambles_matched_, num_crc_passed_)) {
+        SetTLLoMilliVolts(tl_auto_tuner_.GetTLLoMilliVolts());
+        SetTLHiMilliVolts(tl_auto_tuner_.GetTLHiMilliVolts());
+        CONSOLE_INFO("ADSBee::Update: TL auto-tune at %.1f valid packets/s, set tl_lo_mv=%d tl_hi_mv=%d.",
+                     tl_auto_tuner_.GetValidFramesPerSecond(), tl_lo_mv_, tl_hi_mv_);
+    }
+
     // Update PWM output duty cycle.
     pwm_set_chan_level(tl_lo_pwm_slice_, tl_lo_pwm_chan_, tl_lo_pwm_count_);
     pwm_set_chan_level(tl_hi_pwm_slice_, tl_hi_pwm_chan_, tl_hi_pwm_count_);
 
-    // Prune aircraft dictionary.
-    if (last_aircraft_dictionary_update_timestamp_ms_ - timestamp_ms > config_.aircraft_dictionary_update_interval_ms) {
-        aircraft_dictionary.Update(timestamp_ms);
-    }
     return true;
 }
 
-void ADSBee::GPIOIRQISR(uint gpio, uint32_t event_mask) {
-    if (gpio == config_.demod_in_pin && event_mask == GPIO_IRQ_EDGE_RISE) {
-        gpio_acknowledge_irq(config_.demod_in_pin, GPIO_IRQ_EDGE_RISE);
-        // Demodulation period is beginning!
-        // Read the RSSI level of the last packet.
-        adc_select_input(config_.rssi_hold_adc_input);
-        last_message_rssi_adc_counts_ = adc_read();
-        // RSSI peak detector will automatically clear when DEMOD pin goes LO.
+bool ADSBee::UpdateDecoder() {
+    // Assemble demodulated messages from the DMA ring buffer. Each marker is published by the DEMOD ISR once the whole
+    // message is in the ring, so messages don't have to wait for the next one to arrive.
+    bool did_work = false;
+    DemodMessageMarker marker;
+    while (demod_message_marker_queue_.Pop(marker)) {
+        AssembleDemodMessage(marker);
+        did_work = true;
+    }
 
-        last_message_mlat_12mhz_counts_ = GetMLAT12MHzCounts();
+    // Prune aircraft dictionary.
+    uint32_t timestamp_ms = get_time_since_boot_ms();
+    if (timestamp_ms - last_aircraft_dictionary_update_timestamp_ms_ > config_.aircraft_dictionary_update_interval_ms) {
+        last_aircraft_dictionary_update_timestamp_ms_ = timestamp_ms;
+        mutex_enter_blocking(&aircraft_dictionary_mutex);
+        aircraft_dictionary.Update(timestamp_ms);
+        mutex_exit(&aircraft_dictionary_mutex);
     }
+    return did_work;
 }
 
 void ADSBee::OnDemodComplete() {
-    uint16_t word_index = 0;
-    while (!pio_sm_is_rx_fifo_empty(config_.message_demodulator_pio, message_demodulator_sm_)) {
-        uint32_t word = pio_sm_get(config_.message_demodulator_pio, message_demodulator_sm_);
-        // CONSOLE_PRINTF("\t%d: %08x\r\n", word_index, word);
-
-        switch (word_index) {
-            case 0: {
-                // Flush the previous word into a packet before beginning to store the new one.
-                // First word out of the FIFO is actually the last word of the previously demodulated message.
-                // Assemble a packet buffer using the items in rx_buffer_.
-                uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
-                for (uint16_t i = 0; i < last_demod_num_words_ingested_; i++) {
-                    packet_buffer[i] = rx_buffer_[i];
-                }
-                // Trim extra ingested bit off of last word, then left-align.
-                // packet_buffer[last_demod_num_words_ingested_] = (static_cast<uint16_t>(word >> 1)) << 16;
-                // Need to left-align by 16 bits for last word of 112-bit packet, 8 bits for last word of 56-bit
-                // packet.
-                if (last_demod_num_words_ingested_ == TransponderPacket::kExtendedSquitterPacketNumWords32 - 1) {
-                    // 112-bit packet: trim off extra bit, mask to 16 bits, left align.
-                    packet_buffer[last_demod_num_words_ingested_] = ((word >> 1) & 0xFFFF) << 16;
-                } else {
-                    // 56-bit packet: trim off extra bit, mask to 24 bits, left align.
-                    packet_buffer[last_demod_num_words_ingested_] = ((word >> 1) & 0xFFFFFF) << 8;
-                }
-                TransponderPacket packet = TransponderPacket(packet_buffer, last_demod_num_words_ingested_ + 1,
-                                                             GetLastMessageRSSIdBm(), GetLastMessageMLAT12MHzCounts());
-                transponder_packet_queue.Push(packet);
-                last_demod_num_words_ingested_ = 0;
-                break;
-            }
-            case 1:
-            case 2:
-            case 3:
-                rx_buffer_[word_index - 1] = word;
-                last_demod_num_words_ingested_ = word_index;
-                break;
-                // case 3:
-                //     // Last word ingests an extra bit by accident, pinch it off here.
-                //     rx_buffer_[word_index-1] = word>>1;
-
-                break;
-            default:
-                // Received too many bits for this to be a valid packet. Throw away extra bits!
-                // CONSOLE_PRINTF("tossing\r\n");
-                // Throw away extra bits.
-                break;
+    // The message has already been moved into the ring buffer by DMA. If this ISR ran late, the start of the next
+    // message may be there too. Count how many words have arrived, so that the search for the message stays within
+    // them.
+    uint16_t write_index = (dma_channel_hw_addr(demod_dma_chan_)->write_addr -
+                            reinterpret_cast<uint32_t>(demod_ring_buffer_)) /
+                           sizeof(uint32_t);
+    demod_ring_num_words_written_ += (write_index - demod_ring_last_write_index_) & (kDemodRingBufferNumWords - 1);
+    demod_ring_last_write_index_ = write_index;
+
+    // Find out which preamble detectors have finished a message. They take turns, so if both are done, the one that
+    // was expected next finished first, and the other can't have finished unless the first one did.
+    uint16_t finished_preamble_detector_indices[kNumPreambleDetectors];
+    uint16_t num_messages = 0;
+    for (uint16_t i = 0; i < kNumPreambleDetectors; i++) {
+        uint16_t index = (next_preamble_detector_index_ + i) % kNumPreambleDetectors;
+        if (!pio_interrupt_get(config_.preamble_detector_pio, preamble_detector_sms_[index])) {
+            break;
+        }
+        finished_preamble_detector_indices[num_messages++] = index;
+    }
+    num_preambles_matched_ += num_messages;
+
+    // The demodulator ends every message with an end-of-frame word holding its bit count, which is used to find where
+    // each finished message is in the ring.
+    DemodFrame frames[kNumPreambleDetectors];
+    uint16_t num_frames =
+        demod_find_frames(demod_ring_buffer_, kDemodRingBufferNumWords, demod_ring_last_message_end_word_count_,
+                          demod_ring_num_words_written_, num_messages, frames);
+    num_demod_framing_errors_ += num_messages - num_frames;
+    num_demods_completed_ += num_frames;
+
+    uint64_t timestamp_us = time_us_64() - mlat_counter_start_timestamp_us_;
+    for (uint16_t i = 0; i < num_messages; i++) {
+        // The MLAT counter latched its value at preamble match, once per message. The other preamble detector may
+        // already be partway into a new message, so only take the latches for messages that have finished.
+        if (pio_sm_is_rx_fifo_empty(config_.preamble_detector_pio, mlat_counter_sm_)) {
+            num_mlat_counter_misses_++;
+            last_message_mlat_12mhz_counts_ = 0;  // Unknown.
+        } else {
+            last_message_mlat_12mhz_counts_ = MLATCounterLatchToMLAT12MHzCounts(
+                pio_sm_get(config_.preamble_detector_pio, mlat_counter_sm_));
+        }
+        if (i < num_frames) {
+            last_message_rssi_adc_counts_ =
+                GetMessageRSSIADCCounts(last_message_mlat_12mhz_counts_, frames[i].num_bits, timestamp_us);
+            demod_message_marker_queue_.Push({.frame = frames[i],
+                                              .rssi_adc_counts = last_message_rssi_adc_counts_,
+                                              .mlat_12mhz_counts = last_message_mlat_12mhz_counts_});
+        }
+    }
+
+    if (num_messages == kNumPreambleDetectors) {
+        // Both preamble detectors have been parked waiting on this ISR since the second message ended, so nothing was
+        // listening for preambles. Estimate when that happened from the second message's preamble match, assuming
+        // it was as short as possible.
+        num_demod_blind_windows_++;
+        uint64_t blind_start_us = last_message_mlat_12mhz_counts_ / 12 + kMinDemodIntervalUs;
+        if (last_message_mlat_12mhz_counts_ != 0 && timestamp_us > blind_start_us) {
+            demod_blind_time_us_ += timestamp_us - blind_start_us;
         }
-        word_index++;
     }
 
     gpio_put(config_.rssi_clear_pin, 1);  // restore RSSI peak detector to working order.
-    pio_interrupt_clear(config_.preamble_detector_pio, 0);
+    // Release the preamble detectors in the order they finished, so that they pick the token back up in turn.
+    for (uint16_t i = 0; i < num_messages; i++) {
+        uint16_t index = finished_preamble_detector_indices[i];
+        pio_interrupt_clear(config_.preamble_detector_pio, preamble_detector_sms_[index]);
+    }
+    next_preamble_detector_index_ = (next_preamble_detector_index_ + num_messages) % kNumPreambleDetectors;
 }
 
-void ADSBee::OnSysTickWrap() { mlat_counter_1s_wraps_++; }
+void ADSBee::AssembleDemodMessage(const DemodMessageMarker &marker) {
+    if (demod_ring_num_words_written_ - marker.frame.start_word_count >=
+        kDemodRingBufferNumWords - kDemodRingOverrunMarginWords) {
+        // DMA has lapped the ring buffer and may have overwritten this message.
+        num_demod_ring_overruns_++;
+        return;
+    }
 
-uint64_t ADSBee::GetMLAT12MHzCounts() {
-    // Combine the wrap counter with the current value of the SysTick register and mask to 48 bits.
-    // Note: 24-bit SysTick value is subtracted from UINT_24_MAX to make it count up instead of down.
-    return (mlat_counter_1s_wraps_ << 24 | (0xFFFFFF - systick_hw->cvr)) & 0xFFFFFFFFFFFF;
+    RawTransponderPacket raw_packet;
+    if (!demod_frame_to_raw_packet(demod_ring_buffer_, kDemodRingBufferNumWords, marker.frame, raw_packet)) {
+        num_frames_too_short_++;
+        return;
+    }
+    if (raw_packet.buffer_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits) {
+        num_frames_112_bit_++;
+    } else {
+        num_frames_56_bit_++;
+    }
+    num_demod_words_ingested_ += (raw_packet.buffer_len_bits + kBitsPerWord - 1) / kBitsPerWord;
+    raw_packet.rssi_dbm = RSSIADCCountsTodBm(marker.rssi_adc_counts);
+    raw_packet.mlat_12mhz_counts = marker.mlat_12mhz_counts & RawTransponderPacket::kMLAT12MHzCountsMask;
+    transponder_packet_queue.Push(raw_packet);
+}
+
+uint64_t ADSBee::MLATCounterLatchToMLAT12MHzCounts(uint32_t mlat_counter_latch) {
+    // The PIO counter counts X down from 0 at half the system clock, and wraps every ~69 seconds at 125MHz. Find the
+    // full count by lining the latch up with an estimate from the 64-bit microsecond timer. Both are derived from the
+    // same crystal, so the estimate only drifts by the ISR latency, which is far less than half a wrap.
+    uint32_t latched_counts = 0u - mlat_counter_latch;
+    uint64_t elapsed_us = time_us_64() - mlat_counter_start_timestamp_us_;
+    uint64_t estimated_counts = elapsed_us * mlat_counter_clk_sys_mhz_ / kMLATCounterClkSysCyclesPerCount;
+    uint64_t counts = estimated_counts + static_cast<int32_t>(latched_counts - static_cast<uint32_t>(estimated_counts));
+    // Convert to the 12MHz Mode S Beast time base.
+    return (counts * kMLATCounterClkSysCyclesPerCount * 12 / mlat_counter_clk_sys_mhz_) &
+           RawTransponderPacket::kMLAT12MHzCountsMask;
 }
 
 bool ADSBee::SetTLHiMilliVolts(int tl_hi_mv) {
@@ -278,18 +435,46 @@ inline int adc_counts_to_mv(uint16_t adc_counts) { return 3300 * adc_counts / 0x
 
 int ADSBee::ReadTLHiMilliVolts() {
     // Read back the high level TL bias output voltage.
-    adc_select_input(config_.tl_hi_adc_input);
-    tl_hi_adc_counts_ = adc_read();
+    tl_hi_adc_counts_ = GetADCSample(tl_hi_adc_slot_);
     return adc_counts_to_mv(tl_hi_adc_counts_);
 }
 
 int ADSBee::ReadTLLoMilliVolts() {
     // Read back the low level TL bias output voltage.
-    adc_select_input(config_.tl_lo_adc_input);
-    tl_lo_adc_counts_ = adc_read();
+    tl_lo_adc_counts_ = GetADCSample(tl_lo_adc_slot_);
     return adc_counts_to_mv(tl_lo_adc_counts_);
 }
 
+uint16_t ADSBee::GetMessageRSSIADCCounts(uint64_t mlat_12mhz_counts, uint32_t num_bits, uint64_t timestamp_us) {
+    // The RSSI peak detector holds the message's peak power level while DEMOD is HI and clears when it goes LO, and the
+    // free running ADC has been sampling it. Start from the frame where this message ended, so that when both preamble
+    // detectors finished before the ISR ran, the first message doesn't get the second one's power level.
+    uint16_t num_frames_back = 0;
+    if (mlat_12mhz_counts != 0) {
+        uint64_t end_us = mlat_12mhz_counts / 12 + kPreambleLenUs + num_bits;  // 1 bit per us.
+        if (timestamp_us > end_us) {
+            // Stay clear of the frame that the ADC is writing at the far end of the ring.
+            num_frames_back = MIN((timestamp_us - end_us) / kADCFramePeriodUs,
+                                  kADCRingBufferNumSamples / kADCNumRoundRobinInputs - 1 - kRSSINumFramesToCheck);
+        }
+    }
+    uint16_t rssi_adc_counts = 0;
+    for (uint16_t i = 0; i < kRSSINumFramesToCheck; i++) {
+        rssi_adc_counts = MAX(rssi_adc_counts, GetADCSample(rssi_adc_slot_, num_frames_back + i));
+    }
+    return rssi_adc_counts;
+}
+
+uint16_t ADSBee::GetADCSample(uint16_t slot, uint16_t num_frames_back) {
+    uint16_t write_index =
+        (dma_channel_hw_addr(adc_dma_chan_)->write_addr - reinterpret_cast<uint32_t>(adc_ring_buffer_)) /
+        sizeof(uint16_t);
+    // Back up to the start of the last complete frame, since the current frame may only be partially written.
+    uint16_t frame_start_index = (write_index & ~(kADCNumRoundRobinInputs - 1)) -
+                                 kADCNumRoundRobinInputs * (num_frames_back + 1);
+    return adc_ring_buffer_[(frame_start_index + slot) & (kADCRingBufferNumSamples - 1)];
+}
+
 bool ADSBee::SetRxGain(int rx_gain) {
     rx_gain_ = rx_gain;
     uint32_t rx_gain_digipot_resistance_ohms = (rx_gain_ - 1) * 1e3;  // Non-inverting amp with R1 = 1kOhms.
@@ -303,6 +488,37 @@ int ADSBee::ReadRxGain() {
     return wiper_value_counts * kRxgainDigipotOhmsPerCount / 1e3 + 1;  // Non-inverting amp with R1 = 1kOhms.
 }
 
+void ADSBee::SetTLAutoTuneEnabled(bool is_enabled) {
+    if (is_enabled) {
+        // Start over from the current TLs, in case they were set from somewhere else.
+        tl_auto_tuner_.Reset(get_time_since_boot_ms(), tl_lo_mv_, tl_hi_mv_, num_preambles_matched_, num_crc_passed_);
+    }
+    tl_auto_tune_enabled_ = is_enabled;
+}
+
+void ADSBee::GetPipelineStats(PipelineStats &stats) {
+    stats.timestamp_ms = get_time_since_boot_ms();
+
+    stats.num_preambles_matched = num_preambles_matched_;
+    stats.num_demods_completed = num_demods_completed_;
+    stats.num_demod_framing_errors = num_demod_framing_errors_;
+
+    stats.num_demod_ring_overruns = num_demod_ring_overruns_;
+    stats.num_demod_words_ingested = num_demod_words_ingested_;
+    stats.num_frames_too_short = num_frames_too_short_;
+    stats.num_frames_56_bit = num_frames_56_bit_;
+    stats.num_frames_112_bit = num_frames_112_bit_;
+
+    stats.num_crc_passed = num_crc_passed_;
+    stats.num_crc_failed = num_crc_failed_;
+    stats.num_crc_corrected = num_crc_corrected_;
+    // Single word read, no need to take the aircraft dictionary mutex.
+    stats.num_dictionary_evictions = aircraft_dictionary.GetNumEvictions();
+
+    stats.num_demod_marker_queue_drops = demod_message_marker_queue_.GetNumOverflows();
+    stats.num_transponder_packet_queue_drops = transponder_packet_queue.GetNumOverflows();
+}
+
 void ADSBee::FlashStatusLED(uint32_t led_on_ms) {
     gpio_put(config_.status_led_pin, 1);
     led_off_timestamp_ms_ = get_time_since_boot_ms() + kStatusLEDOnMs;
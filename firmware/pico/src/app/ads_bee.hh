@@ -4,12 +4,16 @@
 #include "adsb_packet.hh"
 #include "aircraft_dictionary.hh"
 #include "cpp_at.hh"
-#include "data_structures.hh"  // For PFBQueue.
+#include "data_structures.hh"  // For SPSCQueue.
+#include "demod_frame.hh"
 #include "hardware/i2c.h"
 #include "hardware/pio.h"
 #include "macros.hh"  // For MAX / MIN.
+#include "pico/mutex.h"
+#include "pipeline_stats.hh"
 #include "settings.hh"
 #include "stdint.h"
+#include "tl_auto_tuner.hh"
 
 class ADSBee {
    public:
@@ -17,9 +21,21 @@ class ADSBee {
     static constexpr int kVDDMV = 3300;               // [mV] Voltage of positive supply rail.
     static constexpr int kTLMaxMV = 3300;             // [mV]
     static constexpr int kTLMinMV = 0;                // [mV]
-    static constexpr uint16_t kMaxNumTransponderPackets =
-        100;  // Defines size of ADSBPacket circular buffer (PFBQueue).
+    // Defines size of the transponder packet queues (SPSCQueue). Must be a power of 2.
+    static constexpr uint16_t kMaxNumTransponderPackets = 128;
+    // Ring buffer that the message demodulator FIFO is drained into via DMA. Needs to be aligned to its own size in
+    // bytes for the DMA ring wrap to work.
+    static constexpr uint16_t kDemodRingBufferSizeBits = 12;  // log2 of ring buffer size in bytes (4kB).
+    static constexpr uint16_t kDemodRingBufferNumWords = (1 << kDemodRingBufferSizeBits) / sizeof(uint32_t);
+    // Ring buffer that the free running ADC is drained into via DMA. Each frame holds one sample from each of the round
+    // robin inputs. Also needs to be aligned to its own size in bytes.
+    static constexpr uint16_t kADCNumRoundRobinInputs = 4;  // Must be a power of 2.
+    static constexpr uint16_t kADCRingBufferSizeBits = 7;   // log2 of ring buffer size in bytes (16 frames).
+    static constexpr uint16_t kADCRingBufferNumSamples = (1 << kADCRingBufferSizeBits) / sizeof(uint16_t);
     static const uint32_t kStatusLEDOnMs = 10;
+    // Preamble detectors that take turns, so that one can look for the next preamble while the DEMOD ISR for the
+    // previous message is pending.
+    static constexpr uint16_t kNumPreambleDetectors = 2;
 
     struct ADSBeeConfig {
         PIO preamble_detector_pio = pio0;
@@ -55,12 +71,25 @@ class ADSBee {
         uint16_t uart_rx_pin = 5;
 
         uint32_t aircraft_dictionary_update_interval_ms = 1000;
+
+        TLAutoTuner::TLAutoTunerConfig tl_auto_tuner_config;
     };
 
     ADSBee(ADSBeeConfig config_in);
     bool Init();
+
+    /**
+     * Housekeeping for the receiver hardware (status LED, TL auto-tuning, TL PWM outputs). Runs on core0.
+     */
     bool Update();
 
+    /**
+     * Assembles demodulated messages into transponder_packet_queue and prunes the aircraft dictionary. Runs on core1,
+     * alongside packet validation and aircraft dictionary ingestion.
+     * @retval True if any demodulated messages were assembled, false if there was nothing to do.
+     */
+    bool UpdateDecoder();
+
     void SetReceiverEnable(bool is_enabled) {
         is_enabled_ = is_enabled;
         irq_set_enabled(config_.preamble_detector_demod_irq, is_enabled_);
@@ -68,6 +97,39 @@ class ADSBee {
 
     bool ReceiverIsEnabled() { return is_enabled_; }
 
+    /**
+     * Turns closed loop trigger level tuning on or off. When turned on, tuning starts from the current TLs.
+     * @param[in] is_enabled True to let Update() adjust the TLs, false to leave them where they are.
+     */
+    void SetTLAutoTuneEnabled(bool is_enabled);
+
+    bool TLAutoTuneIsEnabled() { return tl_auto_tune_enabled_; }
+
+    /**
+     * Counts the outcome of a packet's CRC check, for pipeline statistics and TL auto-tuning. Called from the decode
+     * loop on core1.
+     * @param[in] packet Packet that was checked.
+     * @param[in] passed True if the packet passed its CRC check, or if its Address/Parity field matched a known ICAO
+     * address.
+     */
+    void RecordPacketCRCResult(const TransponderPacket &packet, bool passed) {
+        if (!passed) {
+            num_crc_failed_++;
+            return;
+        }
+        num_crc_passed_++;
+        if (packet.GetNumCorrectedBits() > 0) {
+            num_crc_corrected_++;
+        }
+    }
+
+    /**
+     * Fills in the receiver, demodulation, and decoding totals of a pipeline statistics snapshot. Each total has a
+     * single writer and is read without locking, so totals from different stages may be a few packets apart.
+     * @param[out] stats Snapshot to fill in.
+     */
+    void GetPipelineStats(PipelineStats &stats);
+
     /**
      * Blinks the status LED for a given number of milliseconds. Non-blocking.
      * @param[in] led_on_ms Optional parameter specifying number of milliseconds to turn on for. Defaults to
@@ -75,11 +137,6 @@ class ADSBee {
      */
     void FlashStatusLED(uint32_t led_on_ms = kStatusLEDOnMs);
 
-    /**
-     * ISR for GPIO interrupts.
-     */
-    void GPIOIRQISR(uint gpio, uint32_t event_mask);
-
     /**
      * Returns the last written value of rx_gain.
      * @retval Gain (integer ratio between 1-101).
@@ -99,17 +156,12 @@ class ADSBee {
     int GetTLLoMilliVolts() { return tl_lo_mv_; }
 
     /**
-     * ISR triggered by DECODE completing, via PIO0 IRQ0.
+     * ISR triggered by DECODE completing, via PIO0 IRQ0. Demodulated words are already in the DMA ring buffer, so this
+     * just finds each message from its end-of-frame word and timestamps it. Handles up to one message per preamble
+     * detector, if the second one finished before the ISR ran. Packets are assembled later in UpdateDecoder().
      */
     void OnDemodComplete();
 
-    /**
-     * ISR triggered by SysTick interrupt. Used to wrap the MLAT counter.
-     */
-    void OnSysTickWrap();
-
-    inline uint64_t GetMLAT12MHzCounts();
-
     /**
      * Read the high Minimum Trigger Level threshold via ADC.
      * @retval TL in milliVolts.
@@ -161,29 +213,127 @@ class ADSBee {
     /**
      * Returns the Receive Signal Strength Indicator (RSSI) of the previous message, in dBm.
      */
-    int GetLastMessageRSSIdBm() {
-        int normalized_rssi_adc_counts = last_message_rssi_adc_counts_ / MAX(rx_gain_, 1);  // Avoid divide by 0.
-        int rssi_mv = normalized_rssi_adc_counts * 3300 / 4095;
-        return 60 * (rssi_mv - 1600) / 1000;  // AD8313 0dBm intercept at 1.6V, slope is 60dBm/V.
-    }
+    int GetLastMessageRSSIdBm() { return RSSIADCCountsTodBm(last_message_rssi_adc_counts_); }
+
+    /**
+     * Converts a reading from the RSSI peak detector to dBm, based on the current rx gain.
+     * @param[in] rssi_adc_counts Raw 12-bit ADC reading of the RSSI peak detector.
+     * @retval RSSI in dBm.
+     */
+    int RSSIADCCountsTodBm(uint16_t rssi_adc_counts) { return rssi_adc_counts_to_dbm(rssi_adc_counts, rx_gain_); }
+
+    /**
+     * Returns the number of demodulated messages that were dropped because the DMA ring buffer wrapped around before
+     * they could be assembled into packets.
+     */
+    uint32_t GetNumDemodRingOverruns() { return num_demod_ring_overruns_; }
+
+    /**
+     * Returns the number of demodulated messages that were dropped because their end-of-frame word didn't line up
+     * with the words in the ring buffer.
+     */
+    uint32_t GetNumDemodFramingErrors() { return num_demod_framing_errors_; }
 
     uint64_t GetLastMessageMLAT12MHzCounts() { return last_message_mlat_12mhz_counts_; }
 
-    PFBQueue<TransponderPacket> transponder_packet_queue = PFBQueue<TransponderPacket>(
+    /**
+     * Returns the number of demodulated messages that had no MLAT counter latch waiting for them, and were reported
+     * without a timestamp.
+     */
+    uint32_t GetNumMLATCounterMisses() { return num_mlat_counter_misses_; }
+
+    /**
+     * Returns the number of times that both preamble detectors were parked waiting on the DEMOD ISR at once, leaving
+     * the receiver unable to pick up new messages.
+     */
+    uint32_t GetNumDemodBlindWindows() { return num_demod_blind_windows_; }
+
+    /**
+     * Returns the estimated total time that the receiver has spent unable to pick up new messages because both
+     * preamble detectors were waiting on the DEMOD ISR, in microseconds.
+     */
+    uint64_t GetDemodBlindTimeUs() { return demod_blind_time_us_; }
+
+    SPSCQueue<RawTransponderPacket> transponder_packet_queue = SPSCQueue<RawTransponderPacket>(
         {.buf_len_num_elements = kMaxNumTransponderPackets, .buffer = transponder_packet_queue_buffer_});
 
     AircraftDictionary aircraft_dictionary;
+    // Held by whichever core is accessing aircraft_dictionary. Core1 ingests packets while core0 reports from it.
+    mutex_t aircraft_dictionary_mutex;
 
    private:
+    /**
+     * Marker published by OnDemodComplete for each demodulated message.
+     */
+    struct DemodMessageMarker {
+        DemodFrame frame;
+        uint16_t rssi_adc_counts = 0;
+        uint64_t mlat_12mhz_counts = 0;
+    };
+
+    /**
+     * Assembles a demodulated message from the DMA ring buffer into a RawTransponderPacket and pushes it onto
+     * transponder_packet_queue.
+     * @param[in] marker Marker published when the message ended.
+     */
+    void AssembleDemodMessage(const DemodMessageMarker &marker);
+
+    /**
+     * Returns a recent sample of one of the ADC inputs from the ADC ring buffer. Doesn't wait on the ADC, so it's safe
+     * to call from an ISR.
+     * @param[in] slot Position of the input within each round robin frame.
+     * @param[in] num_frames_back Number of frames to look back from the most recent complete frame.
+     * @retval Raw 12-bit ADC reading.
+     */
+    uint16_t GetADCSample(uint16_t slot, uint16_t num_frames_back = 0);
+
+    /**
+     * Returns the peak RSSI of a message that the demodulator has finished, from the ADC samples taken while it was
+     * being received. Falls back to the most recent samples if the message's MLAT latch was missed.
+     * @param[in] mlat_12mhz_counts MLAT counter value latched at the message's preamble match, 0 if unknown.
+     * @param[in] num_bits Number of bits in the message.
+     * @param[in] timestamp_us Current time on the MLAT counter's time base, in microseconds.
+     * @retval Raw 12-bit ADC reading of the RSSI peak detector.
+     */
+    uint16_t GetMessageRSSIADCCounts(uint64_t mlat_12mhz_counts, uint32_t num_bits, uint64_t timestamp_us);
+
+    /**
+     * Extends a 32-bit value latched by the MLAT counter PIO program into a monotonic 48-bit count of a 12MHz clock.
+     * Must be called within half a counter wrap (~34 seconds) of the latch.
+     * @param[in] mlat_counter_latch Raw X register value pushed by the MLAT counter.
+     * @retval 48-bit 12MHz count since the MLAT counter was started.
+     */
+    uint64_t MLATCounterLatchToMLAT12MHzCounts(uint32_t mlat_counter_latch);
+
     ADSBeeConfig config_;
     CppAT parser_;
 
-    uint32_t preamble_detector_sm_ = 0;
+    uint32_t preamble_detector_sms_[kNumPreambleDetectors] = {0};
+    // Index of the preamble detector that will finish the next message.
+    uint16_t next_preamble_detector_index_ = 0;
+    uint32_t num_demod_blind_windows_ = 0;
+    uint64_t demod_blind_time_us_ = 0;
     uint32_t preamble_detector_offset_ = 0;
 
     uint32_t message_demodulator_sm_ = 0;
     uint32_t message_demodulator_offset_ = 0;
 
+    // Runs on the same PIO as the preamble detector.
+    uint32_t mlat_counter_sm_ = 0;
+    uint32_t mlat_counter_offset_ = 0;
+    static constexpr uint16_t kMLATCounterClkSysCyclesPerCount = 2;  // Every path through the program is 2 cycles.
+    uint32_t mlat_counter_clk_sys_mhz_ = 125;
+    uint64_t mlat_counter_start_timestamp_us_ = 0;
+    uint32_t num_mlat_counter_misses_ = 0;
+
+    // DMA channel that drains the message demodulator RX FIFO into demod_ring_buffer_, and a control channel that
+    // re-arms its transfer count whenever it runs out so that the drain never stops.
+    int demod_dma_chan_ = -1;
+    int demod_dma_ctrl_chan_ = -1;
+    // DMA channel that drains the ADC FIFO into adc_ring_buffer_, with its own re-arming control channel.
+    int adc_dma_chan_ = -1;
+    int adc_dma_ctrl_chan_ = -1;
+
     uint32_t led_off_timestamp_ms_ = 0;
 
     uint16_t tl_lo_pwm_slice_ = 0;
@@ -199,19 +349,48 @@ class ADSBee {
     uint16_t tl_lo_adc_counts_ = 0;
     uint16_t tl_hi_adc_counts_ = 0;
     uint16_t last_message_rssi_adc_counts_ = 0;
+    // Positions of each ADC input within a round robin frame of adc_ring_buffer_.
+    uint16_t tl_hi_adc_slot_ = 0;
+    uint16_t tl_lo_adc_slot_ = 0;
+    uint16_t rssi_adc_slot_ = 0;
     uint64_t last_message_mlat_12mhz_counts_ = 0;
 
-    uint32_t mlat_counter_1s_wraps_ = 0;
-
     uint32_t rx_gain_ = SettingsManager::kDefaultRxGain;
 
-    // Due to a quirk, rx_buffer_ is used to store every word except for the first one.
-    uint32_t rx_buffer_[ADSBPacket::kMaxPacketLenWords32 - 1];
-
-    TransponderPacket transponder_packet_queue_buffer_[kMaxNumTransponderPackets];
+    TLAutoTuner tl_auto_tuner_;
+    bool tl_auto_tune_enabled_ = false;
+
+    // Pipeline statistics. Each total only has one writer, since the Cortex-M0+ has no atomic read-modify-write.
+    // Written by the DEMOD ISR on core0.
+    volatile uint32_t num_preambles_matched_ = 0;
+    volatile uint32_t num_demods_completed_ = 0;
+    // Written by the decode loop on core1.
+    volatile uint32_t num_demod_words_ingested_ = 0;
+    volatile uint32_t num_frames_too_short_ = 0;
+    volatile uint32_t num_frames_56_bit_ = 0;
+    volatile uint32_t num_frames_112_bit_ = 0;
+    volatile uint32_t num_crc_passed_ = 0;
+    volatile uint32_t num_crc_failed_ = 0;
+    volatile uint32_t num_crc_corrected_ = 0;
+
+    uint32_t demod_ring_buffer_[kDemodRingBufferNumWords] __attribute__((aligned(1 << kDemodRingBufferSizeBits)));
+    // Total number of words written to demod_ring_buffer_ as of the last OnDemodComplete, tracked by the ISR from the
+    // DMA write address. Wraps at 2^32, which is fine since only differences are used.
+    volatile uint32_t demod_ring_num_words_written_ = 0;
+    uint16_t adc_ring_buffer_[kADCRingBufferNumSamples] __attribute__((aligned(1 << kADCRingBufferSizeBits)));
+    uint16_t demod_ring_last_write_index_ = 0;
+    DemodMessageMarker demod_message_marker_queue_buffer_[kMaxNumTransponderPackets];
+    // Pushed from the demod complete ISR on core0, popped by UpdateDecoder on core1.
+    SPSCQueue<DemodMessageMarker> demod_message_marker_queue_ = SPSCQueue<DemodMessageMarker>(
+        {.buf_len_num_elements = kMaxNumTransponderPackets, .buffer = demod_message_marker_queue_buffer_});
+    // Ring buffer position just past the end-of-frame word of the last message found by OnDemodComplete.
+    uint32_t demod_ring_last_message_end_word_count_ = 0;
+    uint32_t num_demod_framing_errors_ = 0;
+    uint32_t num_demod_ring_overruns_ = 0;
+
+    RawTransponderPacket transponder_packet_queue_buffer_[kMaxNumTransponderPackets];
 
     uint32_t last_aircraft_dictionary_update_timestamp_ms_ = 0;
-    uint16_t last_demod_num_words_ingested_ = 0;
 
     bool is_enabled_ = true;
 };
@@ -37,6 +37,7 @@ bool SettingsManager::Save() {
     settings.rx_gain = ads_bee.GetRxGain();
     settings.tl_lo_mv = ads_bee.GetTLLoMilliVolts();
     settings.tl_hi_mv = ads_bee.GetTLHiMilliVolts();
+    settings.tl_auto_tune_enabled = ads_bee.TLAutoTuneIsEnabled();
 
     // Save log level.
     settings.log_level = comms_manager.log_level;
@@ -70,6 +71,7 @@ void SettingsManager::ResetToDefaults() {
 void SettingsManager::Apply() {
     ads_bee.SetTLLoMilliVolts(settings.tl_lo_mv);
     ads_bee.SetTLHiMilliVolts(settings.tl_hi_mv);
+    ads_bee.SetTLAutoTuneEnabled(settings.tl_auto_tune_enabled);  // After the TLs, since tuning starts from them.
     ads_bee.SetRxGain(settings.rx_gain);
 
     // Apply log level.
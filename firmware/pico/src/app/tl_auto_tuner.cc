@@ -0,0 +1,110 @@
+#include "tl_auto_tuner.hh"
+
+#include <math.h>
+
+#include "macros.hh"
+
+void TLAutoTuner::Reset(uint32_t timestamp_ms, int tl_lo_mv, int tl_hi_mv, uint32_t num_preambles,
+                        uint32_t num_valid_frames) {
+    tl_lo_mv_ = tl_lo_mv;
+    tl_spread_mv_ = tl_hi_mv - tl_lo_mv;
+    direction_ = 1;
+    step_mv_ = config_.max_step_mv;
+
+    window_start_timestamp_ms_ = timestamp_ms;
+    window_start_num_preambles_ = num_preambles;
+    window_start_num_valid_frames_ = num_valid_frames;
+    has_reference_rate_ = false;
+    reference_valid_frames_per_second_ = 0.0f;
+    valid_frames_per_second_ = 0.0f;
+    num_windows_held_ = 0;
+}
+
+bool TLAutoTuner::Update(uint32_t timestamp_ms, uint32_t num_preambles, uint32_t num_valid_frames) {
+    uint32_t window_ms = timestamp_ms - window_start_timestamp_ms_;
+    if (window_ms < config_.window_ms) {
+        return false;
+    }
+    uint32_t window_num_preambles = num_preambles - window_start_num_preambles_;
+    uint32_t window_num_valid_frames = num_valid_frames - window_start_num_valid_frames_;
+    window_start_timestamp_ms_ = timestamp_ms;
+    window_start_num_preambles_ = num_preambles;
+    window_start_num_valid_frames_ = num_valid_frames;
+    valid_frames_per_second_ = window_num_valid_frames * 1000.0f / window_ms;
+
+    if (window_num_preambles >= config_.noise_min_preambles_per_window &&
+        window_num_valid_frames * 100 < window_num_preambles * config_.noise_valid_percent) {
+        // Preamble detector is mostly triggering on noise, which can also starve real messages. Back off right away.
+        direction_ = 1;
+        step_mv_ = config_.max_step_mv;
+        has_reference_rate_ = false;
+        num_windows_held_ = 0;
+        return Step(config_.max_step_mv);
+    }
+
+    if (window_num_valid_frames < config_.min_valid_frames_per_window) {
+        // Too little traffic to tell a good TL from a bad one, so start over once traffic picks up. If the preamble
+        // detector isn't hearing anything at all, the TL may be above everything including the noise, so walk it down
+        // until it starts hearing something.
+        has_reference_rate_ = false;
+        if (window_num_preambles < config_.min_valid_frames_per_window) {
+            direction_ = -1;
+            return Step(-config_.max_step_mv);
+        }
+        return false;
+    }
+
+    if (!has_reference_rate_) {
+        // First usable window at this TL, take a step to see which way is better.
+        has_reference_rate_ = true;
+        reference_valid_frames_per_second_ = valid_frames_per_second_;
+        num_windows_held_ = 0;
+        return Step(direction_ * step_mv_);
+    }
+
+    // Changes smaller than the hysteresis band, or than two standard deviations of the window's packet count (Poisson
+    // arrivals), are treated as traffic coming and going.
+    float last_valid_frames_per_second = reference_valid_frames_per_second_;
+    float hysteresis_band = MAX(last_valid_frames_per_second * config_.hysteresis_percent / 100.0f,
+                                2.0f * sqrtf(window_num_valid_frames) * 1000.0f / window_ms);
+    reference_valid_frames_per_second_ = valid_frames_per_second_;
+    if (valid_frames_per_second_ > last_valid_frames_per_second + hysteresis_band) {
+        // Last step helped, keep going the same way.
+        step_mv_ = MIN(step_mv_ * 2, config_.max_step_mv);
+        num_windows_held_ = 0;
+        return Step(direction_ * step_mv_);
+    }
+    if (valid_frames_per_second_ < last_valid_frames_per_second - hysteresis_band) {
+        // Last step hurt, turn around with a smaller step.
+        direction_ = -direction_;
+        step_mv_ = MAX(step_mv_ / 2, config_.min_step_mv);
+        num_windows_held_ = 0;
+        return Step(direction_ * step_mv_);
+    }
+
+    // No real difference, hold here. Probe every so often in case the noise floor has drifted, with a step big enough
+    // to show up outside the hysteresis band.
+    num_windows_held_++;
+    if (num_windows_held_ >= config_.probe_interval_windows) {
+        num_windows_held_ = 0;
+        step_mv_ = config_.max_step_mv;
+        return Step(direction_ * step_mv_);
+    }
+    return false;
+}
+
+bool TLAutoTuner::Step(int step_mv) {
+    int new_tl_lo_mv = tl_lo_mv_ + step_mv;
+    if (new_tl_lo_mv < config_.min_tl_mv) {
+        new_tl_lo_mv = config_.min_tl_mv;
+        direction_ = 1;
+    } else if (new_tl_lo_mv + tl_spread_mv_ > config_.max_tl_mv) {
+        new_tl_lo_mv = config_.max_tl_mv - tl_spread_mv_;
+        direction_ = -1;
+    }
+    if (new_tl_lo_mv == tl_lo_mv_) {
+        return false;
+    }
+    tl_lo_mv_ = new_tl_lo_mv;
+    return true;
+}
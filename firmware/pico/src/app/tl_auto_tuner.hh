@@ -0,0 +1,95 @@
+#ifndef TL_AUTO_TUNER_HH_
+#define TL_AUTO_TUNER_HH_
+
+#include <stdint.h>
+
+/**
+ * Closed loop trigger level (TL) tuning. Once per window, compares the number of preambles detected against the
+ * number of frames that came out CRC-valid, and walks the TL towards whatever setting gives the most valid frames per
+ * second (perturb and observe). Raising the TL makes the receiver less sensitive. The LO and HI TLs are moved
+ * together, keeping the spacing between them.
+ *
+ * Steps are bounded, and changes in the valid frame rate smaller than the hysteresis band are treated as noise from
+ * traffic coming and going, so the TL holds still instead of dithering. While holding, the tuner occasionally probes
+ * one step to follow a drifting noise floor. If preambles are mostly noise, the TL is raised right away regardless of
+ * the valid frame rate, and if there are no preambles at all, it's lowered.
+ */
+class TLAutoTuner {
+   public:
+    struct TLAutoTunerConfig {
+        uint32_t window_ms = 5000;                  // How long to count frames for before each adjustment.
+        int min_tl_mv = 50;                         // [mV] Lowest LO TL the tuner will set.
+        int max_tl_mv = 2500;                       // [mV] Highest HI TL the tuner will set.
+        int min_step_mv = 5;                        // [mV] Smallest TL step, reached after repeated turnarounds.
+        int max_step_mv = 40;                       // [mV] Largest TL step.
+        uint16_t hysteresis_percent = 5;            // Valid frame rate changes smaller than this are ignored.
+        uint32_t min_valid_frames_per_window = 20;  // Don't draw conclusions from fewer valid frames than this.
+        uint16_t probe_interval_windows = 12;       // Number of windows to hold still for before probing.
+        // If more than this many preambles are detected in a window and fewer than noise_valid_percent of them are
+        // valid, preamble detections are mostly noise and the TL is raised.
+        uint32_t noise_min_preambles_per_window = 2000;
+        uint16_t noise_valid_percent = 5;
+    };
+
+    /**
+     * Default constructor. Uses default config values.
+     */
+    TLAutoTuner() {};
+
+    /**
+     * Constructor with config values specified.
+     */
+    TLAutoTuner(TLAutoTunerConfig config_in) : config_(config_in) {};
+
+    /**
+     * Starts tuning from a set of TLs. Clears the tuner's history.
+     * @param[in] timestamp_ms Current time, in milliseconds.
+     * @param[in] tl_lo_mv Current LO TL, in milliVolts.
+     * @param[in] tl_hi_mv Current HI TL, in milliVolts.
+     * @param[in] num_preambles Running total of preambles detected.
+     * @param[in] num_valid_frames Running total of CRC-valid frames.
+     */
+    void Reset(uint32_t timestamp_ms, int tl_lo_mv, int tl_hi_mv, uint32_t num_preambles, uint32_t num_valid_frames);
+
+    /**
+     * Feeds the tuner the latest counts. Only makes a decision at the end of each window.
+     * @param[in] timestamp_ms Current time, in milliseconds.
+     * @param[in] num_preambles Running total of preambles detected. Allowed to wrap.
+     * @param[in] num_valid_frames Running total of CRC-valid frames. Allowed to wrap.
+     * @retval True if the TLs changed and should be applied, false otherwise.
+     */
+    bool Update(uint32_t timestamp_ms, uint32_t num_preambles, uint32_t num_valid_frames);
+
+    int GetTLLoMilliVolts() { return tl_lo_mv_; }
+    int GetTLHiMilliVolts() { return tl_lo_mv_ + tl_spread_mv_; }
+
+    /**
+     * Returns the valid frame rate over the last complete window, in frames per second.
+     */
+    float GetValidFramesPerSecond() { return valid_frames_per_second_; }
+
+   private:
+    /**
+     * Moves the TL by a signed step, keeping it within bounds. Turns around if a bound is hit.
+     * @param[in] step_mv Step to take, in milliVolts.
+     * @retval True if the TL moved, false if it was already at the bound.
+     */
+    bool Step(int step_mv);
+
+    TLAutoTunerConfig config_;
+
+    int tl_lo_mv_ = 0;
+    int tl_spread_mv_ = 0;  // HI TL minus LO TL.
+    int direction_ = 1;     // +1 to raise the TL next, -1 to lower it.
+    int step_mv_ = 0;
+
+    uint32_t window_start_timestamp_ms_ = 0;
+    uint32_t window_start_num_preambles_ = 0;
+    uint32_t window_start_num_valid_frames_ = 0;
+    bool has_reference_rate_ = false;
+    float reference_valid_frames_per_second_ = 0.0f;  // Valid frame rate at the current TL, before any step.
+    float valid_frames_per_second_ = 0.0f;
+    uint16_t num_windows_held_ = 0;
+};
+
+#endif /* TL_AUTO_TUNER_HH_ */
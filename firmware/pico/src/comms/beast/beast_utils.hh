@@ -40,14 +40,17 @@ uint16_t WriteBufferWithBeastEscapes(uint8_t to_buf[], const uint8_t from_buf[],
 }
 
 /**
- * Converts a TransponderPacket payload to a data buffer in Mode S Beast output format.
- * @param[in] packet Reference to TransponderPacket to convert.
+ * Converts a raw transponder packet payload to a data buffer in Mode S Beast output format.
+ * @param[in] packet Reference to RawTransponderPacket to convert.
  * @param[out] beast_frame_buf Pointer to byte buffer to fill with payload.
  * @retval Number of bytes written to beast_frame_buf.
  */
-uint16_t TransponderPacketToBeastFrame(const TransponderPacket &packet, uint8_t *beast_frame_buf) {
-    uint8_t packet_buf[TransponderPacket::kMaxPacketLenWords32 * kBytesPerWord];
-    uint16_t data_num_bytes = packet.DumpPacketBuffer(packet_buf);
+uint16_t TransponderPacketToBeastFrame(const RawTransponderPacket &packet, uint8_t *beast_frame_buf) {
+    uint8_t packet_buf[RawTransponderPacket::kMaxPacketLenWords32 * kBytesPerWord];
+    uint16_t data_num_bytes = packet.buffer_len_bits / kBitsPerByte;
+    for (uint16_t i = 0; i < data_num_bytes; i++) {
+        packet_buf[i] = packet.buffer[i / kBytesPerWord] >> ((kBytesPerWord - 1 - i % kBytesPerWord) * kBitsPerByte);
+    }
 
     // Determine and write frame type Byte.
     switch (data_num_bytes * kBitsPerByte) {
@@ -65,7 +68,7 @@ uint16_t TransponderPacketToBeastFrame(const TransponderPacket &packet, uint8_t
     uint16_t bytes_written = 1;
 
     // Write 6-Byte MLAT timestamp.
-    uint64_t mlat_12mhz_counter = packet.GetMLAT12MHzCounter();
+    uint64_t mlat_12mhz_counter = packet.mlat_12mhz_counts;
     uint8_t mlat_12mhz_counter_buf[6];
     for (uint16_t i = 0; i < kBeastMLATTimestampNumBytes; i++) {
         mlat_12mhz_counter_buf[i] = (mlat_12mhz_counter >> (kBeastMLATTimestampNumBytes - i - 1) * kBitsPerByte) & 0xFF;
@@ -79,7 +82,7 @@ uint16_t TransponderPacketToBeastFrame(const TransponderPacket &packet, uint8_t
     bytes_written += WriteBufferWithBeastEscapes(beast_frame_buf + bytes_written, mlat_12mhz_counter_buf, 6);
 
     // Write RSSI Byte.
-    uint8_t rssi_byte_dbm = static_cast<uint8_t>(255 + packet.GetRSSIdBm());
+    uint8_t rssi_byte_dbm = static_cast<uint8_t>(255 + packet.rssi_dbm);
     bytes_written += WriteBufferWithBeastEscapes(beast_frame_buf + bytes_written, &rssi_byte_dbm, 1);
 
     // Write packet buffer with escape characters.
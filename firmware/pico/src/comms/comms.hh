@@ -1,10 +1,10 @@
 #ifndef COMMS_HH_
 #define COMMS_HH_
 
-// #include "adsb_packet.hh"  // For TransponderPacket.
+// #include "adsb_packet.hh"  // For RawTransponderPacket.
 #include "ads_bee.hh"
 #include "cpp_at.hh"
-#include "data_structures.hh"  // For PFBQueue.
+#include "data_structures.hh"  // For SPSCQueue.
 #include "hardware/uart.h"
 #include "settings.hh"
 
@@ -42,6 +42,8 @@ class CommsManager {
     CPP_AT_CALLBACK(ATRxEnableCallback);
     CPP_AT_CALLBACK(ATRxGainCallback);
     CPP_AT_CALLBACK(ATSettingsCallback);
+    CPP_AT_CALLBACK(ATStatsCallback);
+    CPP_AT_CALLBACK(ATTLAutoCallback);
     CPP_AT_CALLBACK(ATTLReadCallback);
     CPP_AT_CALLBACK(ATTLSetCallback);
     CPP_AT_CALLBACK(ATWiFiCallback);
@@ -131,14 +133,29 @@ class CommsManager {
 
     bool SetWiFiEnabled(bool new_wifi_enabled);
 
+    /**
+     * Takes a snapshot of the running totals from every stage of the receive pipeline, including reporting.
+     * @param[out] stats Snapshot to fill in.
+     */
+    void GetPipelineStats(PipelineStats &stats);
+
+    /**
+     * Counts bytes sent out by a reporting protocol, for pipeline statistics.
+     * @param[in] iface SerialInterface that the bytes were sent on. Counted against its current reporting protocol.
+     * @param[in] num_bytes Number of bytes sent.
+     */
+    void RecordReportedBytes(SettingsManager::SerialInterface iface, uint32_t num_bytes) {
+        num_reported_bytes_[reporting_protocols_[iface]] += num_bytes;
+    }
+
     // Public console settings.
     SettingsManager::LogLevel log_level = SettingsManager::LogLevel::kInfo;  // Start with highest verbosity by default.
     uint32_t last_report_timestamp_ms = 0;
 
-    // Queue for storing transponder packets before they get reported.
-    PFBQueue<TransponderPacket> transponder_packet_reporting_queue =
-        PFBQueue<TransponderPacket>({.buf_len_num_elements = ADSBee::kMaxNumTransponderPackets,
-                                     .buffer = transponder_packet_reporting_queue_buffer_});
+    // Queue for storing transponder packets before they get reported. Pushed by core1, popped by core0.
+    SPSCQueue<RawTransponderPacket> transponder_packet_reporting_queue =
+        SPSCQueue<RawTransponderPacket>({.buf_len_num_elements = ADSBee::kMaxNumTransponderPackets,
+                                         .buffer = transponder_packet_reporting_queue_buffer_});
 
     // Public WiFi Settings
     char wifi_ssid[SettingsManager::kWiFiSSIDMaxLen + 1];          // Add space for null terminator.
@@ -149,6 +166,10 @@ class CommsManager {
     uint8_t mavlink_system_id = 0;
     uint8_t mavlink_component_id = 0;
 
+    // Pipeline statistics settings. Snapshots are sent to the coprocessor as a PipelineStatsPacket.
+    uint32_t pipeline_stats_reporting_interval_ms = 10000;
+    uint32_t last_pipeline_stats_report_timestamp_ms = 0;
+
    private:
     // AT Functions
     bool InitAT();
@@ -158,7 +179,7 @@ class CommsManager {
     bool InitReporting();
     bool UpdateReporting();
 
-    bool ReportRaw(SettingsManager::SerialInterface iface, const TransponderPacket packets_to_report[],
+    bool ReportRaw(SettingsManager::SerialInterface iface, const RawTransponderPacket packets_to_report[],
                    uint16_t num_packets_to_report);
 
     /**
@@ -170,7 +191,7 @@ class CommsManager {
      * @param[in] num_packets_to_report Number of packets to report from the packets_to_report array.
      * @retval True if successful, false if something broke.
      */
-    bool ReportBeast(SettingsManager::SerialInterface iface, const TransponderPacket packets_to_report[],
+    bool ReportBeast(SettingsManager::SerialInterface iface, const RawTransponderPacket packets_to_report[],
                      uint16_t num_packets_to_report);
 
     /**
@@ -190,7 +211,7 @@ class CommsManager {
     CppAT at_parser_;
 
     // Queue for holding new transponder packets before they get reported.
-    TransponderPacket transponder_packet_reporting_queue_buffer_[ADSBee::kMaxNumTransponderPackets];
+    RawTransponderPacket transponder_packet_reporting_queue_buffer_[ADSBee::kMaxNumTransponderPackets];
 
     // Reporting Settings
     uint32_t comms_uart_baudrate_ = SettingsManager::kDefaultCommsUARTBaudrate;
@@ -200,6 +221,9 @@ class CommsManager {
             SettingsManager::ReportingProtocol::kNoReports,
             SettingsManager::ReportingProtocol::kMAVLINK1};  // GNSS_UART not included.
 
+    // Bytes sent by each reporting protocol. Only written by the reporting loop on core0.
+    uint32_t num_reported_bytes_[SettingsManager::ReportingProtocol::kNumProtocols] = {0};
+
     // private WiFi Settings
     bool wifi_enabled_ = false;
 };
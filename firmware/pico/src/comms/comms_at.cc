@@ -216,14 +216,45 @@ CPP_AT_CALLBACK(CommsManager::ATSettingsCallback) {
             CPP_AT_ERROR("No arguments provided.");
             break;
         case '?':
-            CPP_AT_CMD_PRINTF("=%d(tl_lo_mv),%d(tl_hi_mv),%d(rx_gain)\r\n", settings_manager.settings.tl_lo_mv,
-                              settings_manager.settings.tl_hi_mv, settings_manager.settings.rx_gain);
+            CPP_AT_CMD_PRINTF("=%d(tl_lo_mv),%d(tl_hi_mv),%d(tl_auto_tune_enabled),%d(rx_gain)\r\n",
+                              settings_manager.settings.tl_lo_mv, settings_manager.settings.tl_hi_mv,
+                              settings_manager.settings.tl_auto_tune_enabled, settings_manager.settings.rx_gain);
             CPP_AT_SUCCESS();
             break;
     }
     CPP_AT_ERROR("Operator '%c' not supported.", op);
 }
 
+CPP_AT_CALLBACK(CommsManager::ATStatsCallback) {
+    switch (op) {
+        case '?': {
+            PipelineStats stats;
+            GetPipelineStats(stats);
+            uint32_t num_frames = stats.num_frames_56_bit + stats.num_frames_112_bit;
+            CPP_AT_CMD_PRINTF("=DEMOD,%u(preambles_matched),%u(demods_completed),%u(framing_errors),"
+                              "%u(ring_overruns)\r\n",
+                              stats.num_preambles_matched, stats.num_demods_completed, stats.num_demod_framing_errors,
+                              stats.num_demod_ring_overruns);
+            CPP_AT_CMD_PRINTF("=FRAMES,%u(56_bit),%u(112_bit),%u(too_short),%.2f(words_per_frame)\r\n",
+                              stats.num_frames_56_bit, stats.num_frames_112_bit, stats.num_frames_too_short,
+                              num_frames > 0 ? static_cast<float>(stats.num_demod_words_ingested) / num_frames : 0.0f);
+            CPP_AT_CMD_PRINTF("=CRC,%u(passed),%u(failed),%u(corrected)\r\n", stats.num_crc_passed,
+                              stats.num_crc_failed, stats.num_crc_corrected);
+            CPP_AT_CMD_PRINTF("=DROPS,%u(demod_marker_queue),%u(transponder_packet_queue),%u(reporting_queue),"
+                              "%u(dictionary_evictions)\r\n",
+                              stats.num_demod_marker_queue_drops, stats.num_transponder_packet_queue_drops,
+                              stats.num_reporting_queue_drops, stats.num_dictionary_evictions);
+            for (uint16_t i = 0; i < SettingsManager::ReportingProtocol::kNumProtocols; i++) {
+                CPP_AT_CMD_PRINTF("=REPORTED_BYTES,%s,%u\r\n", SettingsManager::ReportingProtocolStrs[i],
+                                  stats.num_reported_bytes[i]);
+            }
+            CPP_AT_SILENT_SUCCESS();
+            break;
+        }
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+}
+
 CPP_AT_CALLBACK(CommsManager::ATTLReadCallback) {
     switch (op) {
         case '?':
@@ -235,11 +266,37 @@ CPP_AT_CALLBACK(CommsManager::ATTLReadCallback) {
     CPP_AT_ERROR("Operator '%c' not supported.", op);
 }
 
+/**
+ * AT+TL_AUTO Callback
+ * AT+TL_AUTO=<enabled>
+ *  enabled = 1 to let the receiver tune its own trigger levels, 0 to hold them.
+ * AT+TL_AUTO?
+ * +TL_AUTO=<enabled>
+ */
+CPP_AT_CALLBACK(CommsManager::ATTLAutoCallback) {
+    switch (op) {
+        case '=':
+            if (CPP_AT_HAS_ARG(0)) {
+                bool tl_auto_tune_enabled;
+                CPP_AT_TRY_ARG2NUM(0, tl_auto_tune_enabled);
+                ads_bee.SetTLAutoTuneEnabled(tl_auto_tune_enabled);
+                CPP_AT_SUCCESS();
+            }
+            break;
+        case '?':
+            CPP_AT_CMD_PRINTF("=%d", ads_bee.TLAutoTuneIsEnabled());
+            CPP_AT_SILENT_SUCCESS();
+            break;
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+}
+
 /**
  * AT+TL_SET Callback
  * AT+TL_SET=<mtl_lo_mv>,<mtl_hi_mv>
  *  mtl_lo_mv = Low trigger value, mV.
  *  mtl_hi_mv = High trigger value, mV.
+ *  Turns off TL auto-tuning, so that the values stick.
  * AT+TL_SET?
  * +TL_SET=
  */
@@ -251,6 +308,8 @@ CPP_AT_CALLBACK(CommsManager::ATTLSetCallback) {
             CPP_AT_SILENT_SUCCESS();
             break;
         case '=':
+            // TLs set by hand would get walked away from by the auto-tuner.
+            ads_bee.SetTLAutoTuneEnabled(false);
             // Attempt setting LO TL value, in milliVolts, if first argument is not blank.
             if (CPP_AT_HAS_ARG(0)) {
                 uint16_t new_mtl_lo_mv;
@@ -377,6 +436,12 @@ const CppAT::ATCommandDef_t at_command_list[] = {
      .help_string_buf = "Load, save, or reset nonvolatile settings.\r\n\tAT+SETTINGS=<op [LOAD SAVE RESET]>\r\n\t"
                         "Display nonvolatile settings.\r\n\tAT+SETTINGS?\r\n\t+SETTINGS=...\r\n\t",
      .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATSettingsCallback, comms_manager)},
+    {.command_buf = "+STATS",
+     .min_args = 0,
+     .max_args = 0,
+     .help_string_buf = "Display running totals from each stage of the receive pipeline.\r\n\tAT+STATS?\r\n\t"
+                        "+STATS=<stage>,<totals>...",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATStatsCallback, comms_manager)},
 #ifdef HARDWARE_UNIT_TESTS
     {.command_buf = "+TEST",
      .min_args = 0,
@@ -384,6 +449,12 @@ const CppAT::ATCommandDef_t at_command_list[] = {
      .help_string_buf = "Run hardware self-tests.",
      .callback = ATTestCallback},
 #endif
+    {.command_buf = "+TL_AUTO",
+     .min_args = 0,
+     .max_args = 1,
+     .help_string_buf = "AT+TL_AUTO=<enabled [1,0]>\r\n\tTurns closed loop trigger level tuning on or off. Setting "
+                        "trigger levels with AT+TL_SET turns it off.\r\n\tAT+TL_AUTO?\r\n\t+TL_AUTO=<enabled [1,0]>",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATTLAutoCallback, comms_manager)},
     {.command_buf = "+TL_READ",
      .min_args = 0,
      .max_args = 0,
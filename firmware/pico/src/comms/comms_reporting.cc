@@ -3,20 +3,35 @@
 #include "comms.hh"
 #include "hal.hh"  // For timestamping.
 #include "mavlink/mavlink.h"
+#include "spi_coprocessor.hh"
 #include "unit_conversions.hh"
 
 extern ADSBee ads_bee;
 
+// Aircraft reporters use their serial interface as their aircraft dictionary change consumer ID.
+static_assert(SettingsManager::SerialInterface::kNumSerialInterfaces <= Aircraft::kMaxNumChangeConsumers,
+              "Not enough aircraft change consumers for every serial interface.");
+
 bool CommsManager::InitReporting() { return true; }
 
 bool CommsManager::UpdateReporting() {
     bool ret = true;
     uint32_t timestamp_ms = get_time_since_boot_ms();
 
-    TransponderPacket packets_to_report[ADSBee::kMaxNumTransponderPackets];
-    uint16_t num_packets_to_report = 0;
-    while (transponder_packet_reporting_queue.Pop(packets_to_report[num_packets_to_report])) {
-        num_packets_to_report++;
+    RawTransponderPacket packets_to_report[ADSBee::kMaxNumTransponderPackets];
+    uint16_t num_packets_to_report =
+        transponder_packet_reporting_queue.Pop(packets_to_report, ADSBee::kMaxNumTransponderPackets);
+    for (uint16_t i = 0; i < num_packets_to_report; i++) {
+        const RawTransponderPacket &raw_packet = packets_to_report[i];
+        if (raw_packet.buffer_len_bits == TransponderPacket::kExtendedSquitterPacketLenBits) {
+            CONSOLE_INFO("New message: 0x%08x|%08x|%08x|%04x RSSI=%ddBm MLAT=%u", raw_packet.buffer[0],
+                         raw_packet.buffer[1], raw_packet.buffer[2], (raw_packet.buffer[3]) >> (4 * kBitsPerNibble),
+                         raw_packet.rssi_dbm, raw_packet.mlat_12mhz_counts);
+        } else {
+            CONSOLE_INFO("New message: 0x%08x|%06x RSSI=%ddBm MLAT=%u", raw_packet.buffer[0],
+                         (raw_packet.buffer[1]) >> (2 * kBitsPerNibble), raw_packet.rssi_dbm,
+                         raw_packet.mlat_12mhz_counts);
+        }
     }
     // TODO: forward packets_to_report to coprocessor over SPI.
 
@@ -56,15 +71,32 @@ bool CommsManager::UpdateReporting() {
         }
     }
 
+    // Send a snapshot of the pipeline statistics to the coprocessor for logging.
+    if (wifi_enabled_ &&
+        timestamp_ms - last_pipeline_stats_report_timestamp_ms >= pipeline_stats_reporting_interval_ms) {
+        PipelineStats stats;
+        GetPipelineStats(stats);
+        ret &= spi_coprocessor.SendPacket(SPICoprocessor::PipelineStatsPacket(stats));
+        last_pipeline_stats_report_timestamp_ms = timestamp_ms;
+    }
+
     return ret;
 }
 
-bool CommsManager::ReportRaw(SettingsManager::SerialInterface iface, const TransponderPacket packets_to_report[],
+void CommsManager::GetPipelineStats(PipelineStats &stats) {
+    ads_bee.GetPipelineStats(stats);
+    stats.num_reporting_queue_drops = transponder_packet_reporting_queue.GetNumOverflows();
+    for (uint16_t i = 0; i < SettingsManager::ReportingProtocol::kNumProtocols; i++) {
+        stats.num_reported_bytes[i] = num_reported_bytes_[i];
+    }
+}
+
+bool CommsManager::ReportRaw(SettingsManager::SerialInterface iface, const RawTransponderPacket packets_to_report[],
                              uint16_t num_packets_to_report) {
     return true;
 }
 
-bool CommsManager::ReportBeast(SettingsManager::SerialInterface iface, const TransponderPacket packets_to_report[],
+bool CommsManager::ReportBeast(SettingsManager::SerialInterface iface, const RawTransponderPacket packets_to_report[],
                                uint16_t num_packets_to_report) {
     for (uint16_t i = 0; i < num_packets_to_report; i++) {
         uint8_t beast_frame_buf[kBeastFrameMaxLenBytes];
@@ -73,10 +105,38 @@ bool CommsManager::ReportBeast(SettingsManager::SerialInterface iface, const Tra
         for (uint16_t j = 0; j < num_bytes_in_frame; j++) {
             comms_manager.iface_putc(iface, char(beast_frame_buf[j]));
         }
+        RecordReportedBytes(iface, num_bytes_in_frame + 1);  // Include the escape char.
     }
     return true;
 }
 
+/**
+ * Returns the ADSB_FLAGS bitmask for a MAVLINK ADSB_VEHICLE message, marking which of the aircraft's fields hold data
+ * from a packet instead of defaults or stale values.
+ */
+uint16_t AircraftToMAVLINKADSBFlags(const Aircraft &aircraft) {
+    uint16_t flags = 0;
+    if (aircraft.position_valid) {
+        flags |= 1;  // ADSB_FLAGS_VALID_COORDS
+    }
+    if (aircraft.altitude_source == Aircraft::AltitudeSource::kAltitudeSourceBaro ||
+        aircraft.altitude_source == Aircraft::AltitudeSource::kAltitudeSourceGNSS) {
+        flags |= 2;  // ADSB_FLAGS_VALID_ALTITUDE
+    }
+    if (aircraft.velocity_source != Aircraft::VelocitySource::kVelocitySourceNotSet &&
+        aircraft.velocity_source != Aircraft::VelocitySource::kVelocityNotAvailable) {
+        flags |= 4;  // ADSB_FLAGS_VALID_HEADING
+        flags |= 8;  // ADSB_FLAGS_VALID_VELOCITY
+    }
+    if (aircraft.received_fields & Aircraft::kChangedFieldsIdentification) {
+        flags |= 16;  // ADSB_FLAGS_VALID_CALLSIGN
+    }
+    if (aircraft.received_fields & Aircraft::kChangedFieldsSquawk) {
+        flags |= 32;  // ADSB_FLAGS_VALID_SQUAWK
+    }
+    return flags;
+}
+
 uint8_t AircraftAirframeTypeToMAVLINKEmitterType(Aircraft::AirframeType airframe_type) {
     switch (airframe_type) {
         case Aircraft::AirframeType::kAirframeTypeInvalid:
@@ -135,8 +195,18 @@ bool CommsManager::ReportMAVLINK(SettingsManager::SerialInterface iface) {
     uint16_t mavlink_version = reporting_protocols_[iface] == SettingsManager::kMAVLINK1 ? 1 : 2;
     mavlink_set_proto_version(SettingsManager::SerialInterface::kCommsUART, mavlink_version);
 
-    for (auto &itr : ads_bee.aircraft_dictionary.dict) {
-        const Aircraft &aircraft = itr.second;
+    // Only send aircraft that have changed since the last report on this interface, so that a slow telemetry link
+    // isn't saturated with aircraft that nothing new has been heard from. Core1 writes to the aircraft dictionary while
+    // packets are being decoded, so copy out one aircraft at a time and don't hold the lock while messages are sent.
+    AircraftDictionary::ChangeCursor cursor = {.consumer_id = iface};
+    while (true) {
+        Aircraft aircraft;
+        mutex_enter_blocking(&ads_bee.aircraft_dictionary_mutex);
+        bool aircraft_found = ads_bee.aircraft_dictionary.GetNextChangedAircraft(cursor, aircraft);
+        mutex_exit(&ads_bee.aircraft_dictionary_mutex);
+        if (!aircraft_found) {
+            break;  // No more changed aircraft.
+        }
 
         // Initialize the message
         mavlink_adsb_vehicle_t adsb_vehicle_msg = {
@@ -156,8 +226,8 @@ bool CommsManager::ReportMAVLINK(SettingsManager::SerialInterface iface) {
             .hor_velocity = static_cast<uint16_t>(KtsToMps(static_cast<int>(aircraft.velocity_kts)) * 100),
             // Vertical Velocity [cm/s]
             .ver_velocity = static_cast<int16_t>(FpmToMps(aircraft.vertical_rate_fpm) * 100),
-            .flags = 0,   // TODO: fix this!
-            .squawk = 0,  // TODO: fix this!
+            .flags = AircraftToMAVLINKADSBFlags(aircraft),
+            .squawk = aircraft.squawk,
             .altitude_type =
                 static_cast<uint8_t>(aircraft.altitude_source == Aircraft::AltitudeSource::kAltitudeSourceBaro ? 0 : 1),
             // Fill out callsign later.
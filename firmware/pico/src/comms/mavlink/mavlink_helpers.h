@@ -1086,6 +1086,7 @@ MAVLINK_HELPER void _mavlink_send_uart(mavlink_channel_t chan, const char *buf,
     for (uint16_t i = 0; i < len; i++) {
         comms_manager.iface_putc(static_cast<SettingsManager::SerialInterface>(chan), buf[i]);
     }
+    comms_manager.RecordReportedBytes(static_cast<SettingsManager::SerialInterface>(chan), len);
     // #ifdef MAVLINK_SEND_UART_BYTES
     //     /* this is the more efficient approach, if the platform
     //        defines it */
@@ -4,11 +4,14 @@
 #include "eeprom.hh"
 #include "esp32_flasher.hh"
 #include "hal.hh"
+#include "load_counter.hh"
 #include "pico/binary_info.h"
+#include "pico/multicore.h"
 #include "settings.hh"
 #include "unit_conversions.hh"
 
 const char* kSoftwareVersionStr = "0.0.1";
+const uint32_t kCoreLoadLogIntervalMs = 10e3;
 
 ADSBee::ADSBeeConfig ads_bee_config;
 // Override default config params here.
@@ -17,6 +20,43 @@ CommsManager comms_manager = CommsManager({});
 ESP32SerialFlasher esp32_flasher = ESP32SerialFlasher({});
 EEPROM eeprom = EEPROM({});
 SettingsManager settings_manager;
+LoadCounter core0_load_counter;
+LoadCounter core1_load_counter;
+
+/**
+ * Decode loop, runs on core1. Validates demodulated packets, ingests them into the aircraft dictionary, and hands them
+ * to core0 for reporting. Kept off of core0 so that blocking UART and USB writes there can't hold up decoding.
+ */
+void main_core1() {
+    while (true) {
+        uint32_t start_us = get_time_since_boot_us();
+        bool did_work = ads_bee.UpdateDecoder();
+
+        // Decode packets in place in the queue instead of copying each one out first.
+        const RawTransponderPacket *raw_packets;
+        uint16_t num_raw_packets;
+        while ((num_raw_packets = ads_bee.transponder_packet_queue.PeekSpan(raw_packets)) > 0) {
+            did_work = true;
+            for (uint16_t i = 0; i < num_raw_packets; i++) {
+                TransponderPacket packet = TransponderPacket(raw_packets[i]);
+                // CRC-clean packets (DF11/17/18) are validated directly. Packets with the CRC overlaid by the ICAO
+                // address (DF0/4/5/16/20/21) are validated against ICAO addresses recently seen in CRC-clean packets.
+                mutex_enter_blocking(&ads_bee.aircraft_dictionary_mutex);
+                bool packet_was_ingested = ads_bee.aircraft_dictionary.IngestTransponderPacket(packet);
+                mutex_exit(&ads_bee.aircraft_dictionary_mutex);
+                // Address/Parity packets only count as passing once they've been matched to a known ICAO address.
+                ads_bee.RecordPacketCRCResult(packet, packet.IsValid() || packet_was_ingested);
+                if (packet_was_ingested) {
+                    ads_bee.FlashStatusLED();
+                    // Forward the decoded packet so that any bit error corrections make it into the reports.
+                    comms_manager.transponder_packet_reporting_queue.Push(packet.GetRaw());
+                }
+            }
+            ads_bee.transponder_packet_queue.CommitPop(num_raw_packets);
+        }
+        core1_load_counter.RecordIteration(start_us, get_time_since_boot_us(), did_work);
+    }
+}
 
 int main() {
     bi_decl(bi_program_description("ADS-Bee ADSB Receiver"));
@@ -47,44 +87,29 @@ int main() {
     test_aircraft.velocity_kts = 200;
     ads_bee.aircraft_dictionary.InsertAircraft(test_aircraft);
 
+    // Core0 keeps the ISRs and reporting, core1 takes over decoding.
+    multicore_launch_core1(main_core1);
+
+    uint32_t last_core_load_log_timestamp_ms = get_time_since_boot_ms();
     while (true) {
         // Loop forever.
+        uint32_t start_us = get_time_since_boot_us();
+        // Count the loop as busy if there were packets waiting to be reported.
+        bool did_work = comms_manager.transponder_packet_reporting_queue.Length() > 0;
         comms_manager.Update();
         ads_bee.Update();
+        core0_load_counter.RecordIteration(start_us, get_time_since_boot_us(), did_work);
 
-        TransponderPacket packet;
-        while (ads_bee.transponder_packet_queue.Pop(packet)) {
-            uint32_t packet_buffer[TransponderPacket::kMaxPacketLenWords32];
-            packet.DumpPacketBuffer(packet_buffer);
-            if (packet.GetPacketBufferLenBits() == TransponderPacket::kExtendedSquitterPacketLenBits) {
-                CONSOLE_INFO("New message: 0x%08x|%08x|%08x|%04x RSSI=%ddBm MLAT=%u", packet_buffer[0],
-                             packet_buffer[1], packet_buffer[2], (packet_buffer[3]) >> (4 * kBitsPerNibble),
-                             packet.GetRSSIdBm(), packet.GetMLAT12MHzCounter());
-            } else {
-                CONSOLE_INFO("New message: 0x%08x|%06x RSSI=%ddBm MLAT=%u", packet_buffer[0],
-                             (packet_buffer[1]) >> (2 * kBitsPerNibble), packet.GetRSSIdBm(),
-                             packet.GetMLAT12MHzCounter());
-            }
-
-            if (packet.IsValid()) {
-                // 112-bit (extended squitter) packets. These packets can be validated via CRC.
-                ads_bee.FlashStatusLED();
-
-                CONSOLE_INFO("\tdf=%d icao_address=0x%06x", packet.GetDownlinkFormat(), packet.GetICAOAddress());
-                comms_manager.transponder_packet_reporting_queue.Push(packet);
-
-                ads_bee.aircraft_dictionary.IngestADSBPacket(ADSBPacket(packet));
-                CONSOLE_INFO("\taircraft_dictionary: %d aircraft", ads_bee.aircraft_dictionary.GetNumAircraft());
-            } else if (packet.GetPacketBufferLenBits() == TransponderPacket::kSquitterPacketNumBits) {
-                // CRC is overlaid with ICAO address for 56-bit (squitter) packets. Check ICAO against aircraft in the
-                // dictionary to validate the CRC.
-                if (ads_bee.aircraft_dictionary.ContainsAircraft(packet.GetICAOAddress())) {
-                    ads_bee.FlashStatusLED();
-                    CONSOLE_INFO("\tdf=%d icao_address=0x%06x", packet.GetDownlinkFormat(), packet.GetICAOAddress());
-                    comms_manager.transponder_packet_reporting_queue.Push(packet);
-                    // TODO: Add squitter packet support to aircraft dictionary.
-                }
-            }
+        uint32_t timestamp_ms = get_time_since_boot_ms();
+        if (timestamp_ms - last_core_load_log_timestamp_ms > kCoreLoadLogIntervalMs) {
+            CONSOLE_INFO("Core load: core0 %d%% (max loop %uus), core1 %d%% (max loop %uus)",
+                         core0_load_counter.GetLoadPercent(), core0_load_counter.GetMaxIterationUs(),
+                         core1_load_counter.GetLoadPercent(), core1_load_counter.GetMaxIterationUs());
+            CONSOLE_INFO("Reporting queue: %u dropped, high water mark %u/%u",
+                         comms_manager.transponder_packet_reporting_queue.GetNumOverflows(),
+                         comms_manager.transponder_packet_reporting_queue.GetHighWaterMark(),
+                         comms_manager.transponder_packet_reporting_queue.Capacity());
+            last_core_load_log_timestamp_ms = timestamp_ms;
         }
     }
-}
\ No newline at end of file
+}
@@ -1,4 +1,10 @@
 #ifndef _MAIN_HH_
 #define _MAIN_HH_
 
+#include "load_counter.hh"
+
+// Load on each core's main loop. Core0 handles ISRs and reporting, core1 handles decoding.
+extern LoadCounter core0_load_counter;
+extern LoadCounter core1_load_counter;
+
 #endif /* _MAIN_HH_ */
\ No newline at end of file